@@ -3,18 +3,46 @@ CONFIG += console
 CONFIG -= app_bundle
 CONFIG -= qt
 
+LIBS += -lpthread -lm
+
+# Fixed point sensor values, for targets without FPU
+# DEFINES += SENSOR_FIXED
+# Embedded profile: one byte states and events, no RAM copy of the model
+# DEFINES += FSM_COMPACT
+
 SOURCES += \
+        channels.c \
+        console_functions/control.c \
         console_functions/devConsole.c \
         console_functions/display.c \
         console_functions/keyboard.c \
         console_functions/systemErrors.c \
         events.c \
         fsm_functions/fsm.c \
+        fsm_functions/reactor.c \
+        fsm_functions/recorder.c \
+        hal_functions/hal.c \
+        hal_functions/halSimulator.c \
         main.c \
+        plant_functions/actuator.c \
+        plant_functions/arbiter.c \
+        plant_functions/montecarlo.c \
+        plant_functions/plant.c \
+        plant_functions/profile.c \
+        plant_functions/snapshot.c \
+        plant_functions/telemetry.c \
+        sensor_functions/filter.c \
+        sensor_functions/history.c \
+        sensor_functions/ingest.c \
+        sensor_functions/ingress.c \
+        sensor_functions/sampler.c \
+        sensor_functions/sensorValue.c \
         states.c
 
 HEADERS += \
    appInfo.h \
+   channels.h \
+   console_functions/control.h \
    console_functions/devConsole.h \
    console_functions/display.h \
    console_functions/keyboard.h \
@@ -22,6 +50,24 @@ HEADERS += \
    events.h \
    fsm.h \
    fsm_functions/fsm.h \
+   fsm_functions/protothread.h \
+   fsm_functions/reactor.h \
+   fsm_functions/recorder.h \
+   hal_functions/hal.h \
+   hal_functions/halSimulator.h \
+   plant_functions/actuator.h \
+   plant_functions/arbiter.h \
+   plant_functions/montecarlo.h \
+   plant_functions/plant.h \
+   plant_functions/profile.h \
+   plant_functions/snapshot.h \
+   plant_functions/telemetry.h \
    prototypes.h \
+   sensor_functions/filter.h \
+   sensor_functions/history.h \
+   sensor_functions/ingest.h \
+   sensor_functions/ingress.h \
+   sensor_functions/sampler.h \
+   sensor_functions/sensorValue.h \
    states.h \
    variables.h
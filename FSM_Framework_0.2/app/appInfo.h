@@ -5,4 +5,37 @@
 #define APP "ISE 2 - Plant Module by Gert&Luuk"
 #define VERSION "1.0"
 // #define NOWAIT
+
+#define DISPLAY_WIDTH 70   ///< Default number of display columns
+#define DISPLAY_HEIGHT 10  ///< Default number of display rows
+#define DASHBOARD_WIDTH 146  ///< Display columns of the dashboard, 3 plants
+#define DASHBOARD_HEIGHT 40  ///< Display rows of the dashboard
+
+#define SNAPSHOT_FILE "plantModule.snp"   ///< Used for a warm start
+#define SNAPSHOT_PERIOD_MS (1000)
+#define PROFILE_FILE "profiles.cfg"   ///< Threshold profiles, see PRFload()
+#define PROFILE_POLL_MS (500)          ///< Reload check of the profiles
+#define PLANT_SPECIES "default"        ///< Profile of the plant
+#define TELEMETRY_NAME "/plantModule.tel" ///< Shared memory read by fsmtop
+#define INGRESS_NAME "/plantModule.in"    ///< Sensor ring, see --ingress
+#define INGRESS_CAPACITY (4096)           ///< Records in the sensor ring
+#define INGRESS_IDLE_MS (100)             ///< Longest sleep on an empty ring
+#define CONTROL_SOCKET "plantModule.sock" ///< Event and sample input, see --reactor
+#define TELEMETRY_PERIOD_MS (250)         ///< Telemetry update of a sleeping reactor
+#define SAMPLE_MIN_MS (1000)              ///< Fastest sample interval of a channel
+#define SAMPLE_BUDGET (20)                ///< Channel reads per second of the sampler
+
+#define BACKTEST_PLANTS (1024) ///< Plant ids of a backtest log, see --backtest
+#define SIMULATION_STEP_MIN (5)     ///< Sample period of --simulate, plant time
+#define SIMULATION_SEED (20240101)  ///< Same seed, same outcome
+
+#define AIRFLOW_MS (2000)      ///< Time the window stays open
+#define MOISTURIZE_MS (3000)   ///< Time the pump runs
+#define HEAT_MS (2000)         ///< Time the heater is on
+#ifdef NOWAIT
+#define ACTION_BUDGET_US (20000) ///< Latency budget of the action states
+#else
+#define ACTION_BUDGET_US (0)     ///< DSPshow() waits for <Enter>, no budget
+#endif
+#define MONITOR_PERIOD_MS (10)   ///< Check of a running handler, see FSM_Overdue()
 #endif
@@ -0,0 +1,9 @@
+const char * const channelEnumToText[] =
+{
+   "CH_CO2",
+   "CH_MOISTURE",
+   "CH_TEMPERATURE",
+   "CH_HUMIDITY",
+   "CH_LIGHT",
+   "CH_SALINITY"
+};
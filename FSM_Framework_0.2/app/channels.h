@@ -0,0 +1,14 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+typedef enum {
+   CH_CO2,              ///< CO2 level of the air
+   CH_MOISTURE,         ///< Soil moisture
+   CH_TEMPERATURE,      ///< Temperature
+   CH_HUMIDITY,         ///< Air humidity
+   CH_LIGHT,            ///< Light intensity
+   CH_SALINITY,         ///< Soil salinity
+   CH_NOF_CHANNELS,     ///< Number of sensor channels, KEEP LAST
+} channel_t;
+
+#endif
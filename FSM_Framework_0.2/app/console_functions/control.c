@@ -0,0 +1,225 @@
+#include "control.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "fsm_functions/reactor.h"
+
+//---------------------------------------------------------------------- ConTroL
+
+extern const char * const eventEnumToText[];
+extern const char * const channelEnumToText[];
+
+#ifndef _WIN32
+
+typedef struct {
+   int fd;                          ///< -1 for a free slot
+   int length;
+   char line[CTL_LINE_LENGTH];
+} controlClient_t;
+
+static int listenFd = -1;
+static char socketPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static controlSample_t onSample = NULL;
+static controlClient_t clients[CTL_MAX_CLIENTS];
+
+/// \return the event of "E_RESET" or "RESET", E_NO if unknown
+static event_t findEvent(const char name[])
+{
+   for (int e = E_NO + 1; e < E_NOF_EVENTS; e++)
+   {
+      if (strcmp(eventEnumToText[e], name) == 0 ||
+          strcmp(eventEnumToText[e] + 2, name) == 0)
+      {
+         return (event_t)e;
+      }
+   }
+   return E_NO;
+}
+
+/// \return the channel of "CH_CO2" or "CO2", -1 if unknown
+static int findChannel(const char name[])
+{
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      if (strcmp(channelEnumToText[ch], name) == 0 ||
+          strcmp(channelEnumToText[ch] + 3, name) == 0)
+      {
+         return ch;
+      }
+   }
+   return -1;
+}
+
+static void parseLine(const char line[])
+{
+   char name[24];
+   const char *end;
+   int n = 0;
+   int channel;
+   sensorValue_t value;
+
+   if (sscanf(line, "%23s %n", name, &n) != 1)
+   {
+      return;
+   }
+   if (line[n] == '\0')
+   {
+      event_t event = findEvent(name);
+
+      if (event != E_NO)
+      {
+         FSM_AddEvent(event);
+      }
+      return;
+   }
+   channel = findChannel(name);
+   value = VALparse(line + n, &end);
+   if (channel >= 0 && end != line + n && onSample != NULL)
+   {
+      onSample((channel_t)channel, value);
+   }
+}
+
+static void disconnect(controlClient_t *client)
+{
+   RCTremove(client->fd);
+   close(client->fd);
+   client->fd = -1;
+}
+
+/// Splits the input of a client in lines, a too long line is dropped
+static event_t clientReadable(int fd, void *data)
+{
+   controlClient_t *client = data;
+   char input[256];
+   ssize_t n = read(fd, input, sizeof(input));
+
+   if (n <= 0)
+   {
+      disconnect(client);
+      return E_NO;
+   }
+   for (ssize_t i = 0; i < n; i++)
+   {
+      if (input[i] == '\n')
+      {
+         if (client->length >= 0)
+         {
+            client->line[client->length] = '\0';
+            parseLine(client->line);
+         }
+         client->length = 0;
+      }
+      else if (input[i] != '\r' && client->length >= 0)
+      {
+         client->line[client->length++] = input[i];
+         if (client->length == CTL_LINE_LENGTH)
+         {
+            client->length = -1;
+         }
+      }
+   }
+   return E_NO;
+}
+
+static event_t clientConnected(int fd, void *data)
+{
+   int client = accept(fd, NULL, NULL);
+
+   (void)data;
+   if (client < 0)
+   {
+      return E_NO;
+   }
+   for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+   {
+      if (clients[i].fd < 0)
+      {
+         clients[i].fd = client;
+         clients[i].length = 0;
+         if (RCTadd(client, clientReadable, &clients[i]) != 0)
+         {
+            clients[i].fd = -1;
+            break;
+         }
+         return E_NO;
+      }
+   }
+   close(client);
+   return E_NO;
+}
+
+int CTLopen(const char path[], controlSample_t sample)
+{
+   struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+   if (listenFd >= 0 || strlen(path) >= sizeof(address.sun_path))
+   {
+      return -1;
+   }
+   for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+   {
+      clients[i].fd = -1;
+   }
+   snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+   snprintf(socketPath, sizeof(socketPath), "%s", path);
+   onSample = sample;
+
+   // A socket left by a crashed run is replaced
+   unlink(path);
+   listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (listenFd < 0)
+   {
+      return -1;
+   }
+   if (bind(listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+       listen(listenFd, CTL_MAX_CLIENTS) != 0 ||
+       RCTadd(listenFd, clientConnected, NULL) != 0)
+   {
+      CTLclose();
+      return -1;
+   }
+   return 0;
+}
+
+void CTLclose(void)
+{
+   if (listenFd < 0)
+   {
+      return;
+   }
+   for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+   {
+      if (clients[i].fd >= 0)
+      {
+         disconnect(&clients[i]);
+      }
+   }
+   RCTremove(listenFd);
+   close(listenFd);
+   unlink(socketPath);
+   listenFd = -1;
+}
+
+#else
+
+// No unix sockets served by a reactor
+
+int CTLopen(const char path[], controlSample_t sample)
+{
+   (void)path;
+   (void)sample;
+   return -1;
+}
+
+void CTLclose(void)
+{
+}
+
+#endif
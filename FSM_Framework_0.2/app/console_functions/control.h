@@ -0,0 +1,28 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "channels.h"
+#include "sensor_functions/sensorValue.h"
+
+//---------------------------------------------------------------------- ConTroL
+
+/// Local control socket, a unix stream socket served by the reactor (see
+/// RCTinitialise()). A client writes lines:
+/// - an event, "E_RESET" or "RESET", added to the FSM,
+/// - a sample, "CO2 15.5" or "CH_CO2 15.5", passed to the sample callback.
+/// Invalid lines are ignored.
+
+#define CTL_MAX_CLIENTS 8     ///< Connections served at the same time
+#define CTL_LINE_LENGTH 64
+
+/// Handles a sample of a control client.
+typedef void (*controlSample_t)(channel_t channel, sensorValue_t value);
+
+/// Creates the socket path and registers it with the reactor.
+/// \return 0 on success, -1 on error or without reactor.
+int CTLopen(const char path[], controlSample_t sample);
+
+/// Closes the connections and removes the socket.
+void CTLclose(void);
+
+#endif
@@ -8,6 +8,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+static int consoleOff = 0;
+
+void DCSsetHeadless(int headless)
+{
+   consoleOff = headless;
+}
+
+int DCSheadless(void)
+{
+   return consoleOff;
+}
+
 void DCSinitialise(void)
 {
    DSPinitialise();
@@ -92,6 +104,10 @@ void DCSdebugSystemInfo(const char fmt[], ...)
 {
    va_list arg;
 
+   if (consoleOff)
+   {
+      return;
+   }
    printf("\n-- DEBUG  ");
    va_start(arg, fmt);
    vfprintf(stdout, fmt, arg);
@@ -102,6 +118,10 @@ void DCSsimulationSystemInfo(const char fmt[], ...)
 {
    va_list arg;
 
+   if (consoleOff)
+   {
+      return;
+   }
    printf("\n-- SIMULATION  ");
    va_start(arg, fmt);
    vfprintf(stdout, fmt, arg);
@@ -112,6 +132,10 @@ void DCSshowSystemError(const char fmt[], ...)
 {
    va_list arg;
 
+   if (consoleOff)
+   {
+      return;
+   }
    printf("\n-- SYSTEM ERROR  ");
    va_start(arg, fmt);
    vfprintf(stdout, fmt, arg);
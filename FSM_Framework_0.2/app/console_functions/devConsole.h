@@ -5,6 +5,13 @@
 /// \todo Is DCS a subsystem? It is part of a development system.
 void DCSinitialise(void);
 
+/// Switches all console output off (headless != 0) or on, e.g. while a
+/// recording is replayed. The display does not wait for \<enter\> then.
+void DCSsetHeadless(int headless);
+
+/// \return non zero if the console output is switched off.
+int DCSheadless(void);
+
 /// Shows questionText extended with '[y/n]'.
 /// User can enter Y by only pressing \<enter\>.
 /// \return boolean value, equals true if Y has been chosen.
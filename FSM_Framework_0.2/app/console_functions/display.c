@@ -1,41 +1,109 @@
 #include "display.h"
 #include "appInfo.h"
 #include "devConsole.h"
+#include "keyboard.h"
 #include "systemErrors.h"
 
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 //---------------------------------------------------------------------- DiSPlay
 
-#define DSP_HEIGHT 10 ///< The number of available display rows
-#define DSP_WIDTH 70  ///< The number of available display columns
+#ifdef _WIN32
+#define DSP_HOME ""                    // DSPclear() is used
+#else
+#define DSP_HOME "\033[H\033[2J\033[3J" // Cursor home, clear screen and history
+#endif
+#define DSP_ERRORS "|  System error bits: "
+#define DSP_FOOTER "\nDevelopment Console:\n"
+
+static int width = 0;
+static int height = 0;
+static char *display = NULL;  ///< height rows of width + 1 chars
+static char *frame = NULL;    ///< Composed output of DSPshowDisplay()
+static size_t frameCapacity = 0;
+
+static size_t dashboardItems = 0;
+static int dashboardCellWidth = 0;
+static dspCell_t dashboardCell = NULL;
+static void *dashboardData = NULL;
+
+/// \return the text of row.
+static char *line(int row)
+{
+   return &display[row * (width + 1)];
+}
+
+int DSPsetSize(int newWidth, int newHeight)
+{
+   char *newDisplay;
+   char *newFrame;
+   size_t capacity;
+
+   if (newWidth < DSP_MIN_WIDTH || newHeight < DSP_MIN_HEIGHT)
+   {
+      return -1;
+   }
+   // Worst case frame: every row full, the error bits and the bottom border
+   capacity = sizeof(DSP_HOME) + (size_t)newHeight * (newWidth + 1)
+            + sizeof(DSP_ERRORS) + ERR_NOF_ERRORS + 1
+            + newWidth + 1 + sizeof(DSP_FOOTER);
+   newDisplay = calloc((size_t)newHeight, newWidth + 1);
+   newFrame = malloc(capacity);
+   if (newDisplay == NULL || newFrame == NULL)
+   {
+      free(newDisplay);
+      free(newFrame);
+      return -1;
+   }
+   free(display);
+   free(frame);
+   display = newDisplay;
+   frame = newFrame;
+   frameCapacity = capacity;
+   width = newWidth;
+   height = newHeight;
+   return 0;
+}
+
+int DSPwidth(void)
+{
+   return width;
+}
 
-static char display[DSP_HEIGHT][DSP_WIDTH + 1] = {{0}};
-static char topDisplay[DSP_WIDTH] = {0};
+int DSPheight(void)
+{
+   return height;
+}
 
 void DSPinitialise(void)
 {
-   for (int i = 0; i < DSP_WIDTH; i++)
+   if (display == NULL && DSPsetSize(DISPLAY_WIDTH, DISPLAY_HEIGHT) != 0)
    {
-      topDisplay[i] = '=';
+      printf("\nERROR display memory is not available\n\n");
+      exit(EXIT_FAILURE); //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
    }
-   strncpy(display[0], topDisplay, DSP_WIDTH);
-   strncpy(display[DSP_HEIGHT - 1], topDisplay, DSP_WIDTH);
-   for (int i = 1; i < DSP_HEIGHT - 1; i++)
+   memset(line(0), '=', width);
+   memset(line(height - 1), '=', width);
+   for (int i = 1; i < height - 1; i++)
    {
-      display[i][0] = '|';
+      DSPclearLine(i);
    }
-   strncpy(&display[1][1], " " APP " v" VERSION, DSP_WIDTH - 5);
+   snprintf(&line(1)[1], width - 4, " " APP " v" VERSION);
 
    DSPshowDisplay();
-   DCSdebugSystemInfo("Display %dx%d: initialised", DSP_WIDTH, DSP_HEIGHT);
+   DCSdebugSystemInfo("Display %dx%d: initialised", width, height);
 }
 
 void DSPclear(void)
 {
+   if (DCSheadless())
+   {
+      return;
+   }
    if (!system(NULL))
    {
       printf("\nERROR command processor is not available\n\n");
@@ -60,24 +128,57 @@ void DSPclear(void)
 
 void DSPclearLine(int row)
 {
-   strcpy(display[row], "| ");
+   strcpy(line(row), "| ");
 }
 
-void DSPshowSystemErrorBits(void)
+/// Appends text to the frame.
+static char *append(char *p, const char text[], size_t length)
 {
-   printf("|  System error bits: %s\n", getSystemErrorBitsString());
-   printf("%s\n", display[0]);
+   memcpy(p, text, length);
+   return p + length;
 }
 
 void DSPshowDisplay(void)
 {
+   const char *errors;
+   char *p = frame;
+   size_t size;
+
+   if (DCSheadless() || display == NULL)
+   {
+      return;
+   }
+#ifdef _WIN32
    DSPclear();
-   for (int row = 0; row < DSP_HEIGHT; row++)
+#endif
+   p = append(p, DSP_HOME, sizeof(DSP_HOME) - 1);
+   for (int row = 0; row < height; row++)
    {
-      printf("%s\n", display[row]);
+      p = append(p, line(row), strlen(line(row)));
+      *p++ = '\n';
+   }
+   errors = getSystemErrorBitsString();
+   p = append(p, DSP_ERRORS, sizeof(DSP_ERRORS) - 1);
+   p = append(p, errors, strlen(errors));
+   *p++ = '\n';
+   p = append(p, line(0), width);
+   p = append(p, DSP_FOOTER, sizeof(DSP_FOOTER) - 1);
+   size = p - frame;
+
+   // Console text still buffered by stdio goes first
+   fflush(stdout);
+   p = frame;
+   while (size > 0)
+   {
+      ssize_t written = write(STDOUT_FILENO, p, size);
+
+      if (written <= 0)
+      {
+         return;
+      }
+      p += written;
+      size -= written;
    }
-   DSPshowSystemErrorBits();
-   puts("\nDevelopment Console:");
 }
 
 void DSPshow(int row, const char fmt[], ...)
@@ -85,14 +186,19 @@ void DSPshow(int row, const char fmt[], ...)
    va_list arg;
 
 #ifndef NOWAIT
-   DCSdebugSystemInfo("** Press <Enter>, for update display **");
-   getchar();
+   // With raw keys the operator drives the FSM, only the values typed at
+   // the console wait for a line
+   if (!DCSheadless() && !KYBraw())
+   {
+      DCSdebugSystemInfo("** Press <Enter>, for update display **");
+      getchar();
+   }
 #endif
 
    DSPclearLine(row);
 
    va_start(arg, fmt);
-   vsnprintf(&display[row][2], DSP_WIDTH - 3, fmt, arg); 
+   vsnprintf(&line(row)[2], width - 1, fmt, arg);
    va_end(arg);
 
    DSPshowDisplay();
@@ -102,16 +208,112 @@ void DSPshowDelete(int row, const char fmt[], ...)
 {
    va_list arg;
 #ifndef NOWAIT
-   DCSdebugSystemInfo("** Press <Enter>, for update display **");
-   getchar();
+   // With raw keys the operator drives the FSM, only the values typed at
+   // the console wait for a line
+   if (!DCSheadless() && !KYBraw())
+   {
+      DCSdebugSystemInfo("** Press <Enter>, for update display **");
+      getchar();
+   }
 #endif
-   for (int r = row; r < DSP_HEIGHT - 1; r++)
+   for (int r = row; r < height - 1; r++)
    {
       DSPclearLine(r);
    }
    va_start(arg, fmt);
-   vsnprintf(&display[row][2], DSP_WIDTH - 3, fmt, arg);
+   vsnprintf(&line(row)[2], width - 1, fmt, arg);
    va_end(arg);
 
    DSPshowDisplay();
 }
+
+void DSPsetDashboard(size_t nofItems, int cellWidth, dspCell_t cell,
+                     void *data)
+{
+   dashboardItems = nofItems;
+   dashboardCellWidth = cellWidth;
+   dashboardCell = cell;
+   dashboardData = data;
+}
+
+/// \return the number of cells in one dashboard row.
+static int dashboardColumns(void)
+{
+   return (width - 2) / (dashboardCellWidth + 1);
+}
+
+/// \return the number of cells on one dashboard page.
+static size_t dashboardCells(void)
+{
+   if (dashboardCellWidth <= 0 || height < 4)
+   {
+      return 0;
+   }
+   // The first and last row are borders, the second row is the header
+   return (size_t)dashboardColumns() * (height - 3);
+}
+
+int DSPdashboardPages(void)
+{
+   size_t cells = dashboardCells();
+
+   if (cells == 0 || dashboardItems == 0)
+   {
+      return 0;
+   }
+   return (int)((dashboardItems + cells - 1) / cells);
+}
+
+int DSPshowDashboard(int page)
+{
+   int pages = DSPdashboardPages();
+   int columns;
+   size_t cells;
+   size_t first;
+   size_t index;
+
+   if (pages == 0 || display == NULL)
+   {
+      return -1;
+   }
+   if (page >= pages)
+   {
+      page = pages - 1;
+   }
+   if (page < 0)
+   {
+      page = 0;
+   }
+   columns = dashboardColumns();
+   cells = dashboardCells();
+   first = page * cells;
+
+   DSPclearLine(1);
+   snprintf(&line(1)[2], width - 1, "Dashboard page %d/%d, %zu-%zu of %zu",
+            page + 1, pages, first + 1,
+            first + cells < dashboardItems ? first + cells : dashboardItems,
+            dashboardItems);
+
+   index = first;
+   for (int row = 2; row < height - 1; row++)
+   {
+      char *p = line(row) + 2;
+
+      DSPclearLine(row);
+      for (int column = 0; column < columns && index < dashboardItems;
+           column++, index++)
+      {
+         size_t length;
+
+         dashboardCell(p, dashboardCellWidth + 1, index, dashboardData);
+         // Pad the cell, so the columns line up
+         length = strlen(p);
+         memset(p + length, ' ', dashboardCellWidth + 1 - length);
+         p += dashboardCellWidth + 1;
+      }
+      *p = '\0';
+   }
+
+   DSPshowDisplay();
+   return page;
+}
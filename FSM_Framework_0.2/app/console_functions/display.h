@@ -3,16 +3,44 @@
 
 //---------------------------------------------------------------------- DiSPlay
 
+/// The display is composed in one frame buffer and written to the terminal
+/// with a single write() per update.
+
+#define DSP_MIN_WIDTH 20 ///< Minimal number of display columns
+#define DSP_MIN_HEIGHT 3 ///< Minimal number of display rows
+
+#include <stddef.h>
+
+/// Formats the status of dashboard item index in cell.
+/// \param size size of cell, the text is at most size - 1 chars
+/// \param data as given to DSPsetDashboard()
+typedef void (*dspCell_t)(char cell[], int size, size_t index, void *data);
+
 /// Initialises the Display (DSP) subsystem and draws an empty display
-/// (no text).
+/// (no text). The size is DISPLAY_WIDTH x DISPLAY_HEIGHT, unless
+/// DSPsetSize() was called before.
 void DSPinitialise(void);
 
+/// Sets the size of the display and allocates its buffers, the text is
+/// cleared.
+/// \param width number of columns, at least DSP_MIN_WIDTH
+/// \param height number of rows including the borders, at least
+///        DSP_MIN_HEIGHT
+/// \return 0 on success, -1 on an invalid size or out of memory
+int DSPsetSize(int width, int height);
+
+/// \return the number of display columns.
+int DSPwidth(void);
+
+/// \return the number of display rows, including the borders.
+int DSPheight(void);
+
 /// Clears full display (terminal) by executing a terminal command.
 void DSPclear(void);
 
 /// Clears a full line in the display.
-/// \param row display row index [1, DSP_HEIGHT-2]
-/// \pre   0 < row < DSP_HEIGHT-2
+/// \param row display row index [1, DSPheight()-2]
+/// \pre   0 < row < DSPheight()-1
 void DSPclearLine(int row);
 
 /// Shows full display contents.
@@ -26,4 +54,21 @@ void DSPshow(int row,  const char fmt[], ...);
 /// Add new text to display in row, deletes all subsequent lines.
 void DSPshowDelete(int row, const char fmt[], ...);
 
+/// Sets the items of the dashboard, a grid of one cell per item.
+/// Only the cells of the shown page are formatted, so the number of items
+/// does not influence the time to show a page.
+/// \param cellWidth number of columns of one cell
+/// \param cell formats one cell
+void DSPsetDashboard(size_t nofItems, int cellWidth, dspCell_t cell,
+                     void *data);
+
+/// \return the number of dashboard pages, 0 if the display is too small
+/// for one cell.
+int DSPdashboardPages(void);
+
+/// Shows one page of the dashboard, with a header row above the cells.
+/// \param page page index, limited to [0, DSPdashboardPages()-1]
+/// \return the shown page, -1 if there is no page.
+int DSPshowDashboard(int page);
+
 #endif
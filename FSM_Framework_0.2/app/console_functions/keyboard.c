@@ -3,37 +3,314 @@
 #include "display.h"
 
 #include <ctype.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 //--------------------------------------------------------------------- Keyboard
 
+#ifndef _WIN32
+
+static const keyBinding_t *keyBindings = NULL;
+static size_t nofKeyBindings = 0;
+static fsm_context_t *keyContext = NULL;
+
+static struct termios lineTerminal;    ///< Terminal settings before raw mode
+static struct termios rawTerminal;
+static _Atomic bool raw = false;    ///< Also read by the display threads
+static bool stopping = false;
+static pthread_t reader;
+static int wakePipe[2] = {-1, -1};
+
+/// The line functions pause the reader while they read, see beginLine()
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static int pauseRequests = 0;
+static bool readerPaused = false;
+
+static void addKey(char key)
+{
+   for (size_t i = 0; i < nofKeyBindings; i++)
+   {
+      const keyBinding_t *binding = &keyBindings[i];
+
+      if (binding->key == key)
+      {
+         uint32_t n = 0;
+
+         while (n < KYB_MAX_EVENTS && binding->events[n] != E_NO)
+         {
+            n++;
+         }
+         FSM_AddEvents(binding->events, n);
+         return;
+      }
+   }
+}
+
+/// Ends the poll() of the reader
+static void wakeReader(void)
+{
+   if (write(wakePipe[1], "w", 1) < 0)
+   {
+      // The pipe is full, the reader wakes anyway
+   }
+}
+
+/// Reads the keys as they are pressed, sleeps in poll() between them
+static void *readKeys(void *data)
+{
+   struct pollfd fds[2] = {
+      {.fd = STDIN_FILENO, .events = POLLIN},
+      {.fd = wakePipe[0], .events = POLLIN},
+   };
+
+   (void)data;
+   FSM_SelectContext(keyContext);
+   while (true)
+   {
+      char keys[16];
+      ssize_t n = 0;
+
+      poll(fds, 2, -1);
+      if (fds[1].revents & POLLIN)
+      {
+         char drain[8];
+
+         if (read(wakePipe[0], drain, sizeof(drain)) < 0)
+         {
+            // Nothing to drain, the wakeup was read before
+         }
+      }
+
+      // The keys are read under the lock, a line function that starts now
+      // gets all keys after it
+      pthread_mutex_lock(&lock);
+      if (pauseRequests > 0 && !stopping)
+      {
+         readerPaused = true;
+         pthread_cond_broadcast(&changed);
+         while (pauseRequests > 0 && !stopping)
+         {
+            pthread_cond_wait(&changed, &lock);
+         }
+         readerPaused = false;
+
+         // The line function may have read the input that was ready
+         fds[0].revents = 0;
+      }
+      if (stopping)
+      {
+         pthread_mutex_unlock(&lock);
+         break;
+      }
+      if (fds[0].revents & POLLIN)
+      {
+         n = read(STDIN_FILENO, keys, sizeof(keys));
+      }
+      pthread_mutex_unlock(&lock);
+
+      for (ssize_t i = 0; i < n; i++)
+      {
+         addKey(keys[i]);
+      }
+      if (n == 0 && (fds[0].revents & (POLLHUP | POLLERR)))
+      {
+         break;
+      }
+   }
+   return NULL;
+}
+
+/// Pauses the reader and switches the terminal to line editing, for the
+/// functions that read a line. Nothing happens without raw mode.
+static void beginLine(void)
+{
+   if (!raw || pthread_equal(pthread_self(), reader))
+   {
+      return;
+   }
+   pthread_mutex_lock(&lock);
+   if (pauseRequests++ == 0)
+   {
+      wakeReader();
+      while (!readerPaused && !stopping)
+      {
+         pthread_cond_wait(&changed, &lock);
+      }
+      tcsetattr(STDIN_FILENO, TCSANOW, &lineTerminal);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+/// Switches back to raw mode and resumes the reader.
+static void endLine(void)
+{
+   if (!raw || pthread_equal(pthread_self(), reader))
+   {
+      return;
+   }
+   pthread_mutex_lock(&lock);
+   if (--pauseRequests == 0)
+   {
+      tcsetattr(STDIN_FILENO, TCSANOW, &rawTerminal);
+      pthread_cond_broadcast(&changed);
+   }
+   pthread_mutex_unlock(&lock);
+}
+
+int KYBstartRaw(const keyBinding_t bindings[], size_t n)
+{
+   static bool registered = false;
+
+   if (raw || !isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &lineTerminal) != 0)
+   {
+      return -1;
+   }
+   if (pipe(wakePipe) != 0)
+   {
+      return -1;
+   }
+   keyBindings = bindings;
+   nofKeyBindings = n;
+   keyContext = FSM_GetContext();
+   stopping = false;
+
+   // No line editing and no echo, one key is enough for read(). Output
+   // processing and the signal keys stay as they are.
+   rawTerminal = lineTerminal;
+   rawTerminal.c_lflag &= ~(ICANON | ECHO);
+   rawTerminal.c_cc[VMIN] = 1;
+   rawTerminal.c_cc[VTIME] = 0;
+   if (tcsetattr(STDIN_FILENO, TCSANOW, &rawTerminal) != 0 ||
+       pthread_create(&reader, NULL, readKeys, NULL) != 0)
+   {
+      tcsetattr(STDIN_FILENO, TCSANOW, &lineTerminal);
+      close(wakePipe[0]);
+      close(wakePipe[1]);
+      return -1;
+   }
+   raw = true;
+   if (!registered)
+   {
+      atexit(KYBstopRaw);
+      registered = true;
+   }
+   return 0;
+}
+
+void KYBstopRaw(void)
+{
+   if (!raw)
+   {
+      return;
+   }
+   pthread_mutex_lock(&lock);
+   stopping = true;
+   pthread_cond_broadcast(&changed);
+   pthread_mutex_unlock(&lock);
+   wakeReader();
+   if (!pthread_equal(pthread_self(), reader))
+   {
+      pthread_join(reader, NULL);
+   }
+   tcsetattr(STDIN_FILENO, TCSANOW, &lineTerminal);
+   close(wakePipe[0]);
+   close(wakePipe[1]);
+   raw = false;
+}
+
+bool KYBraw(void)
+{
+   return raw;
+}
+
+#else
+
+// No termios, the keyboard only reads lines
+
+int KYBstartRaw(const keyBinding_t bindings[], size_t n)
+{
+   (void)bindings;
+   (void)n;
+   return -1;
+}
+
+void KYBstopRaw(void)
+{
+}
+
+bool KYBraw(void)
+{
+   return false;
+}
+
+static void beginLine(void)
+{
+}
+
+static void endLine(void)
+{
+}
+
+#endif
+
 void KYBinitialise(void)
 {
    DCSdebugSystemInfo("Keyboard: initialised");
 }
 
-void KYBclear(void)
+/// KYBclear() without pausing the reader
+static void clearLine(void)
 {
-   while ((getchar()) != '\n')
+   int c;
+
+   while ((c = getchar()) != '\n' && c != EOF)
    {
       // Remove all remaining buffered input chars
    }
 }
 
+void KYBclear(void)
+{
+   beginLine();
+   clearLine();
+   endLine();
+}
+
 char KYBgetchar(void)
 {
-   char c = getchar();
-   KYBclear();
-   return c;
+   int c;
+
+   beginLine();
+   c = getchar();
+   if (c != '\n' && c != EOF)
+   {
+      // A bare <Enter> is the whole line
+      clearLine();
+   }
+   endLine();
+   return (char)c;
 }
 
 int KYBgetint(int ifWrongValue)
 {
    int input = 0;
+   int nOk;
+
+   beginLine();
    // scanf reads input buffer until space, tab or enter.
-   int nOk = scanf(" %d", &input);
+   nOk = scanf(" %d", &input);
+   clearLine();
+   endLine();
 
-   KYBclear();
    // Check if input is an int (nOk == 1), if not return ifWrongValue
    if (nOk != 1)
    {
@@ -45,10 +322,14 @@ int KYBgetint(int ifWrongValue)
 double KYBgetdouble(double ifWrongValue)
 {
    double input = 0.0;
+   int nOk;
+
+   beginLine();
    // scanf reads input buffer until space, tab or enter.
-   int nOk = scanf(" %lf", &input);
+   nOk = scanf(" %lf", &input);
+   clearLine();
+   endLine();
 
-   KYBclear();
    // Check if input is an double (nOk == 1), if not return ifWrongValue
    if (nOk != 1)
    {
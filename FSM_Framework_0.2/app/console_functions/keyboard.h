@@ -1,11 +1,48 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fsm_functions/fsm.h"
+
 //--------------------------------------------------------------------- KeYBoard
 
+/// Raw mode: the terminal passes every key at once, without \<Enter\> and
+/// without echo. A reader thread maps the keys to FSM events with a binding
+/// table and adds them with FSM_AddEvents(), so the FSM never blocks on the
+/// operator. The functions below that read a line still work: they pause the
+/// reader and switch the terminal back to line editing while they read.
+/// Raw mode needs termios, elsewhere KYBstartRaw() fails.
+
+#define KYB_MAX_EVENTS 2   ///< Events of one key binding
+
+/// The events added for a key, E_NO ends a shorter list.
+typedef struct {
+   char key;
+   event_t events[KYB_MAX_EVENTS];
+   const char *help;                ///< Description for the operator
+} keyBinding_t;
+
 /// Initialises the keyboard (KYB) subsystem.
 void KYBinitialise(void);
 
+/// Switches the terminal to raw mode and starts the reader thread. The
+/// events are added to the FSM instance selected by the calling thread.
+/// Keys without a binding are ignored, Ctrl+C still raises SIGINT. The
+/// terminal is restored at exit.
+/// \param bindings the table is not copied
+/// \return 0 on success, -1 if stdin is not a terminal, raw mode runs or the
+/// platform has no termios.
+int KYBstartRaw(const keyBinding_t bindings[], size_t n);
+
+/// Stops the reader thread and restores the terminal.
+void KYBstopRaw(void);
+
+/// \return true while raw mode runs. The display does not pause for
+/// \<Enter\> then.
+bool KYBraw(void);
+
 /// Empty input buffer (stdin).
 void KYBclear(void);
 
@@ -2,37 +2,111 @@
 
 #include <stddef.h>
 
-static systemErrors_t systemErrorBits = 0b00000000; // 0b prefix is not standard
-static char systemErrorBitsString[sizeof(systemErrorBits) * 8 + 1] = "00000000";
+#define ERR_BIT(err) ((systemErrors_t)1 << (err))
 
-int setSystemErrorBit(error_t err)
+static errorSet_t defaultSet = { 0, 0, "", NULL, NULL };
+static _Thread_local errorSet_t *selectedSet = &defaultSet;
+
+/// Renders the bits in the string of set, bit 0 first.
+static void render(errorSet_t *set, systemErrors_t bits)
+{
+   for (size_t i = 0; i < ERR_NOF_ERRORS; i++)
+   {
+      set->string[i] = (bits & ERR_BIT(i)) ? '1' : '0';
+   }
+   set->string[ERR_NOF_ERRORS] = '\0';
+   set->renderedBits = bits;
+}
+
+void initErrorSet(errorSet_t *set)
 {
-   int systemErrorBit = getSystemErrorBit(err);
+   atomic_init(&set->bits, 0);
+   set->notify = NULL;
+   set->data = NULL;
+   render(set, 0);
+}
 
-   systemErrorBits |= 0x01 << err;
+void selectSystemErrors(errorSet_t *set)
+{
+   selectedSet = (set == NULL) ? &defaultSet : set;
+}
 
-   return systemErrorBit;
+void setErrorNotification(errorSet_t *set, errorNotify_t notify, void *data)
+{
+   set->data = data;
+   set->notify = notify;
+}
+
+systemErrors_t setErrorBits(errorSet_t *set, systemErrors_t mask)
+{
+   systemErrors_t previous = atomic_fetch_or_explicit(&set->bits, mask,
+                                                      memory_order_acq_rel);
+   systemErrors_t raised = mask & ~previous;
+
+   // Only the thread that actually raised a bit notifies, so once per change
+   if (raised != 0 && set->notify != NULL)
+   {
+      set->notify(set, raised, set->data);
+   }
+   return previous;
+}
+
+int setErrorBit(errorSet_t *set, error_t err)
+{
+   return (setErrorBits(set, ERR_BIT(err)) & ERR_BIT(err)) != 0;
+}
+
+int clearErrorBit(errorSet_t *set, error_t err)
+{
+   systemErrors_t previous = atomic_fetch_and_explicit(&set->bits,
+                                                       ~ERR_BIT(err),
+                                                       memory_order_acq_rel);
+
+   return (previous & ERR_BIT(err)) != 0;
+}
+
+int getErrorBit(const errorSet_t *set, error_t err)
+{
+   return (getErrorBits(set) & ERR_BIT(err)) != 0;
+}
+
+systemErrors_t getErrorBits(const errorSet_t *set)
+{
+   return atomic_load_explicit(&set->bits, memory_order_acquire);
+}
+
+const char *getErrorBitsString(errorSet_t *set)
+{
+   systemErrors_t bits = getErrorBits(set);
+
+   if (bits != set->renderedBits || set->string[0] == '\0')
+   {
+      render(set, bits);
+   }
+   return set->string;
+}
+
+int setSystemErrorBit(error_t err)
+{
+   return setErrorBit(selectedSet, err);
+}
+
+int clearSystemErrorBit(error_t err)
+{
+   return clearErrorBit(selectedSet, err);
 }
 
 int getSystemErrorBit(error_t err)
 {
-   return (systemErrorBits & (0x01 << err)) != 0;
+   return getErrorBit(selectedSet, err);
 }
 
 systemErrors_t getSystemErrorBits(void)
 {
-   return systemErrorBits;
+   return getErrorBits(selectedSet);
 }
 
 const char *getSystemErrorBitsString(void)
 {
-   for (size_t i = 0; i < sizeof(systemErrorBits) * 8; i++)
-   {
-      systemErrorBitsString[i] = '0';
-      if (getSystemErrorBit(i))
-      {
-         systemErrorBitsString[i] = '1';
-      }
-   }
-   return systemErrorBitsString;
+   return getErrorBitsString(selectedSet);
 }
@@ -1,22 +1,87 @@
 #ifndef SYSTEMERRORS_H
 #define SYSTEMERRORS_H
 
-/// \brief Error bit index values.
+#include <stdatomic.h>
+#include <stdint.h>
+
+/// \brief Error bit index values, at most 64.
 typedef enum {
-   ERR_INIT_CNA, ///< Initialisation error Coin Acceptor selftest
-   ERR_INIT_CLD,  ///< Initialisation error Cola Dispenser selftest
-   ERR_INIT_CHD   ///< Initialisation error Change Dispenser selftest
+   ERR_INIT,            ///< Initialisation of a subsystem failed
+   ERR_SENSOR_BUS,      ///< Reading the sensors failed
+   ERR_ACTUATOR_BUS,    ///< Sending actuator commands failed
+   ERR_ACTUATOR_BUSY,   ///< No free actuation, action run synchronously
+   ERR_OUTSIDEBOUNDS,   ///< Sensor value outside the bounds
+   ERR_HANDLER_OVERRUN, ///< A state handler exceeded its latency budget
+   ERR_UNKNOWN_PLANT,   ///< Input for a plant that is not controlled here
+   ERR_NOF_ERRORS
 } error_t;
 
-/// Type name for bit mapped errors: 8 bits.
-typedef unsigned char systemErrors_t;
+/// Type name for bit mapped errors: 64 bits.
+typedef uint64_t systemErrors_t;
+
+typedef struct errorSet errorSet_t;
+
+/// Called when error bits change from 0 to 1, in the thread that set them.
+/// \param raised the bits that were raised by this call.
+typedef void (*errorNotify_t)(errorSet_t *set, systemErrors_t raised,
+                              void *data);
+
+/// One set of error bits. The bits can be set and cleared from any thread
+/// without locking, the string is rendered by one (display) thread only.
+struct errorSet {
+   _Atomic systemErrors_t bits;
+   systemErrors_t renderedBits;           ///< Bits of string
+   char string[ERR_NOF_ERRORS + 1];
+   errorNotify_t notify;
+   void *data;                            ///< Passed to notify
+};
+
+/// Initialises set, all bits cleared and no notification.
+void initErrorSet(errorSet_t *set);
+
+/// Selects the set used by the System functions in the calling thread, NULL
+/// selects the default.
+void selectSystemErrors(errorSet_t *set);
+
+/// Sets the function called when bits of set are raised, NULL for none.
+/// Set it before other threads use set.
+void setErrorNotification(errorSet_t *set, errorNotify_t notify, void *data);
 
 /// Set error bit.
 /// \param err error bit index.
 /// \return previous value error bit.
+int setErrorBit(errorSet_t *set, error_t err);
+
+/// Sets all bits of mask.
+/// \return the previous bits.
+systemErrors_t setErrorBits(errorSet_t *set, systemErrors_t mask);
+
+/// Clear error bit.
+/// \return previous value error bit.
+int clearErrorBit(errorSet_t *set, error_t err);
+
+/// Get error bit.
+/// \return boolean value 0 or 1.
+int getErrorBit(const errorSet_t *set, error_t err);
+
+/// \return value of the error bits of set.
+systemErrors_t getErrorBits(const errorSet_t *set);
+
+/// \return string showing the ERR_NOF_ERRORS error bits in binary format,
+/// bit 0 first. The string is only rendered again when the bits changed.
+/// Example: "010010"
+const char *getErrorBitsString(errorSet_t *set);
+
+/// Set error bit in the selected set.
+/// \param err error bit index.
+/// \return previous value error bit.
 int setSystemErrorBit(error_t err);
 
-/// Set error bit.
+/// Clear error bit in the selected set.
+/// \return previous value error bit.
+int clearSystemErrorBit(error_t err);
+
+/// Get error bit of the selected set.
 /// \param err error bit index.
 /// \return boolean value 0 or 1.
 int getSystemErrorBit(error_t err);
@@ -24,8 +89,7 @@ int getSystemErrorBit(error_t err);
 /// \return value of systemErrorBits.
 systemErrors_t getSystemErrorBits(void);
 
-/// \return string showing 8 error bits in binary format.
-/// Example: "11000000"
+/// \return string of the selected set, see getErrorBitsString().
 const char *getSystemErrorBitsString(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,16 +1,17 @@
-// global variables
-char * eventEnumToText[] =
+// global variables, constant so they can stay in flash
+const char * const eventEnumToText[] =
 {
    "E_NO",                ///< Used for initialisation of an event variable KEEP NO AND INIT
    "E_INIT",
+   "E_INITSUCCES",
    "E_INITERROR",
    "E_INPUTCHANGED",
    "E_NOACTION",
-   "E_NORMALCHANGE",
    "E_OUTSIDEBOUNDS",
    "E_ERRORLOGGED",
    "E_CO2LOW",
    "E_MOISTURELOW",
    "E_TOOCOLD",
-   "E_RESET"
+   "E_RESET",
+   "E_HANDLEROVERRUN"
 };
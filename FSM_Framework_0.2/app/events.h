@@ -14,6 +14,8 @@ typedef enum {
    E_MOISTURELOW,
    E_TOOCOLD,
    E_RESET,
+   E_HANDLEROVERRUN,    ///< A handler exceeded its latency budget
+   E_NOF_EVENTS,        ///< Number of events, KEEP LAST
 } event_t;
 
 #endif
@@ -1,5 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
 #include "fsm.h"
 #include "events.h"
 #include "states.h"
@@ -10,80 +17,498 @@
 #error events size is not a power of two
 #endif
 
-// Global variables
+#define MAX_INTERNAL_EVENTS_MASK (MAX_INTERNAL_EVENTS - 1)
+#if (MAX_INTERNAL_EVENTS & MAX_INTERNAL_EVENTS_MASK)
+#error internal events size is not a power of two
+#endif
+
+#ifndef FSM_COMPACT
+// Global variables, the model built by FSM_AddState() and FSM_AddTransition()
 state_funcs_t state_funcs[MAX_STATES] = {0};
 
 transition_t transitions[MAX_TRANSITIONS];
 static volatile uint8_t transition_cnt = 0;
 
-event_t events[MAX_EVENTS_IN_BUFFER];
-static volatile uint8_t head = 0;
-static volatile uint8_t tail = 0;
+// The model in use, the RAM tables above or the tables of FSM_SetModel()
+static const state_funcs_t *model_states = state_funcs;
+static uint8_t model_nof_states = 0;
+static const transition_t *model_transitions = transitions;
+static uint8_t model_nof_transitions = 0;
+#else
+static const state_funcs_t *model_states = NULL;
+static uint8_t model_nof_states = 0;
+static const transition_t *model_transitions = NULL;
+static uint8_t model_nof_transitions = 0;
+#endif
+
+// A transition with the states it leaves and enters, only the states that
+// have an onExit() or onEntry() function respectively
+typedef struct
+{
+   fsm_state_t to;
+   uint8_t nof_exits;
+   uint8_t nof_entries;
+   uint8_t exits[MAX_DEPTH];             // Innermost first
+   uint8_t entries[MAX_DEPTH];           // Outermost first
+}fsm_path_t;
+
+// The compiled model of FSM_FreezeModel(): the path of every state and event,
+// dispatch[state * dispatch_events + event] is its index in paths + 1, 0 for
+// no transition
+static bool model_frozen = false;
+static uint16_t *dispatch = NULL;
+static uint16_t dispatch_states = 0;
+static uint16_t dispatch_events = 0;
+static fsm_path_t *paths = NULL;
+static uint16_t nof_paths = 0;
+
+// The default instance, used when no other context has been selected
+static fsm_context_t default_context = {0};
+
+// The selected instance. The current state, the event buffer and the
+// run-to-completion channel all live in this context. The selection is per
+// thread, so threads can run instances of the same model in parallel.
+static _Thread_local fsm_context_t *ctx = &default_context;
 
 static volatile bool flush_event = 0;
 
-int numOfStates;
-int numOfTransitions;
+// Called for every event taken from the event buffer by the event loop
+static void (*event_hook)(const state_t state, const event_t event) = NULL;
 
-// Update for version 0.2 ORO
-static state_t state;  // contains always the current state. can be obtained via state_t FSM_GetState(void)
+// Called by the event loop when the event buffer is empty
+static void (*idle_hook)(void) = NULL;
+
+// Sleep of the event loop while the event buffer is empty, and its wakeup
+static void (*wait_hook)(void) = NULL;
+static void (*wake_hook)(void) = NULL;
+
+// Watchdog of the handler latency budgets
+static event_t overrun_event = E_NO;
+static void (*overrun_hook)(const state_t state, const uint32_t us) = NULL;
+
+void FSM_InitContext(fsm_context_t *context, void *data)
+{
+   memset(context, 0, sizeof(fsm_context_t));
+   context->state = S_NO;
+   context->data = data;
+}
+
+void FSM_SelectContext(fsm_context_t *context)
+{
+   ctx = (context != NULL) ? context : &default_context;
+}
+
+fsm_context_t *FSM_GetContext(void)
+{
+   return ctx;
+}
 
 // Local function to solve a bug
 void FSM_SetState(state_t newstate);
 void FSM_SetState(state_t newstate)
 {
-    state = newstate;
+    ctx->state = newstate;
 }
 
 state_t FSM_GetState(void)
 {
-    return state;
+    return ctx->state;
 }
 
-state_t FSM_EventHandler(const state_t state, const event_t event)
+// Monotonic time in us, wraps after 71 minutes
+static uint32_t FSM_Microseconds(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint32_t)(now.tv_sec * 1000000u + now.tv_nsec / 1000);
+}
+
+// Calls *handler* of *state*, timed if the state has a latency budget
+static void FSM_Call(void (*handler)(void), const state_t state)
+{
+   const uint32_t budget = model_states[state].budget_us;
+   fsm_context_t *context = ctx;
+   uint32_t start;
+   uint32_t us;
+
+   if(budget == 0)
+   {
+      handler();
+      return;
+   }
+
+   start = FSM_Microseconds();
+   // The budget publishes the start to FSM_Overdue() in another thread
+   atomic_store_explicit(&context->handler_start, start, memory_order_relaxed);
+   atomic_store_explicit(&context->handler_budget, budget, memory_order_release);
+   handler();
+   atomic_store_explicit(&context->handler_budget, 0, memory_order_relaxed);
+
+   us = FSM_Microseconds() - start;
+   if(us > budget)
+   {
+      context->overruns++;
+      if(overrun_hook != NULL)
+      {
+         overrun_hook(state, us);
+      }
+      if(overrun_event != E_NO)
+      {
+         FSM_AddEvent(overrun_event);
+      }
+   }
+}
+
+// The enclosing state of *state*, S_NO for a top level state
+static state_t FSM_Parent(const state_t state)
+{
+   return (state < model_nof_states) ? (state_t)model_states[state].parent : S_NO;
+}
+
+// Returns true if *ancestor* encloses *state*. S_NO encloses all states
+// that are nested at most MAX_DEPTH levels.
+static bool FSM_Encloses(const state_t ancestor, state_t state)
 {
-   state_t nextState = state;
+   for(uint8_t depth = 0; depth < MAX_DEPTH && state != S_NO; depth++)
+   {
+      state = FSM_Parent(state);
+      if(state == ancestor)
+      {
+         return true;
+      }
+   }
+   return false;
+}
 
+// The first transition of *event* in *from*, NULL if there is none
+static const transition_t *FSM_Find(const state_t from, const event_t event)
+{
    // Check all transitions in the transition matrix
-   for(uint8_t i=0; i <= transition_cnt; ++i)
+   for(uint8_t i = 0; i < model_nof_transitions; ++i)
    {
-      // Is the state equal to the from state?
-      if(transitions[i].from == state)
+      if(model_transitions[i].from == from && model_transitions[i].event == event)
       {
-         // And is the event equal to the event?
-         if(transitions[i].event == event)
+         return &model_transitions[i];
+      }
+   }
+   return NULL;
+}
+
+// Finds the transition of *event* in *state* or else in the nearest state
+// that encloses it, and the states it leaves and enters. Returns false if
+// there is none.
+static bool FSM_Resolve(const state_t state, const event_t event, fsm_path_t *path)
+{
+   const transition_t *transition = FSM_Find(state, event);
+   state_t from = state;
+   state_t common;
+   state_t s;
+   uint8_t depth;
+
+   // Then the transitions of the enclosing states, innermost first
+   for(depth = 1; depth < MAX_DEPTH && transition == NULL; depth++)
+   {
+      from = FSM_Parent(from);
+      if(from == S_NO)
+      {
+         return false;
+      }
+      transition = FSM_Find(from, event);
+   }
+   if(transition == NULL)
+   {
+      return false;
+   }
+
+   // The nearest state that encloses the from state and the to state
+   common = FSM_Parent(from);
+   for(depth = 0; depth < MAX_DEPTH && !FSM_Encloses(common, transition->to); depth++)
+   {
+      common = FSM_Parent(common);
+   }
+
+   path->to = transition->to;
+   path->nof_exits = 0;
+   for(s = state, depth = 0; s != common && depth < MAX_DEPTH; s = FSM_Parent(s), depth++)
+   {
+      if(s < model_nof_states && model_states[s].onExit != NULL)
+      {
+         path->exits[path->nof_exits++] = (uint8_t)s;
+      }
+   }
+   path->nof_entries = 0;
+   for(s = transition->to, depth = 0; s != common && depth < MAX_DEPTH; s = FSM_Parent(s), depth++)
+   {
+      if(s < model_nof_states && model_states[s].onEntry != NULL)
+      {
+         path->entries[path->nof_entries++] = (uint8_t)s;
+      }
+   }
+   // Outermost first
+   for(uint8_t i = 0; i < path->nof_entries / 2; i++)
+   {
+      const uint8_t entry = path->entries[i];
+
+      path->entries[i] = path->entries[path->nof_entries - 1 - i];
+      path->entries[path->nof_entries - 1 - i] = entry;
+   }
+   return true;
+}
+
+// The transition of *event* in *state*, NULL if there is none. *local* holds
+// the path if the model could not be compiled.
+static const fsm_path_t *FSM_Lookup(const state_t state, const event_t event,
+                                    fsm_path_t *local)
+{
+   if(!model_frozen)
+   {
+      FSM_FreezeModel();
+   }
+   if(dispatch != NULL)
+   {
+      uint16_t index;
+
+      if(state >= dispatch_states || event >= dispatch_events)
+      {
+         return NULL;
+      }
+      index = dispatch[state * dispatch_events + event];
+      return (index != 0) ? &paths[index - 1] : NULL;
+   }
+   return FSM_Resolve(state, event, local) ? local : NULL;
+}
+
+// Executes the transition for *event* in *state*, returns true if found
+static bool FSM_Transition(const state_t state, const event_t event)
+{
+   fsm_path_t local;
+   const fsm_path_t *path;
+
+   ctx->handled++;
+
+   path = FSM_Lookup(state, event, &local);
+   if(path == NULL)
+   {
+      // The event is unexpected in the current state. Remain in current
+      // state. Optionally, return the event back in the event buffer.
+      if(!flush_event)
+      {
+         FSM_AddEvent(event);
+      }
+      return false;
+   }
+
+   // Execute the onExit() functions of the states that are left
+   for(uint8_t i = 0; i < path->nof_exits; i++)
+   {
+      FSM_Call(model_states[path->exits[i]].onExit, (state_t)path->exits[i]);
+   }
+
+   // Set the next state
+   // Update for version 0.2 ORO
+   FSM_SetState(path->to);  // required, so the state variable is up to date.
+
+   // Execute the onEntry() functions of the states that are entered
+   for(uint8_t i = 0; i < path->nof_entries; i++)
+   {
+      FSM_Call(model_states[path->entries[i]].onEntry, (state_t)path->entries[i]);
+   }
+
+   return true;
+}
+
+// Returns true if the run-to-completion channel of the selected context
+// holds events
+static bool FSM_InternalEvents(void)
+{
+   return ctx->internal_tail != ctx->internal_head;
+}
+
+// Run to completion: handle the internally generated events of the selected
+// context before returning to the caller. The run stops at a cycle, when the
+// next event would be handled in a state it has passed, e.g. a state that
+// waits for the console and starts over. It stops as well after
+// MAX_RUN_TO_COMPLETION events. The event loop continues the run after its
+// idle hook, so the hooks and the external events are not starved.
+static void FSM_RunToCompletion(void)
+{
+   uint64_t visited = 0;
+
+   for(uint8_t n = 0; n < MAX_RUN_TO_COMPLETION && FSM_InternalEvents(); n++)
+   {
+      const state_t state = FSM_GetState();
+
+      if(state < 64)
+      {
+         if(visited & ((uint64_t)1 << state))
          {
-            // Execute the from state onExit() function
-            if(state_funcs[transitions[i].from].onExit != NULL)
-            {
-               state_funcs[transitions[i].from].onExit();
-            }
+            break;
+         }
+         visited |= (uint64_t)1 << state;
+      }
+      ctx->internal_tail = (ctx->internal_tail + 1) & MAX_INTERNAL_EVENTS_MASK;
+      FSM_Transition(state, ctx->internal_events[ctx->internal_tail]);
+   }
+}
 
-            // Set the next state
-            // Update for version 0.2 ORO
-            FSM_SetState(transitions[i].to);  // required, so the state variable is up to date.
+state_t FSM_EventHandler(const state_t state, const event_t event)
+{
+   FSM_SetState(state);
 
-            nextState = transitions[i].to;
+   // E_NO continues a run to completion that stopped
+   if(event != E_NO)
+   {
+      FSM_Transition(state, event);
+   }
+   FSM_RunToCompletion();
 
-            // Execute the to state onEntry() function
-            if(state_funcs[transitions[i].to].onEntry != NULL)
-            {
-               state_funcs[transitions[i].to].onEntry();
-            }
+   return FSM_GetState();
+}
+
+int FSM_InitFleet(fsm_fleet_t *fleet, uint32_t size, state_t state, void *data[])
+{
+   uint16_t nof_states;
+
+   memset(fleet, 0, sizeof(fsm_fleet_t));
+
+   // The table covers the states of the model and all states of the
+   // transitions, an instance can be in each of them
+   nof_states = model_nof_states;
+   for(uint8_t i = 0; i < model_nof_transitions; i++)
+   {
+      if(model_transitions[i].from >= nof_states)
+      {
+         nof_states = model_transitions[i].from + 1;
+      }
+      if(model_transitions[i].to >= nof_states)
+      {
+         nof_states = model_transitions[i].to + 1;
+      }
+   }
+   if(nof_states >= FSM_FLEET_NONE || state >= nof_states)
+   {
+      // Error, states do not fit in the table
+      return -1;
+   }
+
+   fleet->size = size;
+   fleet->data = data;
+   fleet->state = malloc(size);
+   fleet->event = calloc(size, 1);
+   fleet->changed = malloc(size * sizeof(uint32_t));
+   fleet->table = malloc(nof_states << 8);
+   if(fleet->state == NULL || fleet->event == NULL || fleet->changed == NULL ||
+      fleet->table == NULL)
+   {
+      FSM_FreeFleet(fleet);
+      return -1;
+   }
+   memset(fleet->state, state, size);
 
-            return nextState;
+   // Compile the transitions, including those of the enclosing states
+   memset(fleet->table, FSM_FLEET_NONE, nof_states << 8);
+   for(uint16_t s = 0; s < nof_states; s++)
+   {
+      for(uint16_t e = E_NO + 1; e <= 0xFF; e++)
+      {
+         fsm_path_t local;
+         const fsm_path_t *path = FSM_Lookup((state_t)s, (event_t)e, &local);
+
+         if(path != NULL)
+         {
+            fleet->table[s << 8 | e] = (uint8_t)path->to;
          }
       }
    }
+   FSM_InitContext(&fleet->context, NULL);
+   return 0;
+}
 
-   // Still here, so the event is unexpected in the current state. Remain in
-   // current state. Optionally, return the event back in the event buffer.
-   if(!flush_event)
+uint32_t FSM_StepFleet(fsm_fleet_t *fleet, event_t event)
+{
+   const uint8_t *table = fleet->table;
+   uint8_t *states = fleet->state;
+   uint32_t *changed = fleet->changed;
+   uint32_t n = 0;
+   fsm_context_t *selected;
+
+   // Look up the transitions of all instances, without branches
+   if(event != E_NO)
    {
-      FSM_AddEvent(event);
+      table += (uint8_t)event;
+      for(uint32_t i = 0; i < fleet->size; i++)
+      {
+         changed[n] = i;
+         n += (table[states[i] << 8] != FSM_FLEET_NONE);
+      }
+   }
+   else
+   {
+      uint8_t *events = fleet->event;
+
+      // The pending events without a transition are flushed
+      for(uint32_t i = 0; i < fleet->size; i++)
+      {
+         const bool hit = (table[states[i] << 8 | events[i]] != FSM_FLEET_NONE);
+
+         changed[n] = i;
+         n += hit;
+         events[i] = hit ? events[i] : E_NO;
+      }
    }
 
-   return nextState;
+   // Run the handlers of the instances that take a transition
+   selected = FSM_GetContext();
+   FSM_SelectContext(&fleet->context);
+   for(uint32_t k = 0; k < n; k++)
+   {
+      const uint32_t i = changed[k];
+      const state_t from = states[i];
+      const event_t next = (event != E_NO) ? event : (event_t)fleet->event[i];
+      fsm_path_t local;
+      const fsm_path_t *path = FSM_Lookup(from, next, &local);
+
+      // Only the pending event that is taken is consumed, a broadcast event
+      // leaves it pending
+      if(event == E_NO)
+      {
+         fleet->event[i] = E_NO;
+      }
+      if(path->nof_exits == 0 && path->nof_entries == 0)
+      {
+         states[i] = path->to;
+         continue;
+      }
+
+      ctx->data = (fleet->data != NULL) ? fleet->data[i] : NULL;
+      atomic_store_explicit(&ctx->head, 0, memory_order_relaxed);
+      atomic_store_explicit(&ctx->claim, 0, memory_order_relaxed);
+      atomic_store_explicit(&ctx->tail, 0, memory_order_relaxed);
+      states[i] = FSM_EventHandler(from, next);
+
+      // There is no event loop to continue a run that stopped at a cycle
+      while(FSM_InternalEvents())
+      {
+         states[i] = FSM_EventHandler(states[i], E_NO);
+      }
+      if(!FSM_NoEvents() && fleet->event[i] == E_NO)
+      {
+         fleet->event[i] = (uint8_t)FSM_GetEvent();
+      }
+   }
+   FSM_SelectContext(selected);
+
+   return n;
+}
+
+void FSM_FreeFleet(fsm_fleet_t *fleet)
+{
+   free(fleet->state);
+   free(fleet->event);
+   free(fleet->changed);
+   free(fleet->table);
+   memset(fleet, 0, sizeof(fsm_fleet_t));
 }
 
 void FSM_FlushEnexpectedEvents(const bool flush)
@@ -91,6 +516,46 @@ void FSM_FlushEnexpectedEvents(const bool flush)
    flush_event = flush;
 }
 
+void FSM_SetEventHook(void (*hook)(const state_t state, const event_t event))
+{
+   event_hook = hook;
+}
+
+void FSM_SetIdleHook(void (*hook)(void))
+{
+   idle_hook = hook;
+}
+
+void FSM_SetWaitHook(void (*wait)(void), void (*wake)(void))
+{
+   wait_hook = wait;
+   wake_hook = wake;
+}
+
+void FSM_SetWatchdog(const event_t overrun,
+                     void (*hook)(const state_t state, const uint32_t us))
+{
+   overrun_event = overrun;
+   overrun_hook = hook;
+}
+
+uint32_t FSM_Overdue(const fsm_context_t *context)
+{
+   const uint32_t budget = atomic_load_explicit(&context->handler_budget,
+                                                memory_order_acquire);
+   uint32_t us;
+
+   if(budget == 0)
+   {
+      return 0;
+   }
+   // At least the start of the handler of budget
+   us = FSM_Microseconds() - atomic_load_explicit(&context->handler_start,
+                                                  memory_order_relaxed);
+   return (us > budget) ? us : 0;
+}
+
+#ifndef FSM_COMPACT
 void FSM_AddState(const state_t state, const state_funcs_t *funcs)
 {
    if(state >= MAX_STATES)
@@ -101,7 +566,11 @@ void FSM_AddState(const state_t state, const state_funcs_t *funcs)
 
    // Copy the state and save locally
    memcpy(&state_funcs[state], funcs, sizeof(state_funcs_t));
-   numOfStates++;
+   model_frozen = false;
+   if(state >= model_nof_states)
+   {
+      model_nof_states = state + 1;
+   }
 }
 
 void FSM_AddTransition(const transition_t *transition)
@@ -116,17 +585,128 @@ void FSM_AddTransition(const transition_t *transition)
    memcpy(&transitions[transition_cnt], transition, sizeof(transition_t));
 
    ++transition_cnt;
-   numOfTransitions++;
+   model_nof_transitions = transition_cnt;
+   model_frozen = false;
+}
+#endif
+
+void FSM_SetModel(const state_funcs_t funcs[], uint8_t nofStates,
+                  const transition_t table[], uint8_t nofTransitions)
+{
+   model_states = funcs;
+   model_nof_states = nofStates;
+   model_transitions = table;
+   model_nof_transitions = nofTransitions;
+   FSM_FreezeModel();
+}
+
+int FSM_FreezeModel(void)
+{
+   uint16_t count = 0;
+
+   free(dispatch);
+   free(paths);
+   dispatch = NULL;
+   paths = NULL;
+   nof_paths = 0;
+   model_frozen = true;
+
+   // The table covers the states of the model and all states and events of
+   // the transitions
+   dispatch_states = model_nof_states;
+   dispatch_events = 0;
+   for(uint8_t i = 0; i < model_nof_transitions; i++)
+   {
+      if(model_transitions[i].from >= dispatch_states)
+      {
+         dispatch_states = model_transitions[i].from + 1;
+      }
+      if(model_transitions[i].event >= dispatch_events)
+      {
+         dispatch_events = model_transitions[i].event + 1;
+      }
+   }
+   for(uint16_t s = S_NO + 1; s < model_nof_states; s++)
+   {
+      if(!FSM_Encloses(S_NO, (state_t)s))
+      {
+         // Error, nested too deep or a state encloses itself
+         return -1;
+      }
+   }
+
+   dispatch = calloc((size_t)dispatch_states * dispatch_events, sizeof(uint16_t));
+   if(dispatch == NULL)
+   {
+      return -1;
+   }
+   for(int pass = 0; pass < 2; pass++)
+   {
+      for(uint16_t s = 0; s < dispatch_states; s++)
+      {
+         for(uint16_t e = 0; e < dispatch_events; e++)
+         {
+            fsm_path_t path;
+
+            if(FSM_Resolve((state_t)s, (event_t)e, &path))
+            {
+               // Count the paths first, then store them
+               if(pass == 0)
+               {
+                  count++;
+               }
+               else
+               {
+                  paths[nof_paths++] = path;
+                  dispatch[s * dispatch_events + e] = nof_paths;
+               }
+            }
+         }
+      }
+      if(pass == 0 && count > 0 && (paths = malloc(count * sizeof(fsm_path_t))) == NULL)
+      {
+         free(dispatch);
+         dispatch = NULL;
+         return -1;
+      }
+   }
+   return 0;
+}
+
+void FSM_Footprint(size_t *ram, size_t *flash)
+{
+   *ram = sizeof(default_context);
+   if(dispatch != NULL)
+   {
+      *ram += (size_t)dispatch_states * dispatch_events * sizeof(uint16_t) +
+              nof_paths * sizeof(fsm_path_t);
+   }
+   *flash = 0;
+#ifndef FSM_COMPACT
+   *ram += sizeof(state_funcs) + sizeof(transitions);
+   if(model_states != state_funcs)
+   {
+      *flash += model_nof_states * sizeof(state_funcs_t);
+   }
+   if(model_transitions != transitions)
+   {
+      *flash += model_nof_transitions * sizeof(transition_t);
+   }
+#else
+   *flash += model_nof_states * sizeof(state_funcs_t) +
+             model_nof_transitions * sizeof(transition_t);
+#endif
 }
 
 event_t FSM_PeekForEvent(void)
 {
-   return events[head];
+   return ctx->events[atomic_load_explicit(&ctx->head, memory_order_acquire)];
 }
 
 bool FSM_NoEvents(void)
 {
-   return (head == tail);
+   return (atomic_load_explicit(&ctx->head, memory_order_acquire) ==
+           atomic_load_explicit(&ctx->tail, memory_order_relaxed));
 }
 
 event_t FSM_WaitForEvent(void)
@@ -139,6 +719,9 @@ event_t FSM_WaitForEvent(void)
 
 uint8_t FSM_NofEvents(void)
 {
+   uint8_t head = atomic_load_explicit(&ctx->head, memory_order_acquire);
+   uint8_t tail = atomic_load_explicit(&ctx->tail, memory_order_acquire);
+
    if(head == tail)
       return 0;
    else if(head > tail)
@@ -148,24 +731,85 @@ uint8_t FSM_NofEvents(void)
 }
 
 void FSM_AddEvent(const event_t event)
+{
+   // Other threads may add events at the same time, see FSM_AddEvents()
+   (void)FSM_AddEvents(&event, 1);
+}
+
+uint32_t FSM_AddEvents(const event_t events[], uint32_t n)
+{
+   uint8_t first = atomic_load_explicit(&ctx->claim, memory_order_relaxed);
+   uint8_t last;
+   uint8_t space;
+   uint32_t i;
+
+   // Claim the places, a producer on another thread may claim them first.
+   // Acquire tail so the consumer is done with the places
+   do
+   {
+      // Free places in the queue, the events that do not fit are flushed
+      space = (atomic_load_explicit(&ctx->tail, memory_order_acquire) - first - 1) &
+              MAX_EVENTS_IN_BUFFER_MASK;
+      if(space == 0)
+      {
+         return 0;
+      }
+      last = (first + ((n < space) ? n : space)) & MAX_EVENTS_IN_BUFFER_MASK;
+   }
+   while(!atomic_compare_exchange_weak_explicit(&ctx->claim, &first, last,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed));
+   n = (last - first) & MAX_EVENTS_IN_BUFFER_MASK;
+
+   // Store the events in the claimed places
+   for(i = 0; i < n; i++)
+   {
+      ctx->events[(first + 1 + i) & MAX_EVENTS_IN_BUFFER_MASK] = events[i];
+   }
+
+   // Earlier claims are published first, they are only a few stores away
+   // unless their thread was preempted, then give it the processor. Acquire,
+   // so their events are released again with our index
+   while(atomic_load_explicit(&ctx->head, memory_order_acquire) != first)
+   {
+#ifdef _WIN32
+      SwitchToThread();
+#else
+      sched_yield();
+#endif
+   }
+
+   // Save the new index once, release so the consumer sees the events with it
+   atomic_store_explicit(&ctx->head, last, memory_order_release);
+
+   // The event loop may sleep in the wait hook
+   if(wake_hook != NULL)
+   {
+      wake_hook();
+   }
+   return n;
+}
+
+void FSM_AddInternalEvent(const event_t event)
 {
    uint8_t tmpHead;
 
    // Calculate index
-   tmpHead = (head + 1) & MAX_EVENTS_IN_BUFFER_MASK;
+   tmpHead = (ctx->internal_head + 1) & MAX_INTERNAL_EVENTS_MASK;
 
-   // Check if queue is full
-   if(tmpHead == tail)
+   // Check if the channel is full
+   if(tmpHead == ctx->internal_tail)
    {
-      // Queue is full, flush the event
+      // Channel is full, fall back to the event buffer
+      FSM_AddEvent(event);
       return;
    }
 
-   // Store the event in the queue
-   events[tmpHead] = event;
+   // Store the event in the channel
+   ctx->internal_events[tmpHead] = event;
 
    // Save the new index
-   head = tmpHead;
+   ctx->internal_head = tmpHead;
 }
 
 event_t FSM_GetEvent(void)
@@ -176,28 +820,52 @@ event_t FSM_GetEvent(void)
    if(!FSM_NoEvents())
    {
       // Calculate index
-      tmpTail = (tail + 1) & MAX_EVENTS_IN_BUFFER_MASK;
+      tmpTail = (atomic_load_explicit(&ctx->tail, memory_order_relaxed) + 1) &
+                MAX_EVENTS_IN_BUFFER_MASK;
 
       // Get the event from the queue
-      event = events[tmpTail];
+      event = ctx->events[tmpTail];
 
-      // Store the new index
-      tail = tmpTail;
+      // Store the new index, release so the producer can reuse the place
+      atomic_store_explicit(&ctx->tail, tmpTail, memory_order_release);
    }
    return event;
 }
 
-// Update for version 0.2 ORO
-// Renamed state tot init_state, to make difference with global variable state.
-void FSM_RunStateMachine(state_t init_state, event_t start_event)
+uint8_t FSM_GetEvents(const fsm_event_t **events)
 {
-   extern event_t event;   // needs to be declared in main().
-   // Update for version 0.2 ORO
-   // Removed, since it is a global variable.
-   // state_t state;
+   uint8_t first = (atomic_load_explicit(&ctx->tail, memory_order_relaxed) + 1) &
+                   MAX_EVENTS_IN_BUFFER_MASK;
+   uint8_t n = FSM_NofEvents();
 
-   state = init_state;  // Important, otherwise the statetransitions won't work;
-   FSM_AddEvent(start_event);    // Machine is switched on
+   // The span ends at the end of the buffer, the rest starts at its begin
+   if(n > MAX_EVENTS_IN_BUFFER - first)
+   {
+      n = MAX_EVENTS_IN_BUFFER - first;
+   }
+   *events = &ctx->events[first];
+   return n;
+}
+
+void FSM_ReleaseEvents(uint8_t n)
+{
+   uint8_t nof_events = FSM_NofEvents();
+
+   if(n > nof_events)
+   {
+      n = nof_events;
+   }
+
+   // Store the new index once for all released events
+   atomic_store_explicit(&ctx->tail,
+                         (atomic_load_explicit(&ctx->tail, memory_order_relaxed) + n) &
+                         MAX_EVENTS_IN_BUFFER_MASK,
+                         memory_order_release);
+}
+
+static void FSM_EventLoop(void)
+{
+   extern event_t event;   // needs to be declared in main().
 
    while(1)
    {
@@ -205,28 +873,122 @@ void FSM_RunStateMachine(state_t init_state, event_t start_event)
       {
          // Get the event and handle it
          event = FSM_GetEvent();
-         state = FSM_EventHandler(state, event);
+         if(event_hook != NULL)
+         {
+            event_hook(FSM_GetState(), event);
+         }
+         FSM_EventHandler(FSM_GetState(), event);
+      }
+      else
+      {
+         if(idle_hook != NULL)
+         {
+            idle_hook();
+         }
+         if(FSM_InternalEvents())
+         {
+            // Continue the run to completion that stopped at a cycle, the
+            // hook records it as E_NO
+            if(event_hook != NULL)
+            {
+               event_hook(FSM_GetState(), E_NO);
+            }
+            FSM_EventHandler(FSM_GetState(), E_NO);
+         }
+         else if(wait_hook != NULL && FSM_NoEvents())
+         {
+            wait_hook();
+         }
+      }
+   }
+}
+
+// Update for version 0.2 ORO
+// Renamed state tot init_state, to make difference with global variable state.
+void FSM_RunStateMachine(state_t init_state, event_t start_event)
+{
+   FSM_SetState(init_state);  // Important, otherwise the statetransitions won't work;
+   FSM_AddEvent(start_event);    // Machine is switched on
+
+   FSM_EventLoop();
+}
+
+void FSM_ResumeStateMachine(void)
+{
+   state_t entries[MAX_DEPTH];
+   uint8_t nof_entries = 0;
+
+   // Enter the restored state and the states that enclose it again,
+   // outermost first, so a state that drives itself with internally
+   // generated events continues where it stopped
+   for(state_t s = FSM_GetState(); s != S_NO && nof_entries < MAX_DEPTH; s = FSM_Parent(s))
+   {
+      entries[nof_entries++] = s;
+   }
+   while(nof_entries > 0)
+   {
+      const state_t entry = entries[--nof_entries];
+
+      if(entry < model_nof_states && model_states[entry].onEntry != NULL)
+      {
+         FSM_Call(model_states[entry].onEntry, entry);
+      }
+   }
+   FSM_RunToCompletion();
+
+   FSM_EventLoop();
+}
+
+// Prints the states nested in *parent* as composite states
+static void FSM_RevertNesting(const state_t parent, const int depth)
+{
+   extern const char * const stateEnumToText[];
+
+   for(uint16_t s = S_NO + 1; s < model_nof_states && depth < MAX_DEPTH; s++)
+   {
+      bool composite = false;
+
+      if(FSM_Parent((state_t)s) != parent)
+      {
+         continue;
+      }
+      for(uint16_t child = S_NO + 1; child < model_nof_states; child++)
+      {
+         composite |= (FSM_Parent((state_t)child) == (state_t)s);
+      }
+      if(composite)
+      {
+         printf("%*sstate %s {\n", depth * 2, "", stateEnumToText[s]);
+         FSM_RevertNesting((state_t)s, depth + 1);
+         printf("%*s}\n", depth * 2, "");
+      }
+      else if(parent != S_NO)
+      {
+         printf("%*sstate %s\n", depth * 2, "", stateEnumToText[s]);
       }
    }
 }
 
 void FSM_RevertModel(void)
 {
-   extern int numOfStates;
-   extern int numOfTransitions;
-   extern transition_t transitions[];
-   extern char * stateEnumToText[];
-   extern char * eventEnumToText[];
+   extern const char * const stateEnumToText[];
+   extern const char * const eventEnumToText[];
+   const transition_t *table = model_transitions;
 
-   printf("Transition count: %i\n", numOfTransitions);
-   printf("States count: %i\n", numOfStates);
+   printf("Transition count: %i\n", model_nof_transitions);
+   printf("States count: %i\n", model_nof_states);
 
+   if(model_nof_transitions == 0)
+   {
+      return;
+   }
    printf("@startuml\n");
-   printf("[*] --> %s : %s\n", stateEnumToText[transitions[0].to],eventEnumToText[transitions[0].event]);
+   FSM_RevertNesting(S_NO, 0);
+   printf("[*] --> %s : %s\n", stateEnumToText[table[0].to],eventEnumToText[table[0].event]);
 
-   for (int i = 1; i < numOfTransitions; i++)
+   for (int i = 1; i < model_nof_transitions; i++)
    {
-      printf("%s --> %s : %s\n", stateEnumToText[transitions[i].from],stateEnumToText[transitions[i].to],eventEnumToText[transitions[i].event]);
+      printf("%s --> %s : %s\n", stateEnumToText[table[i].from],stateEnumToText[table[i].to],eventEnumToText[table[i].event]);
    }
    printf("@enduml\n");
 }
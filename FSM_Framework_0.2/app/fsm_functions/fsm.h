@@ -32,6 +32,7 @@
 #ifndef FSM_H_
 #define FSM_H_
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -41,21 +42,66 @@
 #define MAX_STATES           (20)
 #define MAX_TRANSITIONS      (20)
 #define MAX_EVENTS_IN_BUFFER (128) // 2,4,8,16,32,64,128 or 256
+#define MAX_INTERNAL_EVENTS  (8)   // 2,4,8,16,32,64,128 or 256
+#define MAX_DEPTH            (4)   // Nesting levels of hierarchical states
+#define MAX_RUN_TO_COMPLETION (16) // Internal events handled per event
+
+// Embedded profile: define FSM_COMPACT to store states and events in one
+// byte and to leave out the RAM copy of the model, see FSM_SetModel()
+#ifdef FSM_COMPACT
+typedef uint8_t fsm_state_t;   ///< Stored state_t, at most 256 states
+typedef uint8_t fsm_event_t;   ///< Stored event_t, at most 256 events
+#else
+typedef state_t fsm_state_t;
+typedef event_t fsm_event_t;
+#endif
 
 typedef struct 
 {
    void (*onEntry)(void);
    void (*onExit)(void);
+   uint32_t budget_us;   ///< Latency budget of each handler in us, 0 for none
+   fsm_state_t parent;   ///< Enclosing state, S_NO for a top level state
 }state_funcs_t;
 
 typedef struct
 {
-   state_t from;
-   event_t event;
-   state_t to;
+   fsm_state_t from;
+   fsm_event_t event;
+   fsm_state_t to;
 
 }transition_t;
 
+typedef struct
+{
+   fsm_state_t state;                                 ///< The current state
+   fsm_event_t events[MAX_EVENTS_IN_BUFFER];          ///< External event buffer
+   _Atomic uint8_t head;                              ///< Last added, written by the producers
+   _Atomic uint8_t tail;                              ///< Last taken, written by the consumer
+   _Atomic uint8_t claim;                             ///< Last place claimed by a producer
+   fsm_event_t internal_events[MAX_INTERNAL_EVENTS];  ///< Run-to-completion channel
+   uint8_t internal_head;
+   uint8_t internal_tail;
+   void *data;                                    ///< Application data of this instance
+   uint32_t handled;                              ///< Events handled, for telemetry
+   uint32_t overruns;                             ///< Handlers that exceeded their budget
+   _Atomic uint32_t handler_start;                ///< Start of the running handler in us
+   _Atomic uint32_t handler_budget;               ///< Its budget, 0 if none is running
+}fsm_context_t;
+
+#define FSM_FLEET_NONE (0xFF)   ///< No transition in the fleet table
+
+typedef struct
+{
+   uint32_t size;                 ///< Number of instances
+   uint8_t *state;                ///< Current state of each instance
+   uint8_t *event;                ///< Pending event of each instance, E_NO for none
+   void **data;                   ///< Application data of each instance, may be NULL
+   uint8_t *table;                ///< Next state, indexed by state << 8 | event
+   uint32_t *changed;             ///< Instances that took a transition in the last step
+   fsm_context_t context;         ///< Selected while the handlers of an instance run
+}fsm_fleet_t;
+
 // Function prototypes
 /*!
  * Handles the *event* with a transition to *state*
@@ -64,7 +110,8 @@ typedef struct
  *    Arguments:
  *
  *       state_t describes the target state tha belongs to the event
- *       event_t describes the event to handle
+ *       event_t describes the event to handle, E_NO only continues the
+ *        internal events, see FSM_AddInternalEvent()
  *
  *    Return value:
  *
@@ -91,19 +138,271 @@ typedef struct
  *       **funcs* a pointer to a structure describing the state functions
  *        the state_funcs_t uses functionpointers to an entry function and an exit function
  *
+ *        and the latency budget in us of each of them, 0 (the default) for
+ *        no budget, see FSM_SetWatchdog()
+ *
+ *        and the enclosing state, S_NO (the default) for a top level state,
+ *        see FSM_FreezeModel()
+ *
  *    Example:
  *
  *       FSM_AddState(S_INITIALISED_SUBSYSTEMS,&(state_funcs_t){S_InitialisedSubSystems_onEntry,S_InitialisedSubSystems_onExit});
+ *       FSM_AddState(S_HEAT,&(state_funcs_t){S_Heat_onEntry,NULL,20000});
+ *       FSM_AddState(S_HEAT,&(state_funcs_t){S_Heat_onEntry,NULL,0,S_ACTING});
 */
+/*!
+ * Uses constant tables as the FSM model, instead of the model built with
+ * FSM_AddState() and FSM_AddTransition(). The tables are not copied, so
+ * they can stay in flash. FSM_COMPACT builds only have this function.
+ *
+ *    Arguments:
+ *
+ *       *funcs* onEntry() and onExit() functions, indexed by state_t
+ *       *nofStates* number of entries in funcs
+ *       *table* the transitions, searched in order
+ *       *nofTransitions* number of transitions
+ *
+ *    Example:
+ *
+ *       static const state_funcs_t states[] = { [S_INIT] = { S_Init_onEntry, NULL } };
+ *       static const transition_t transitions[] = { { S_START, E_INIT, S_INIT } };
+ *
+ *       FSM_SetModel(states, 3, transitions, 1);
+ */
+/*!
+ * Compiles the model into a table with the transition of every state and
+ * event, so an event is dispatched without searching the transitions.
+ * FSM_SetModel() freezes the model, a model built with FSM_AddState() and
+ * FSM_AddTransition() is frozen by the first event it handles.
+ *
+ * States can be nested with the parent of state_funcs_t. A transition of a
+ * parent applies to all states nested in it that have no transition for
+ * the event themselves. A transition leaves the states up to the nearest
+ * state that encloses both its from and its to state, their onExit()
+ * functions are called innermost first, and enters the states from there
+ * down to the to state, onEntry() outermost first. The paths are computed
+ * here, not for every event. A transition to its own from state leaves and
+ * enters that state. A state with nested states can be the current state,
+ * its onEntry() can add the event to a nested state.
+ *
+ *    Return value:
+ *
+ *       0 on success, -1 if the states are nested deeper than MAX_DEPTH
+ *       or out of memory; the transitions are then searched for every
+ *       event
+ */
+/*!
+ * Reports the memory used by the FSM framework: *ram* is the model copy and
+ * the default instance, *flash* the constant model tables of FSM_SetModel().
+ * The compiled model of FSM_FreezeModel() is counted as RAM.
+ * An instance (fsm_context_t), including its event buffer, takes
+ * sizeof(fsm_context_t) bytes of RAM.
+ */
+/*!
+ * Adds an internally generated event to the run-to-completion channel.
+ * Use this from onEntry() and onExit() functions instead of FSM_AddEvent()
+ * for the event that drives the next transition.
+ *
+ * The events in this channel are dispatched by FSM_EventHandler() directly
+ * after the current handler returns, in the order they were added and before
+ * any event in the external event buffer. The external event buffer and the
+ * outer loop in FSM_RunStateMachine() are not touched.
+ *
+ * The run stops at a cycle, before an event would be handled in a state the
+ * run has passed, and after MAX_RUN_TO_COMPLETION events. The event loop
+ * then runs its idle hook and the pending external events, and continues
+ * the run with FSM_EventHandler(state, E_NO). A state that waits for the
+ * console and starts over thus does not block the event loop.
+ *
+ *    Arguments:
+ *
+ *       event_t describes the internal event
+ *
+ *    Example:
+ *
+ *       FSM_AddInternalEvent(E_RESET);
+ */
+/*!
+ * Initialises an FSM instance. An instance holds the runtime data of one
+ * state machine: the current state, the event buffer and the
+ * run-to-completion channel. The model (states and transitions) is shared by
+ * all instances.
+ *
+ *    Arguments:
+ *
+ *       *context* the instance to initialise
+ *       *data* application data bound to the instance, may be NULL
+ */
+/*!
+ * Initialises a fleet: *size* instances of the model stored as arrays
+ * (struct of arrays) instead of one fsm_context_t per instance. The
+ * transitions of the model are compiled into a table, so the model must be
+ * complete and must not change while the fleet is used. States and events
+ * are stored in one byte, the model may have at most 255 states.
+ *
+ *    Arguments:
+ *
+ *       *fleet* the fleet to initialise
+ *       *size* number of instances
+ *       *state* initial state of all instances
+ *       *data* application data of each instance, may be NULL
+ *
+ *    Return value:
+ *
+ *       0 on success, -1 if the model is too large or out of memory
+ */
+/*!
+ * Advances all instances of a fleet by one event. The transitions are
+ * looked up for all instances first; the handlers only run for the
+ * instances that take a transition, with the fleet context selected and its data
+ * set to the data of the instance. Internal events of the handlers are run
+ * to completion. A pending event stays pending when *event* is another
+ * event; the first event a handler adds with FSM_AddEvent() becomes the
+ * pending event of an instance without one. Events without a transition are
+ * flushed.
+ *
+ *    Arguments:
+ *
+ *       *event* the event for all instances, or E_NO for the pending event
+ *        of each instance
+ *
+ *    Return value:
+ *
+ *       the number of instances that took a transition, see fleet->changed
+ */
+/*!
+ * Selects the FSM instance used by all other FSM_ functions in the calling
+ * thread, a thread starts with the default instance. Passing NULL selects
+ * the default instance. The model is shared by all threads and must not
+ * change while they run.
+ *
+ *    Example:
+ *
+ *       FSM_SelectContext(&plant.fsm);
+ *       FSM_AddEvent(E_INIT);
+ */
+/*!
+ * Continues the state machine of the selected instance in its current state,
+ * e.g. after the instance was restored from a snapshot. The onEntry()
+ * function of the current state is executed again, the pending events are
+ * handled after that. The function does not return.
+ */
+/*!
+ * Sets a function that is called by the event loop for every event taken
+ * from the event buffer, just before it is handled. Used for recording the
+ * external input of the FSM. Passing NULL removes the hook.
+ *
+ *    Arguments:
+ *
+ *       state_t the current state
+ *       event_t the event that will be handled
+ */
+/*!
+ * Sets the functions that let the event loop sleep while the event buffer is
+ * empty, instead of calling the idle hook over and over. *wait* is called
+ * after the idle hook and may block until an event can be added, e.g. in
+ * epoll_wait(). *wake* is called by FSM_AddEvent(), also from other
+ * threads, and must end a blocked *wait*. Passing NULL removes the hooks.
+ * See RCTinitialise().
+ */
+/*!
+ * Sets the watchdog of the handler latency budgets. The onEntry() and
+ * onExit() functions of a state with a budget are timed; one that runs
+ * longer than the budget is an overrun. An overrun is counted in the
+ * instance, reported to *hook* and *overrun* is added to the event buffer,
+ * so it is recorded like every other event. States without a budget are
+ * not timed.
+ *
+ *    Arguments:
+ *
+ *       *overrun* event for an overrun, E_NO for none
+ *       *hook* called for an overrun with the state and the time of the
+ *        handler in us, may be NULL
+ */
+/*!
+ * Checks from another thread, e.g. a monitor, whether a handler of *context*
+ * is running longer than its budget. Unlike the watchdog of
+ * FSM_SetWatchdog() this also finds a handler that never returns.
+ *
+ *    Return value:
+ *
+ *       the time the handler is running in us, 0 if it is within its budget
+ */
+/*!
+ * Adds *n* events to the event buffer at once, for producers of many events
+ * such as a replay or a batch of samples. The index of the buffer is stored
+ * once and the wake hook is called once, so the event loop sees all events
+ * together. Events that do not fit are flushed, like with FSM_AddEvent().
+ * Like FSM_AddEvent() it may be called from several threads at the same
+ * time: each claims its places first and the events of the threads become
+ * visible in the order of their claims.
+ *
+ *    Return value:
+ *
+ *       the number of events added
+ */
+/*!
+ * Gets the oldest pending events as one span of the event buffer, without
+ * taking them out. The span ends at the end of the buffer, after
+ * FSM_ReleaseEvents() the next call returns the rest. A dispatcher handles
+ * the span and releases it with one store of the index.
+ *
+ * The event loop of FSM_RunStateMachine() takes the events one by one, its
+ * handlers may inspect the buffer, e.g. to take a snapshot.
+ *
+ *    Return value:
+ *
+ *       the number of events in *events*, 0 if the buffer is empty
+ *
+ *    Example:
+ *
+ *       const fsm_event_t *events;
+ *       uint8_t n;
+ *
+ *       while((n = FSM_GetEvents(&events)) > 0)
+ *       {
+ *          for(uint8_t i = 0; i < n; i++)
+ *             FSM_EventHandler(FSM_GetState(), events[i]);
+ *          FSM_ReleaseEvents(n);
+ *       }
+ */
+/*!
+ * Sets a function that is called by the event loop while the event buffer is
+ * empty, e.g. for resuming long running actions. The function must not block.
+ * Passing NULL removes the hook.
+ */
+void    FSM_InitContext(fsm_context_t *context, void *data);
+void    FSM_SelectContext(fsm_context_t *context);
+fsm_context_t *FSM_GetContext(void);
+int     FSM_InitFleet(fsm_fleet_t *fleet, uint32_t size, state_t state, void *data[]);
+uint32_t FSM_StepFleet(fsm_fleet_t *fleet, event_t event);
+void    FSM_FreeFleet(fsm_fleet_t *fleet);
 state_t FSM_EventHandler(const state_t state, const event_t event);
 void    FSM_FlushEnexpectedEvents(const bool flush);
+void    FSM_SetEventHook(void (*hook)(const state_t state, const event_t event));
+void    FSM_SetIdleHook(void (*hook)(void));
+void    FSM_SetWaitHook(void (*wait)(void), void (*wake)(void));
+void    FSM_SetWatchdog(const event_t overrun,
+                        void (*hook)(const state_t state, const uint32_t us));
+uint32_t FSM_Overdue(const fsm_context_t *context);
+#ifndef FSM_COMPACT
 void    FSM_AddState(const state_t state, const state_funcs_t *funcs);
 void    FSM_AddTransition(const transition_t *transition);
+#endif
+void    FSM_SetModel(const state_funcs_t funcs[], uint8_t nofStates,
+                     const transition_t table[], uint8_t nofTransitions);
+int     FSM_FreezeModel(void);
+void    FSM_Footprint(size_t *ram, size_t *flash);
 void    FSM_AddEvent(const event_t event);
+uint32_t FSM_AddEvents(const event_t events[], uint32_t n);
+void    FSM_AddInternalEvent(const event_t event);
 void    FSM_RunStateMachine(state_t init_state, event_t start_event);
+void    FSM_ResumeStateMachine(void);
 state_t FSM_GetState(void);
 
 event_t FSM_GetEvent(void);
+uint8_t FSM_GetEvents(const fsm_event_t **events);
+void    FSM_ReleaseEvents(uint8_t n);
 event_t FSM_WaitForEvent(void);
 event_t FSM_PeekForEvent(void);
 bool    FSM_NoEvents(void);
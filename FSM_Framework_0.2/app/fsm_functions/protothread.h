@@ -0,0 +1,69 @@
+#ifndef PROTOTHREAD_H
+#define PROTOTHREAD_H
+
+#include <stdint.h>
+
+//------------------------------------------------------------------ ProtoThread
+
+/// Stackless continuations for C. A protothread is a normal function that
+/// returns when it has to wait and continues after the wait on the next call.
+/// The position is kept in a pt_t, local variables are NOT kept: store them
+/// in the structure that holds the pt_t.
+///
+/// Rules: PT_ macros can only be used between PT_BEGIN() and PT_END() of the
+/// same function, not inside a switch statement of that function and at
+/// most one waiting PT_ macro per source line.
+///
+/// Example:
+///
+///    PT_THREAD(blink(blink_t *b))
+///    {
+///       PT_BEGIN(&b->pt);
+///       LEDon();
+///       PT_WAIT_UNTIL(&b->pt, timerExpired(b));
+///       LEDoff();
+///       PT_END(&b->pt);
+///    }
+
+/// Continuation of a protothread.
+typedef struct {
+   uint16_t lc;   ///< Line to continue at, 0 is the start
+} pt_t;
+
+/// Return values of a protothread.
+typedef enum {
+   PT_WAITING,    ///< Waiting, call again to continue
+   PT_ENDED,      ///< Finished
+} ptStatus_t;
+
+/// Declares a protothread function.
+#define PT_THREAD(declaration) ptStatus_t declaration
+
+/// Starts (again) at the beginning.
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+#define PT_BEGIN(pt) switch ((pt)->lc) { case 0:
+
+#define PT_END(pt) } PT_INIT(pt); return PT_ENDED
+
+/// Returns PT_WAITING until condition is true.
+/// The case label sits in an if (0) block, so the first pass does not fall
+/// through into it.
+#define PT_WAIT_UNTIL(pt, condition)          \
+   do {                                       \
+      (pt)->lc = __LINE__;                    \
+      if (0) { case __LINE__:; }              \
+      if (!(condition)) return PT_WAITING;    \
+   } while (0)
+
+/// Returns PT_WAITING once, continues on the next call.
+#define PT_YIELD(pt)                          \
+   do {                                       \
+      (pt)->lc = __LINE__;                    \
+      return PT_WAITING; case __LINE__:;      \
+   } while (0)
+
+/// Stops the protothread.
+#define PT_EXIT(pt) do { PT_INIT(pt); return PT_ENDED; } while (0)
+
+#endif
@@ -0,0 +1,348 @@
+#include "reactor.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+//---------------------------------------------------------------------- ReaCTor
+
+#ifdef __linux__
+
+#define RCT_MAX_READY 64   ///< Descriptors handled per epoll_wait()
+
+typedef enum {
+   RCT_FREE,
+   RCT_CALLBACK,
+   RCT_TIMER,
+   RCT_SIGNAL,
+   RCT_WAKE,
+} reactorKind_t;
+
+/// Registration of a descriptor, indexed by the descriptor
+typedef struct {
+   reactorCallback_t callback;
+   void *data;
+   event_t event;             ///< Event of a timer or signal
+   uint8_t kind;              ///< reactorKind_t
+} reactorEntry_t;
+
+static int epollFd = -1;
+static int wakeFd = -1;
+static reactorEntry_t *entries = NULL;
+static int nofEntries = 0;
+static int timeout = -1;
+static _Atomic int sleeping = 0;   ///< 1 while the event loop is in epoll_wait()
+
+static void waitHook(void)
+{
+   RCTwait(timeout);
+}
+
+/// Registers fd, grows the table to the descriptor
+static int watch(int fd, uint8_t kind, reactorCallback_t callback, void *data, event_t event)
+{
+   struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+
+   if (epollFd < 0 || fd < 0)
+   {
+      return -1;
+   }
+   if (fd >= nofEntries)
+   {
+      int size = (nofEntries == 0) ? 64 : nofEntries;
+      reactorEntry_t *grown;
+
+      while (size <= fd)
+      {
+         size *= 2;
+      }
+      grown = realloc(entries, size * sizeof(reactorEntry_t));
+      if (grown == NULL)
+      {
+         return -1;
+      }
+      for (int i = nofEntries; i < size; i++)
+      {
+         grown[i].kind = RCT_FREE;
+      }
+      entries = grown;
+      nofEntries = size;
+   }
+   if (entries[fd].kind != RCT_FREE || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+   {
+      return -1;
+   }
+   entries[fd].callback = callback;
+   entries[fd].data = data;
+   entries[fd].event = event;
+   entries[fd].kind = kind;
+   return 0;
+}
+
+int RCTinitialise(void)
+{
+   if (epollFd >= 0)
+   {
+      return 0;
+   }
+   epollFd = epoll_create1(EPOLL_CLOEXEC);
+   wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (epollFd < 0 || wakeFd < 0 || watch(wakeFd, RCT_WAKE, NULL, NULL, E_NO) != 0)
+   {
+      RCTterminate();
+      return -1;
+   }
+   FSM_SetWaitHook(waitHook, RCTwake);
+   return 0;
+}
+
+void RCTterminate(void)
+{
+   FSM_SetWaitHook(NULL, NULL);
+   for (int fd = 0; fd < nofEntries; fd++)
+   {
+      if (entries[fd].kind == RCT_TIMER || entries[fd].kind == RCT_SIGNAL)
+      {
+         close(fd);
+      }
+   }
+   free(entries);
+   entries = NULL;
+   nofEntries = 0;
+   if (wakeFd >= 0)
+   {
+      close(wakeFd);
+   }
+   if (epollFd >= 0)
+   {
+      close(epollFd);
+   }
+   wakeFd = -1;
+   epollFd = -1;
+   timeout = -1;
+}
+
+int RCTadd(int fd, reactorCallback_t callback, void *data)
+{
+   return (callback != NULL) ? watch(fd, RCT_CALLBACK, callback, data, E_NO) : -1;
+}
+
+int RCTremove(int fd)
+{
+   if (fd < 0 || fd >= nofEntries || entries[fd].kind == RCT_FREE)
+   {
+      return -1;
+   }
+   epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+   entries[fd].kind = RCT_FREE;
+   return 0;
+}
+
+int RCTaddTimer(uint32_t periodMs, event_t event)
+{
+   struct itimerspec period = {
+      .it_interval = { periodMs / 1000, (long)(periodMs % 1000) * 1000000L },
+      .it_value = { periodMs / 1000, (long)(periodMs % 1000) * 1000000L },
+   };
+   int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+   if (fd < 0)
+   {
+      return -1;
+   }
+   if (periodMs == 0 || timerfd_settime(fd, 0, &period, NULL) != 0 ||
+       watch(fd, RCT_TIMER, NULL, NULL, event) != 0)
+   {
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+int RCTaddSignal(int signal, event_t event)
+{
+   sigset_t set;
+   int fd;
+
+   // Threads started later inherit the blocked signal
+   sigemptyset(&set);
+   sigaddset(&set, signal);
+   if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0)
+   {
+      return -1;
+   }
+   fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+   if (fd < 0)
+   {
+      return -1;
+   }
+   if (watch(fd, RCT_SIGNAL, NULL, NULL, event) != 0)
+   {
+      close(fd);
+      return -1;
+   }
+   return fd;
+}
+
+void RCTsetTimeout(int timeoutMs)
+{
+   timeout = timeoutMs;
+}
+
+/// Runs the registration of a ready descriptor
+static void dispatch(int fd)
+{
+   reactorEntry_t *entry = &entries[fd];
+   event_t event = E_NO;
+   uint64_t count;
+   struct signalfd_siginfo info;
+
+   switch (entry->kind)
+   {
+      case RCT_CALLBACK:
+         event = entry->callback(fd, entry->data);
+         break;
+      case RCT_TIMER:
+         if (read(fd, &count, sizeof(count)) == sizeof(count))
+         {
+            event = entry->event;
+         }
+         break;
+      case RCT_SIGNAL:
+         if (read(fd, &info, sizeof(info)) == sizeof(info))
+         {
+            if (entry->event == E_NO)
+            {
+               exit(EXIT_SUCCESS);
+            }
+            event = entry->event;
+         }
+         break;
+      case RCT_WAKE:
+         if (read(fd, &count, sizeof(count)) < 0)
+         {
+            // Already reset by an earlier wait
+         }
+         break;
+      default:
+         // Removed by a callback of this round
+         break;
+   }
+   if (event != E_NO)
+   {
+      FSM_AddEvent(event);
+   }
+}
+
+int RCTwait(int timeoutMs)
+{
+   struct epoll_event ready[RCT_MAX_READY];
+   int n;
+
+   if (epollFd < 0)
+   {
+      return -1;
+   }
+
+   // Orders the store of sleeping before the check of the event buffer,
+   // RCTwake() does the opposite, so either we see the event or it wakes us
+   atomic_store(&sleeping, 1);
+   if (!FSM_NoEvents())
+   {
+      timeoutMs = 0;
+   }
+   n = epoll_wait(epollFd, ready, RCT_MAX_READY, timeoutMs);
+   atomic_store_explicit(&sleeping, 0, memory_order_relaxed);
+   if (n < 0)
+   {
+      return (errno == EINTR) ? 0 : -1;
+   }
+
+   for (int i = 0; i < n; i++)
+   {
+      dispatch(ready[i].data.fd);
+   }
+   return n;
+}
+
+void RCTwake(void)
+{
+   static const uint64_t one = 1;
+
+   atomic_thread_fence(memory_order_seq_cst);
+   if (atomic_load_explicit(&sleeping, memory_order_relaxed) != 0 &&
+       atomic_exchange_explicit(&sleeping, 0, memory_order_relaxed) != 0)
+   {
+      if (write(wakeFd, &one, sizeof(one)) < 0)
+      {
+         // The counter is already set, the loop wakes anyway
+      }
+   }
+}
+
+#else
+
+// No epoll, the event loop keeps calling the idle hook
+
+int RCTinitialise(void)
+{
+   return -1;
+}
+
+void RCTterminate(void)
+{
+}
+
+int RCTadd(int fd, reactorCallback_t callback, void *data)
+{
+   (void)fd;
+   (void)callback;
+   (void)data;
+   return -1;
+}
+
+int RCTremove(int fd)
+{
+   (void)fd;
+   return -1;
+}
+
+int RCTaddTimer(uint32_t periodMs, event_t event)
+{
+   (void)periodMs;
+   (void)event;
+   return -1;
+}
+
+int RCTaddSignal(int signal, event_t event)
+{
+   (void)signal;
+   (void)event;
+   return -1;
+}
+
+void RCTsetTimeout(int timeoutMs)
+{
+   (void)timeoutMs;
+}
+
+int RCTwait(int timeoutMs)
+{
+   (void)timeoutMs;
+   return -1;
+}
+
+void RCTwake(void)
+{
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fsm.h"
+
+//---------------------------------------------------------------------- ReaCTor
+
+/// The reactor lets the event loop sleep in one epoll_wait() on all input
+/// of the FSM: sensor pipes, timers, signals, sockets. A callback per file
+/// descriptor translates its input into FSM events. Events added from other
+/// threads, e.g. by an error notification, wake the loop through an eventfd,
+/// which is written only while the loop sleeps.
+///
+/// The reactor uses the wait hook of the FSM, see FSM_SetWaitHook(). The
+/// callbacks run in the thread of the event loop, between two events.
+/// The reactor needs Linux (epoll, timerfd, signalfd), elsewhere
+/// RCTinitialise() fails and the event loop calls the idle hook as before.
+
+/// Translates the input of fd into FSM events, it must read the input or fd
+/// stays ready. The callback adds the events itself or returns one.
+/// \return the event to add, E_NO for none.
+typedef event_t (*reactorCallback_t)(int fd, void *data);
+
+/// Creates the epoll instance and installs the wait hook.
+/// \return 0 on success, -1 on error or if the platform has no epoll.
+int RCTinitialise(void);
+
+/// Closes the timers, signals and the epoll instance, removes the wait hook.
+/// Other registered descriptors are not closed.
+void RCTterminate(void);
+
+/// Calls callback when fd is readable.
+/// \return 0 on success, -1 on error or if fd is registered.
+int RCTadd(int fd, reactorCallback_t callback, void *data);
+
+/// Stops watching fd, does not close it.
+/// \return 0 on success, -1 if fd is not registered.
+int RCTremove(int fd);
+
+/// Adds event every periodMs, E_NO only wakes the event loop so the idle
+/// hook runs. Expirations missed while the FSM was busy add one event.
+/// \return the timerfd, -1 on error.
+int RCTaddTimer(uint32_t periodMs, event_t event);
+
+/// Adds event when signal arrives instead of running a handler, the signal
+/// is blocked in the calling thread. E_NO calls exit(). Call it before other
+/// threads are started, they inherit the blocked signal.
+/// \return the signalfd, -1 on error.
+int RCTaddSignal(int signal, event_t event);
+
+/// Sets the longest sleep of the event loop, -1 sleeps until input arrives.
+void RCTsetTimeout(int timeoutMs);
+
+/// Waits at most timeoutMs for input and runs the callbacks of the ready
+/// descriptors. The wait hook calls it with the timeout of RCTsetTimeout().
+/// \return the number of ready descriptors, -1 on error.
+int RCTwait(int timeoutMs);
+
+/// Ends RCTwait(), safe from any thread.
+void RCTwake(void);
+
+#endif
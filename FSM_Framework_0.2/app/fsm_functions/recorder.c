@@ -0,0 +1,327 @@
+#include "recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//--------------------------------------------------------------------- RECorder
+
+#define REC_MAGIC "PREC"
+#define REC_VERSION 1
+#define REC_BUFFER_SIZE (64 * 1024)
+#define REC_FLUSH_US (100000) ///< Maximal age of buffered records
+
+/// Record types, each record: type, delta time (varint, us), payload.
+typedef enum {
+   REC_EVENT,     ///< Payload: state, event
+   REC_INT,       ///< Payload: zigzag varint
+   REC_FLOAT,     ///< Payload: 4 bytes
+} recordType_t;
+
+static FILE *logFile = NULL;
+static uint8_t buffer[REC_BUFFER_SIZE];
+static size_t used = 0;
+static uint64_t lastUs = 0;
+static uint64_t flushUs = 0;
+
+static bool replaying = false;
+static const uint8_t *replayPos = NULL;
+static const uint8_t *replayEnd = NULL;
+static uint64_t replayUs = 0;
+static replayStats_t *replayStats = NULL;
+
+static uint64_t nowUs(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint64_t)now.tv_sec * 1000000u + now.tv_nsec / 1000;
+}
+
+static uint8_t *putVarint(uint8_t *p, uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      *p++ = (uint8_t)(value | 0x80);
+      value >>= 7;
+   }
+   *p++ = (uint8_t)value;
+   return p;
+}
+
+static const uint8_t *getVarint(const uint8_t *p, uint64_t *value)
+{
+   uint64_t result = 0;
+   int shift = 0;
+
+   while (p < replayEnd && shift < 64)
+   {
+      uint8_t byte = *p++;
+
+      result |= (uint64_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+      {
+         *value = result;
+         return p;
+      }
+      shift += 7;
+   }
+   return NULL;
+}
+
+/// Starts a record, flushes the buffer if a record might not fit.
+static uint8_t *beginRecord(recordType_t type)
+{
+   uint64_t us = nowUs();
+   uint8_t *p;
+
+   if (used + 32 > REC_BUFFER_SIZE || us - flushUs > REC_FLUSH_US)
+   {
+      fwrite(buffer, 1, used, logFile);
+      fflush(logFile);
+      used = 0;
+      flushUs = us;
+   }
+   p = &buffer[used];
+   *p++ = (uint8_t)type;
+   p = putVarint(p, us - lastUs);
+   lastUs = us;
+   return p;
+}
+
+static void endRecord(uint8_t *p)
+{
+   used = p - buffer;
+}
+
+static void recordEvent(const state_t state, const event_t event)
+{
+   uint8_t *p = beginRecord(REC_EVENT);
+
+   *p++ = (uint8_t)state;
+   *p++ = (uint8_t)event;
+   endRecord(p);
+}
+
+int RECstartRecording(const char path[])
+{
+   logFile = fopen(path, "wb");
+   if (logFile == NULL)
+   {
+      return -1;
+   }
+   memcpy(buffer, REC_MAGIC, 4);
+   buffer[4] = REC_VERSION;
+   used = 5;
+   lastUs = nowUs();
+   flushUs = lastUs;
+   FSM_SetEventHook(recordEvent);
+   return 0;
+}
+
+void RECstopRecording(void)
+{
+   if (logFile != NULL)
+   {
+      FSM_SetEventHook(NULL);
+      fwrite(buffer, 1, used, logFile);
+      fclose(logFile);
+      logFile = NULL;
+      used = 0;
+   }
+}
+
+/// Reads the next record header.
+/// \return the record type, -1 at the end of the log or on an invalid record.
+static int nextRecord(void)
+{
+   uint64_t delta;
+   const uint8_t *p;
+
+   if (replayPos >= replayEnd)
+   {
+      return -1;
+   }
+   p = getVarint(replayPos + 1, &delta);
+   if (p == NULL)
+   {
+      return -1;
+   }
+   replayUs += delta;
+   return *replayPos;
+}
+
+/// Skips the type and delta time of the current record.
+static const uint8_t *payload(void)
+{
+   uint64_t delta;
+
+   return getVarint(replayPos + 1, &delta);
+}
+
+int RECreplay(const char path[], replayStats_t *stats)
+{
+   FILE *file = fopen(path, "rb");
+   uint8_t *data;
+   long size;
+   state_t state = S_NO;
+   bool first = true;
+
+   if (file == NULL)
+   {
+      return -1;
+   }
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   data = malloc(size > 0 ? size : 1);
+   if (data == NULL || size < 5 || fread(data, 1, size, file) != (size_t)size ||
+       memcmp(data, REC_MAGIC, 4) != 0 || data[4] != REC_VERSION)
+   {
+      free(data);
+      fclose(file);
+      return -1;
+   }
+   fclose(file);
+
+   memset(stats, 0, sizeof(replayStats_t));
+   replayStats = stats;
+   replayPos = data + 5;
+   replayEnd = data + size;
+   replayUs = 0;
+   replaying = true;
+
+   while (replayPos < replayEnd)
+   {
+      const uint8_t *p;
+      int type = nextRecord();
+
+      if (type != REC_EVENT)
+      {
+         // Invalid record, or input that was not read by a state function
+         if (type < 0)
+         {
+            break;
+         }
+         stats->divergences++;
+         p = payload();
+         replayPos = (type == REC_FLOAT) ? p + 4 : getVarint(p, &(uint64_t){0});
+         if (replayPos == NULL)
+         {
+            break;
+         }
+         continue;
+      }
+
+      p = payload();
+      if (p == NULL || replayEnd - p < 2)
+      {
+         break;
+      }
+      if ((state_t)p[0] != state && !first)
+      {
+         stats->divergences++;
+      }
+      first = false;
+      replayPos = p + 2;
+
+      // The event buffer is not used, events posted during the handling are
+      // part of the log
+      FSM_ReleaseEvents(FSM_NofEvents());
+      state = FSM_EventHandler((state_t)p[0], (event_t)p[1]);
+      stats->events++;
+   }
+   FSM_ReleaseEvents(FSM_NofEvents());
+
+   stats->ms = (uint32_t)(replayUs / 1000);
+   replaying = false;
+   replayStats = NULL;
+   free(data);
+   return 0;
+}
+
+bool RECreplaying(void)
+{
+   return replaying;
+}
+
+/// \return the payload of the next record if it is of type, NULL otherwise.
+static const uint8_t *replayInput(recordType_t type)
+{
+   uint64_t us = replayUs;
+   const uint8_t *p;
+
+   if (replayPos >= replayEnd)
+   {
+      // The recording stopped while waiting for this input
+      return NULL;
+   }
+   if (nextRecord() != (int)type || (p = payload()) == NULL)
+   {
+      // Input not in the log at this point, the execution diverges
+      replayUs = us;
+      replayStats->divergences++;
+      return NULL;
+   }
+   replayStats->inputs++;
+   return p;
+}
+
+int32_t RECinputInt(int32_t value)
+{
+   if (replaying)
+   {
+      const uint8_t *p = replayInput(REC_INT);
+      uint64_t zigzag;
+
+      if (p != NULL && (p = getVarint(p, &zigzag)) != NULL)
+      {
+         replayPos = p;
+         value = (int32_t)((zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+      }
+   }
+   else if (logFile != NULL)
+   {
+      uint8_t *p = beginRecord(REC_INT);
+
+      endRecord(putVarint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31)));
+   }
+   return value;
+}
+
+float RECinputFloat(float value)
+{
+   if (replaying)
+   {
+      const uint8_t *p = replayInput(REC_FLOAT);
+
+      if (p != NULL && replayEnd - p >= 4)
+      {
+         memcpy(&value, p, 4);
+         replayPos = p + 4;
+      }
+   }
+   else if (logFile != NULL)
+   {
+      uint8_t *p = beginRecord(REC_FLOAT);
+
+      memcpy(p, &value, 4);
+      endRecord(p + 4);
+   }
+   return value;
+}
+
+sensorValue_t RECinputValue(sensorValue_t value)
+{
+#ifdef SENSOR_FIXED
+   return RECinputInt(value);
+#else
+   return RECinputFloat(value);
+#endif
+}
+
+uint32_t RECtime(uint32_t now)
+{
+   return replaying ? (uint32_t)(replayUs / 1000) : now;
+}
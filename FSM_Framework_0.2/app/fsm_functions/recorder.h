@@ -0,0 +1,62 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fsm.h"
+#include "sensor_functions/sensorValue.h"
+
+//--------------------------------------------------------------------- RECorder
+
+/// The recorder captures all external input of the FSM in a binary log:
+/// - every event the event loop takes from the event buffer, with the state it
+///   is handled in, so the interleaving of posted events is captured exactly,
+/// - every value read by an event function, see RECinputInt() and
+///   RECinputFloat() and RECinputValue(),
+/// - the time of each record, as a delta in microseconds.
+///
+/// Replay runs the log without the event loop and without the console, as
+/// fast as possible. Internally generated events are not recorded, they are
+/// generated again by the state functions during replay.
+
+/// Replay result.
+typedef struct {
+   long events;       ///< Number of handled events
+   long inputs;       ///< Number of input values used
+   long divergences;  ///< Number of records that did not match the execution
+   uint32_t ms;       ///< Recorded time span of the log
+} replayStats_t;
+
+/// Starts recording to path, installs the FSM event hook.
+/// \return 0 on success, -1 if path cannot be created.
+int RECstartRecording(const char path[]);
+
+/// Writes the remaining records and closes the log.
+void RECstopRecording(void);
+
+/// Replays the log in path on the selected FSM instance.
+/// The FSM model must be defined, the state functions use the recorded input.
+/// \return 0 on success, -1 if path is not a valid log.
+int RECreplay(const char path[], replayStats_t *stats);
+
+/// \return true while a log is replayed, event functions must not read the
+/// console then.
+bool RECreplaying(void);
+
+/// Records value while recording, returns the recorded value while
+/// replaying, otherwise returns value.
+int32_t RECinputInt(int32_t value);
+
+/// Records value while recording, returns the recorded value while
+/// replaying, otherwise returns value.
+float RECinputFloat(float value);
+
+/// Records a sensor value, as int in the fixed point build, see
+/// RECinputFloat().
+sensorValue_t RECinputValue(sensorValue_t value);
+
+/// \return the recorded time in ms while replaying, otherwise now.
+uint32_t RECtime(uint32_t now);
+
+#endif
@@ -0,0 +1,71 @@
+#include "hal.h"
+
+//------------------------------------------------------ Hardware Abstraction Layer
+
+static const halBackend_t *bus = NULL;
+static halCommand_t commands[HAL_COMMAND_QUEUE];
+static size_t nofCommands = 0;
+
+void HALinitialise(const halBackend_t *backend)
+{
+   bus = backend;
+   nofCommands = 0;
+}
+
+int HALreadChannel(uint32_t plant, channel_t channel, sensorValue_t *value)
+{
+   sensorValue_t values[1][CH_NOF_CHANNELS];
+   int result = bus->read(&plant, 1, 1u << channel, values);
+
+   // value is kept on a bus error
+   if (result == 0)
+   {
+      *value = values[0][channel];
+   }
+   return result;
+}
+
+int HALreadPlant(uint32_t plant, sensorValue_t values[CH_NOF_CHANNELS])
+{
+   return bus->read(&plant, 1, HAL_ALL_CHANNELS, (sensorValue_t (*)[CH_NOF_CHANNELS])values);
+}
+
+int HALreadRack(const uint32_t plants[], size_t n, sensorValue_t values[][CH_NOF_CHANNELS])
+{
+   return bus->read(plants, n, HAL_ALL_CHANNELS, values);
+}
+
+int HALreadChannels(const uint32_t plants[], size_t n, uint8_t channelMask,
+                    sensorValue_t values[][CH_NOF_CHANNELS])
+{
+   return bus->read(plants, n, channelMask, values);
+}
+
+void HALcommand(uint32_t plant, halActuator_t actuator, int value)
+{
+   if (nofCommands == HAL_COMMAND_QUEUE)
+   {
+      HALflush();
+   }
+   commands[nofCommands].plant = plant;
+   commands[nofCommands].actuator = (uint8_t)actuator;
+   commands[nofCommands].value = (int16_t)value;
+   nofCommands++;
+}
+
+int HALflush(void)
+{
+   int result = 0;
+
+   if (nofCommands > 0)
+   {
+      result = bus->write(commands, nofCommands);
+      nofCommands = 0;
+   }
+   return result;
+}
+
+size_t HALpending(void)
+{
+   return nofCommands;
+}
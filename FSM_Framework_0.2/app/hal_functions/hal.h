@@ -0,0 +1,83 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensor_functions/sensorValue.h"
+
+//------------------------------------------------------ Hardware Abstraction Layer
+
+/// All sensor and actuator IO of the plant modules goes through the HAL.
+/// A backend does the bus transactions: one read transaction can read any
+/// channels of any number of plants, one write transaction sends a batch of
+/// actuator commands. Actuator commands are queued and sent by HALflush(),
+/// or when the queue is full.
+
+#define HAL_COMMAND_QUEUE 256 ///< Maximal number of queued actuator commands
+
+/// Actuators of a plant module.
+typedef enum {
+   HAL_LIGHT,        ///< Status light, 0 green, 1 orange, 2 red
+   HAL_WINDOW,       ///< 1 open, 0 closed
+   HAL_PUMP,         ///< 1 on, 0 off
+   HAL_HEATER,       ///< 1 on, 0 off
+   HAL_ERRORLOG,     ///< Error code to log
+   HAL_NOF_ACTUATORS,
+} halActuator_t;
+
+/// One actuator command.
+typedef struct {
+   uint32_t plant;
+   uint8_t actuator;    ///< halActuator_t
+   int16_t value;
+} halCommand_t;
+
+/// Bus transactions of a backend.
+typedef struct {
+   /// Reads the channels in channelMask (bit per channel_t) of n plants in
+   /// one transaction. Channels not in the mask are not changed.
+   /// \return 0 on success, -1 on a bus error.
+   int (*read)(const uint32_t plants[], size_t n, uint8_t channelMask,
+               sensorValue_t values[][CH_NOF_CHANNELS]);
+   /// Sends n commands in one transaction.
+   /// \return 0 on success, -1 on a bus error.
+   int (*write)(const halCommand_t commands[], size_t n);
+} halBackend_t;
+
+/// Mask for all channels of a plant.
+#define HAL_ALL_CHANNELS ((uint8_t)((1u << CH_NOF_CHANNELS) - 1))
+
+/// Initialises the HAL with backend, clears the command queue.
+void HALinitialise(const halBackend_t *backend);
+
+/// Reads one channel of one plant, one transaction. value is only written
+/// on success.
+/// \return 0 on success, -1 on a bus error.
+int HALreadChannel(uint32_t plant, channel_t channel, sensorValue_t *value);
+
+/// Reads all channels of one plant, one transaction.
+/// \return 0 on success, -1 on a bus error.
+int HALreadPlant(uint32_t plant, sensorValue_t values[CH_NOF_CHANNELS]);
+
+/// Reads all channels of n plants (a rack), one transaction.
+/// \return 0 on success, -1 on a bus error.
+int HALreadRack(const uint32_t plants[], size_t n, sensorValue_t values[][CH_NOF_CHANNELS]);
+
+/// Reads the channels in channelMask of n plants, one transaction.
+/// \return 0 on success, -1 on a bus error.
+int HALreadChannels(const uint32_t plants[], size_t n, uint8_t channelMask,
+                    sensorValue_t values[][CH_NOF_CHANNELS]);
+
+/// Queues an actuator command. The queue is flushed when it is full.
+void HALcommand(uint32_t plant, halActuator_t actuator, int value);
+
+/// Sends all queued commands in one transaction.
+/// \return 0 on success or empty queue, -1 on a bus error.
+int HALflush(void);
+
+/// \return the number of queued commands.
+size_t HALpending(void);
+
+#endif
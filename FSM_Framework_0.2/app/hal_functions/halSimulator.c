@@ -0,0 +1,138 @@
+#include "halSimulator.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+//------------------------------------------------------------- HAL SIMulator
+
+#define HSIM_HEADER_BYTES 4   ///< Address, function, length and checksum
+#define HSIM_PLANT_BYTES 2    ///< Plant address in a read request
+#define HSIM_VALUE_BYTES 2    ///< One raw sensor value
+#define HSIM_COMMAND_BYTES 4  ///< One actuator command
+
+static int16_t (*sensors)[CH_NOF_CHANNELS] = NULL;   ///< Raw, 0.1 units
+static int16_t (*actuators)[HAL_NOF_ACTUATORS] = NULL;
+static size_t plants = 0;
+static halBusModel_t bus = {0};
+static halStats_t stats = {0};
+
+/// Accounts one transaction on the simulated bus.
+static void transfer(size_t bytes)
+{
+   uint64_t us = bus.transactionUs + (uint64_t)bytes * bus.byteUs;
+
+   stats.transactions++;
+   stats.bytes += bytes;
+   stats.busUs += us;
+
+   if (bus.realTime && us > 0)
+   {
+      struct timespec start;
+      struct timespec now;
+
+      // Busy wait, sleeping is far too coarse for bus timing
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      do
+      {
+         clock_gettime(CLOCK_MONOTONIC, &now);
+      } while ((uint64_t)((now.tv_sec - start.tv_sec) * 1000000 +
+                          (now.tv_nsec - start.tv_nsec) / 1000) < us);
+   }
+}
+
+static int simulatorRead(const uint32_t ids[], size_t n, uint8_t channelMask,
+                         sensorValue_t values[][CH_NOF_CHANNELS])
+{
+   size_t nofChannels = 0;
+
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      nofChannels += (channelMask >> ch) & 1;
+   }
+   transfer(2 * HSIM_HEADER_BYTES + n * (HSIM_PLANT_BYTES + nofChannels * HSIM_VALUE_BYTES));
+
+   for (size_t i = 0; i < n; i++)
+   {
+      if (ids[i] >= plants)
+      {
+         return -1;
+      }
+      for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+      {
+         if (channelMask & (1u << ch))
+         {
+            values[i][ch] = VAL_FROM_TENTHS(sensors[ids[i]][ch]);
+         }
+      }
+   }
+   return 0;
+}
+
+static int simulatorWrite(const halCommand_t commands[], size_t n)
+{
+   int result = 0;
+
+   transfer(2 * HSIM_HEADER_BYTES + n * HSIM_COMMAND_BYTES);
+
+   for (size_t i = 0; i < n; i++)
+   {
+      if (commands[i].plant >= plants || commands[i].actuator >= HAL_NOF_ACTUATORS)
+      {
+         result = -1;
+         continue;
+      }
+      actuators[commands[i].plant][commands[i].actuator] = commands[i].value;
+   }
+   return result;
+}
+
+static const halBackend_t simulator = {simulatorRead, simulatorWrite};
+
+const halBackend_t *HALsimulator(size_t nofPlants, const halBusModel_t *model)
+{
+   free(sensors);
+   free(actuators);
+   sensors = malloc(nofPlants * sizeof(*sensors));
+   actuators = calloc(nofPlants, sizeof(*actuators));
+   if (sensors == NULL || actuators == NULL)
+   {
+      plants = 0;
+      return NULL;
+   }
+   for (size_t i = 0; i < nofPlants; i++)
+   {
+      for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+      {
+         sensors[i][ch] = 225;
+      }
+   }
+   plants = nofPlants;
+   bus = *model;
+   stats = (halStats_t){0};
+   return &simulator;
+}
+
+void HALsimulatorSetSensor(uint32_t plant, channel_t channel, sensorValue_t value)
+{
+   if (plant < plants)
+   {
+      // Clip to the raw range, round to the 0.1 resolution of the sensor
+      value = value > VAL(3276.7) ? VAL(3276.7) : value;
+      value = value < VAL(-3276.8) ? VAL(-3276.8) : value;
+      sensors[plant][channel] = (int16_t)VAL_TO_TENTHS(value);
+   }
+}
+
+int HALsimulatorActuator(uint32_t plant, halActuator_t actuator)
+{
+   return plant < plants ? actuators[plant][actuator] : 0;
+}
+
+void HALsimulatorStats(halStats_t *copy, bool reset)
+{
+   *copy = stats;
+   if (reset)
+   {
+      stats = (halStats_t){0};
+   }
+}
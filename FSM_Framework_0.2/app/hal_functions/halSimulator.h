@@ -0,0 +1,46 @@
+#ifndef HALSIMULATOR_H
+#define HALSIMULATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+
+//------------------------------------------------------------- HAL SIMulator
+
+/// Local HAL backend, simulates the sensors and actuators of a number of plant
+/// modules on a shared bus. Every transaction costs
+///    transactionUs + (request + response bytes) * byteUs
+/// of simulated bus time. Sensors return 16 bit raw values (0.1 units) on
+/// the bus, commands take 4 bytes.
+
+/// Bus latency model.
+typedef struct {
+   uint32_t transactionUs;    ///< Fixed cost of one transaction (addressing, turnaround)
+   uint32_t byteUs;           ///< Cost of one byte on the bus
+   bool realTime;             ///< Wait the simulated bus time for real
+} halBusModel_t;
+
+/// Bus statistics.
+typedef struct {
+   uint64_t transactions;
+   uint64_t bytes;
+   uint64_t busUs;            ///< Simulated bus time
+} halStats_t;
+
+/// Creates the simulator for plants 0 .. nofPlants-1.
+/// All sensors start at 22.5, all actuators at 0.
+/// \return the backend for HALinitialise(), NULL on out of memory.
+const halBackend_t *HALsimulator(size_t nofPlants, const halBusModel_t *model);
+
+/// Sets the simulated value of a sensor, e.g. entered by the user.
+void HALsimulatorSetSensor(uint32_t plant, channel_t channel, sensorValue_t value);
+
+/// \return the last value written to an actuator.
+int HALsimulatorActuator(uint32_t plant, halActuator_t actuator);
+
+/// Copies the bus statistics, reset resets them afterwards.
+void HALsimulatorStats(halStats_t *stats, bool reset);
+
+#endif
@@ -22,23 +22,50 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
 
 /// Finite State Machine Library
 #include "fsm_functions/fsm.h"
+#include "fsm_functions/reactor.h"
 
 /// Development Console Library
 #include "console_functions/keyboard.h"
 #include "console_functions/display.h"
 #include "console_functions/devConsole.h"
+#include "console_functions/control.h"
+
+/// Plant Module Library
+#include "plant_functions/plant.h"
+#include "plant_functions/snapshot.h"
+#include "plant_functions/actuator.h"
+#include "plant_functions/arbiter.h"
+#include "plant_functions/profile.h"
+#include "plant_functions/telemetry.h"
+#include "plant_functions/montecarlo.h"
+
+/// Hardware Abstraction Layer, simulated
+#include "hal_functions/hal.h"
+#include "hal_functions/halSimulator.h"
+#include "fsm_functions/recorder.h"
+#include "appInfo.h"
+
+/// Sensor log ingest, for backtesting
+#include "sensor_functions/ingest.h"
+#include "sensor_functions/filter.h"
+#include "sensor_functions/history.h"
+#include "sensor_functions/ingress.h"
+#include "sensor_functions/sampler.h"
 
 /// Prototypes and Variables
 #include "prototypes.h"
 #include "variables.h"
 
 /// External Enum
-extern char * eventEnumToText[];
-extern char * stateEnumToText[];
-extern char * lightStateEnumToText[];
+extern const char * const eventEnumToText[];
+extern const char * const stateEnumToText[];
+extern const char * const lightStateEnumToText[];
 
 /// Add event and state variables
 event_t event;
@@ -55,6 +82,8 @@ event_t EF_WAITINPUT(void);
 event_t EF_CO2LOW(void);
 event_t EF_MOISTURELOW(void);
 event_t EF_TOOCOLD(void);
+sensorValue_t EF_readSensor(channel_t channel, const char name[]);
+event_t EF_classify(plant_t *plant, channel_t channel, sensorValue_t value);
 
 //HAL functions
 void ChangeLight(int);
@@ -63,48 +92,645 @@ void OpenWindow(void);
 void Moisturize(void);
 void HeatPlant(void);
 
+//Actuator actions, protothreads started by the action states
+PT_THREAD(AirflowAction(actuation_t *act));
+PT_THREAD(MoisturizeAction(actuation_t *act));
+PT_THREAD(HeatAction(actuation_t *act));
+
+
+/// Define the state machine model
+/// First the state, the pointers to the onEntry and onExit functions, the
+/// latency budget of the states that must not block and the enclosing state.
+/// S_PROCESSING encloses checking an input and the actions it starts, its
+/// transitions apply to all of them.
+static const state_funcs_t plantStates[] = {
+   //  State                  onEntry()                   onExit()            Budget (us)         Parent
+   [S_START]          = {  NULL,                    NULL,               0,                  S_NO          },
+   [S_INIT]           = {  S_Init_onEntry,          S_Init_onExit,      0,                  S_NO          },
+   [S_WAITINPUT]      = {  S_waitinput_onEntry,     NULL,               0,                  S_NO          },
+   [S_CHECKCHANGE]    = {  S_checkchange_onEntry,   NULL,               0,                  S_PROCESSING  },
+   [S_LOGERROR]       = {  S_logerror_onEntry,      NULL,               ACTION_BUDGET_US,   S_NO          },
+   [S_AIRFLOW]        = {  S_airflow_onEntry,       NULL,               ACTION_BUDGET_US,   S_PROCESSING  },
+   [S_MOISTURIZE]     = {  S_moisturize_onEntry,    NULL,               ACTION_BUDGET_US,   S_PROCESSING  },
+   [S_HEAT]           = {  S_heat_onEntry,          NULL,               ACTION_BUDGET_US,   S_PROCESSING  },
+   [S_PROCESSING]     = {  NULL,                    NULL,               0,                  S_NO          },
+};
+
+/// Define the state transistions
+static const transition_t plantTransitions[] = {
+   //  From            Event                To
+   { S_START,        E_INIT,              S_INIT           },
+   { S_INIT,         E_INITSUCCES,        S_WAITINPUT      },
+   { S_WAITINPUT,    E_INPUTCHANGED,      S_CHECKCHANGE    },
+   { S_CHECKCHANGE,  E_NOACTION,          S_WAITINPUT      },
+   { S_CHECKCHANGE,  E_OUTSIDEBOUNDS,     S_LOGERROR       },
+   { S_LOGERROR,     E_ERRORLOGGED,       S_INIT           },
+   { S_CHECKCHANGE,  E_CO2LOW,            S_AIRFLOW        },
+   { S_CHECKCHANGE,  E_MOISTURELOW,       S_MOISTURIZE     },
+   { S_CHECKCHANGE,  E_TOOCOLD,           S_HEAT           },
+   { S_PROCESSING,   E_RESET,             S_WAITINPUT      },
+};
+
+/// Keys of --keys, each changes the input of the plant without <Enter>
+static const keyBinding_t keyBindings[] = {
+   //  Key    Events                            Help
+   {  'n',   { E_INPUTCHANGED, E_NOACTION },      "no change"               },
+   {  'c',   { E_INPUTCHANGED, E_CO2LOW },        "CO2 level low"           },
+   {  'm',   { E_INPUTCHANGED, E_MOISTURELOW },   "moisture level low"      },
+   {  't',   { E_INPUTCHANGED, E_TOOCOLD },       "temperature too low"     },
+   {  'e',   { E_INPUTCHANGED, E_OUTSIDEBOUNDS }, "trigger an error"        },
+   {  'r',   { E_RESET, E_NO },                   "reset a running action"  },
+};
+
+/// The plant FSM in the Monte Carlo simulation: the states and transitions
+/// above, the action states drive the simulated actuators
+static const state_funcs_t simulatedStates[] = {
+   //  State                  onEntry()                   onExit()            Budget (us)         Parent
+   [S_START]          = {  NULL,                    NULL,               0,                  S_NO          },
+   [S_INIT]           = {  S_Init_onSimulate,       NULL,               0,                  S_NO          },
+   [S_WAITINPUT]      = {  NULL,                    NULL,               0,                  S_NO          },
+   [S_CHECKCHANGE]    = {  NULL,                    NULL,               0,                  S_PROCESSING  },
+   [S_LOGERROR]       = {  S_logerror_onSimulate,   NULL,               0,                  S_NO          },
+   [S_AIRFLOW]        = {  S_airflow_onSimulate,    NULL,               0,                  S_PROCESSING  },
+   [S_MOISTURIZE]     = {  S_moisturize_onSimulate, NULL,               0,                  S_PROCESSING  },
+   [S_HEAT]           = {  S_heat_onSimulate,       NULL,               0,                  S_PROCESSING  },
+   [S_PROCESSING]     = {  NULL,                    NULL,               0,                  S_NO          },
+};
+
+/// Greenhouse of the Monte Carlo simulation, in the units of the default
+/// profile: the soil needs water every two days, the CO2 runs low on sunny
+/// afternoons, winter nights need heating
+static const mcsModel_t greenhouse = {
+   .drying = 0.0025f,      .co2Uptake = 0.6f,      .co2Leak = 0.02f,
+   .vent = 2.0f,           .outsideCo2 = 24.0f,    .watering = 20.0f,
+   .heating = 4.0f,        .insulation = 0.3f,     .climate = 19.5f,
+   .dailySwing = 2.5f,     .yearlySwing = 3.0f,    .processNoise = 0.3f,
+   .sensorNoise = 0.2f,    .spikeRate = 0.002f,    .spike = 8.0f,
+   .spread = 0.2f,
+};
+
+/// Action times of the simulation, in minutes of plant time
+static const uint32_t simulatedActions[HAL_NOF_ACTUATORS] = {
+   [HAL_WINDOW] = 30,
+   [HAL_PUMP] = 10,
+   [HAL_HEATER] = 30,
+};
+
+/// Noise filters of the sensor channels, applied before the classification:
+/// a median removes the spikes of the gas and soil probes, the temperature
+/// drifts slowly and is smoothed by a Kalman filter
+static const filterConfig_t sensorFilters[CH_NOF_CHANNELS] = {
+   //  Channel             Filter        Window  Weight
+   [CH_CO2]         = {  FLT_MEDIAN,   3,      0                      },
+   [CH_MOISTURE]    = {  FLT_MEDIAN,   3,      0                      },
+   [CH_TEMPERATURE] = {  FLT_KALMAN,   0,      FLT_WEIGHT(0.05)       },
+   [CH_HUMIDITY]    = {  FLT_EMA,      0,      FLT_WEIGHT(0.3)        },
+   [CH_LIGHT]       = {  FLT_EMA,      0,      FLT_WEIGHT(0.3)        },
+   [CH_SALINITY]    = {  FLT_EMA,      0,      FLT_WEIGHT(0.3)        },
+};
+
+/// Sample intervals of the sensor channels: a channel near the bounds of the
+/// default profile or changing is read every second, a stable one every 64 s
+static const samplerConfig_t sampleIntervals[CH_NOF_CHANNELS] = {
+   //  Channel             Min             Base   Max     Low       High      Near     Change
+   [CH_CO2]         = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+   [CH_MOISTURE]    = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+   [CH_TEMPERATURE] = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+   [CH_HUMIDITY]    = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+   [CH_LIGHT]       = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+   [CH_SALINITY]    = {  SAMPLE_MIN_MS,  8000,  64000,  VAL(20),  VAL(25),  VAL(1),  VAL(0.5)  },
+};
+
+/// Filter state of the plant
+static filterBank_t filters;
+
+/// Reads the sensor bus of the plant while the FSM is idle
+static sampler_t sampler;
+
+/// The sampler runs unless the samples come from the sensor ring or the
+/// control socket
+static bool sampling = true;
+
+/// Sensor ring of a data acquisition process, mapped with --ingress
+static ingress_t ingress;
+
+/// The input comes from the sensor ring or the control socket, not from the
+/// console
+static bool headless = false;
+
+/// Actuators of the rack: the window and the pump of a zone of 8 plants serve
+/// all its plants in one run, the heaters are per plant. At most 4 run at the
+/// same time, within 3 kW.
+static const arbiterConfig_t rack = {
+   .zoneSize = 8,    .maxRunning = 4,    .powerBudget = 3000,    .maxWaitMs = 10000,
+   .actuators = {
+      //  Actuator         Power (W)   Gather (ms)   Shared
+      [HAL_WINDOW]   = {  40,          0,            true    },
+      [HAL_PUMP]     = {  400,         0,            true    },
+      [HAL_HEATER]   = {  1500,        0,            false   },
+   },
+};
+
+/// Simulated sensor bus: 500 us per transaction, 20 us per byte
+static const halBusModel_t busModel = { 500, 20, false };
+
+/// Filters and classifies a sample of the current plant. A sample that needs
+/// an action while the plant waits for input adds E_INPUTCHANGED and the
+/// event of the action.
+/// \return true if it added the events
+static bool takeSample(channel_t channel, sensorValue_t value) {
+   plant_t *current = PLTcurrent();
+   event_t event;
+
+   value = FLTsample(&filters, current->id, channel, value);
+   PLTaddSample(current, channel, value);
+   event = EF_classify(current, channel, value);
+   if (event != E_NO && event != E_NOACTION && FSM_GetState() == S_WAITINPUT &&
+       FSM_NoEvents()) {
+      FSM_AddEvents((event_t[]){E_INPUTCHANGED, event}, 2);
+      return true;
+   }
+   return false;
+}
+
+/// Sample of a control socket client
+static void controlSample(channel_t channel, sensorValue_t value) {
+   takeSample(channel, value);
+}
+
+/// Sample of the sampler, read from the sensor bus
+static void busSample(size_t plant, channel_t channel, sensorValue_t value, void *user) {
+   (void)plant;
+   (void)user;
+   takeSample(channel, value);
+}
+
+/// Consumes the records of the sensor ring in place until one needs the FSM:
+/// an event, or a sample that needs an action while the plant waits for
+/// input. The other samples only update the plant. Never blocks, the loop
+/// sleeps in waitIngress().
+static void consumeIngress(void) {
+   const ingressRecord_t *records;
+   plant_t *current = PLTcurrent();
+   uint32_t n = IGRpeek(&ingress, &records);
+   uint32_t i;
+
+   for (i = 0; i < n; i++) {
+      const ingressRecord_t *record = &records[i];
+
+      if (record->plant != current->id) {
+         /// The producer feeds plants of another controller
+         setSystemErrorBit(ERR_UNKNOWN_PLANT);
+         continue;
+      }
+      if (record->event != E_NO) {
+         if (record->event < E_NOF_EVENTS) {
+            FSM_AddEvent(record->event);
+            i++;
+            break;
+         }
+      } else if (record->channel < CH_NOF_CHANNELS &&
+                 takeSample(record->channel, record->value)) {
+         i++;
+         break;
+      }
+   }
+   IGRrelease(&ingress, i);
+}
+
+/// Wait hook of the FSM with the sensor ring: sleeps while the ring and the
+/// event buffer are empty, briefly while an actuator action runs or a request
+/// waits for its run
+static void waitIngress(void) {
+   IGRwait(&ingress, ACTinProgress() > 0 || ARBprocess(PLTnow()) > 0 ? 1 : INGRESS_IDLE_MS,
+           FSM_NoEvents);
+}
+
+/// Wakes the loop sleeping in waitIngress()
+static void wakeIngress(void) {
+   IGRwake(&ingress);
+}
+
+static void closeIngress(void) {
+   IGRclose(&ingress);
+}
+
+/// Idle function of the FSM: starts the gathered actuator runs, resumes the
+/// actuator actions, sends the queued actuator commands in one bus
+/// transaction and reads the sensors that are due
+static void idle(void) {
+   ARBprocess(PLTnow());
+   ACTpoll();
+   if (HALflush() != 0) {
+      setSystemErrorBit(ERR_ACTUATOR_BUS);
+   }
+   /// A replay takes its samples from the recording
+   if (sampling && !RECreplaying() && SMPprocess(&sampler, PLTnow()) < 0) {
+      setSystemErrorBit(ERR_SENSOR_BUS);
+   }
+   TELpublish(PLTcurrent());
+   if (ingress.ring != NULL) {
+      consumeIngress();
+   }
+   /// The reactor sleeps until input arrives, briefly while an action runs,
+   /// at most the fastest sample interval while sampling
+   RCTsetTimeout(ACTinProgress() > 0 ? 1 : sampling ? SAMPLE_MIN_MS : -1);
+}
+
+/// Watchdog of the handler latency budgets
+static void handlerOverrun(const state_t overrunState, const uint32_t us) {
+   setSystemErrorBit(ERR_HANDLER_OVERRUN);
+   DCSdebugSystemInfo("%s took %u us, budget %u us", stateEnumToText[overrunState],
+                      us, ACTION_BUDGET_US);
+}
+
+/// Monitor of the handler latency budgets, in its own thread: reports a
+/// handler while it is overdue, also one that never returns
+static void *monitorHandlers(void *arg) {
+   const struct timespec period = { 0, MONITOR_PERIOD_MS * 1000000L };
+   uint32_t reported = 0;
+
+   (void)arg;
+   for (;;) {
+      const uint32_t us = FSM_Overdue(&plant.fsm);
+      // After the budget FSM_Overdue() acquired, so not of an earlier handler
+      const uint32_t start = atomic_load_explicit(&plant.fsm.handler_start,
+                                                  memory_order_relaxed);
+
+      if (us > 0 && start != reported) {
+         reported = start;
+         setErrorBit(&plant.errors, ERR_HANDLER_OVERRUN);
+         DCSdebugSystemInfo("Handler overdue: running %u us, budget %u us", us,
+                            ACTION_BUDGET_US);
+      }
+      nanosleep(&period, NULL);
+   }
+   return NULL;
+}
+
+/// Terminates the application, the atexit() functions are executed
+static void stopOnInterrupt(int signal) {
+   (void)signal;
+   exit(EXIT_SUCCESS);
+}
+
+/// Shows the dashboard of nofPlants plants, restored from the snapshot file
+/// if there is one. Keys: n next page, p previous page, q quit.
+static int showDashboard(long nofPlants) {
+    plant_t *plants = calloc(nofPlants, sizeof(plant_t));
+    int page = 0;
+    char key = '\0';
+
+    if (nofPlants <= 0 || plants == NULL) {
+        printf("Invalid number of plants\n");
+        return 1;
+    }
+    for (long i = 0; i < nofPlants; i++) {
+        PLTinitialise(&plants[i], i);
+    }
+    SNPrestore(SNAPSHOT_FILE, plants, nofPlants);
+
+    DSPsetSize(DASHBOARD_WIDTH, DASHBOARD_HEIGHT);
+    DSPinitialise();
+    DSPsetDashboard(nofPlants, PLT_STATUS_WIDTH, PLTformatStatus, plants);
+    while (key != 'q') {
+        page = DSPshowDashboard(page);
+        printf("[n]ext, [p]revious page or [q]uit: ");
+        key = KYBgetchar();
+        if (key == 'n') {
+            page++;
+        } else if (key == 'p' && page > 0) {
+            page--;
+        }
+    }
+    free(plants);
+    return 0;
+}
+
+/// Backtest: ingests a recorded sensor log (CSV or binary) in batches, adds
+/// the samples to the plants and their history and classifies them
+static int backtest(const char path[]) {
+    static ingestSample_t batch[INGEST_BATCH];
+    long events[E_RESET + 1] = {0};
+    long samples = 0;
+    ingest_t log;
+    size_t n;
+    plant_t *plants = calloc(BACKTEST_PLANTS, sizeof(plant_t));
+    history_t *histories = calloc(BACKTEST_PLANTS, sizeof(history_t));
+    filterBank_t bank;
+    struct timespec start;
+    struct timespec end;
+    double seconds;
+    size_t historyBytes = 0;
+    uint64_t historySamples = 0;
+
+    if (plants == NULL || histories == NULL ||
+        FLTinitialise(&bank, BACKTEST_PLANTS, sensorFilters) != 0) {
+        printf("Out of memory\n");
+        free(histories);
+        free(plants);
+        return 1;
+    }
+    if (INGopen(&log, path) != 0) {
+        printf("Cannot open sensor log: %s\n", path);
+        FLTterminate(&bank);
+        free(histories);
+        free(plants);
+        return 1;
+    }
+    for (uint32_t i = 0; i < BACKTEST_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+        HSTinitialise(&histories[i], 0);
+    }
+    PRFload(PROFILE_FILE);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while ((n = INGread(&log, batch, INGEST_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (batch[i].plant < BACKTEST_PLANTS) {
+                sensorValue_t value = FLTsample(&bank, batch[i].plant, batch[i].channel,
+                                                batch[i].value);
+
+                HSTappend(&histories[batch[i].plant], batch[i].channel, batch[i].ms,
+                          batch[i].value);
+                PLTaddSample(&plants[batch[i].plant], batch[i].channel, value);
+                events[EF_classify(&plants[batch[i].plant], batch[i].channel, value)]++;
+            }
+        }
+        samples += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%ld samples, %ld errors, %.1f MB/s\n", samples, log.errors,
+           seconds > 0 ? log.size / seconds / 1e6 : 0.0);
+    for (int e = E_NO + 1; e <= E_RESET; e++) {
+        if (events[e] != 0) {
+            printf("  %-16s %ld\n", eventEnumToText[e], events[e]);
+        }
+    }
+    for (uint32_t i = 0; i < BACKTEST_PLANTS; i++) {
+        uint64_t n;
+
+        historyBytes += HSTsize(&histories[i], &n);
+        historySamples += n;
+        HSTterminate(&histories[i]);
+    }
+    printf("History: %llu samples in %zu kB, %.2f bytes/sample\n",
+           (unsigned long long)historySamples, historyBytes / 1024,
+           historySamples > 0 ? (double)historyBytes / historySamples : 0.0);
+    INGclose(&log);
+    FLTterminate(&bank);
+    free(histories);
+    free(plants);
+    return 0;
+}
+
+/// Monte Carlo simulation of nofPlants plants for days days of plant time,
+/// on all cores. Prints the outcome over the plants.
+static int simulate(long nofPlants, long days) {
+    static const char * const actuators[HAL_NOF_ACTUATORS] = {
+        [HAL_WINDOW] = "Window", [HAL_PUMP] = "Pump", [HAL_HEATER] = "Heater",
+    };
+    extern const char * const channelEnumToText[];
+    mcsConfig_t config = {
+        .plants = (uint32_t)nofPlants,
+        .days = (uint32_t)days,
+        .stepMinutes = SIMULATION_STEP_MIN,
+        .seed = SIMULATION_SEED,
+        .threads = 0,
+        .model = greenhouse,
+        .filters = sensorFilters,
+        .classify = EF_classify,
+    };
+    mcsResult_t result;
+
+    memcpy(config.actionMinutes, simulatedActions, sizeof(simulatedActions));
+    if (nofPlants <= 0 || days <= 0) {
+        printf("Invalid number of plants or days\n");
+        return 1;
+    }
+    /// Same transitions, the simulated actions; the bounds of the profiles
+    FSM_SetModel(simulatedStates, sizeof(simulatedStates) / sizeof(simulatedStates[0]),
+                 plantTransitions, sizeof(plantTransitions) / sizeof(plantTransitions[0]));
+    PRFload(PROFILE_FILE);
+    if (MCSrun(&config, &result) != 0) {
+        printf("Simulation failed\n");
+        return 1;
+    }
+
+    printf("%ld plants, %ld days, %u min steps: %llu steps, %llu events, "
+           "%u threads, %.1f s, %.1f M steps/s\n",
+           nofPlants, days, SIMULATION_STEP_MIN, (unsigned long long)result.steps,
+           (unsigned long long)result.events, result.threads, result.seconds,
+           result.seconds > 0 ? result.steps / result.seconds / 1e6 : 0.0);
+    printf("%-16s %7s %7s %7s %7s %7s %7s\n", "Time in band", "normal", "p5", "p50", "p95",
+           "low", "outside");
+    for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+        const mcsDistribution_t *normal = &result.normal[ch];
+
+        printf("%-16s %6.1f%% %6.1f%% %6.1f%% %6.1f%% %6.1f%% %6.1f%%\n",
+               channelEnumToText[ch], normal->mean * 100, normal->p5 * 100,
+               normal->p50 * 100, normal->p95 * 100, result.low[ch].mean * 100,
+               (1 - normal->mean - result.low[ch].mean) * 100);
+    }
+    printf("%-16s %7s %7s %7s %7s %7s\n", "Per plant", "actions", "p95", "hours", "p95", "max");
+    for (int a = 0; a < HAL_NOF_ACTUATORS; a++) {
+        if (actuators[a] != NULL) {
+            printf("%-16s %7.1f %7.0f %7.1f %7.1f %7.1f\n", actuators[a],
+                   result.actions[a].mean, result.actions[a].p95, result.hours[a].mean,
+                   result.hours[a].p95, result.hours[a].max);
+        }
+    }
+    printf("%-16s %7.1f %7.0f %23.0f\n", "Errors", result.errors.mean, result.errors.p95,
+           result.errors.max);
+    return 0;
+}
+
+/// Prints the RAM and constant (flash) memory used per component
+static int showFootprint(void) {
+    size_t ram;
+    size_t flash;
+
+    FSM_Footprint(&ram, &flash);
+    printf("%-30s %10s %10s\n", "Component", "RAM", "const");
+    printf("%-30s %10zu %10zu\n", "FSM framework and model", ram, flash);
+    printf("%-30s %10zu %10s\n", "FSM instance, incl. queue", sizeof(fsm_context_t), "-");
+    printf("%-30s %10zu %10s\n", "Plant, incl. FSM instance", sizeof(plant_t), "-");
+    printf("%-30s %10zu %10s\n", "HAL command queue", HAL_COMMAND_QUEUE * sizeof(halCommand_t), "-");
+    printf("Model and queue of one plant: %zu bytes RAM\n", ram + sizeof(fsm_context_t));
+    return 0;
+}
 
 /// Main
-int main(void) {
-
-   /// Define the state machine model
-   /// First the state and the pointer to the onEntry and onExit functions
-   //           State                              onEntry()                   onExit()
-   FSM_AddState(S_START,        &(state_funcs_t){  NULL,                    NULL               });
-   FSM_AddState(S_INIT,         &(state_funcs_t){  S_Init_onEntry,          S_Init_onExit      });
-   FSM_AddState(S_WAITINPUT,    &(state_funcs_t){  S_waitinput_onEntry,     NULL               });
-   FSM_AddState(S_CHECKCHANGE,  &(state_funcs_t){  S_checkchange_onEntry,   NULL               });
-   FSM_AddState(S_LOGERROR,     &(state_funcs_t){  S_logerror_onEntry,      NULL               });
-   FSM_AddState(S_AIRFLOW,      &(state_funcs_t){  S_airflow_onEntry,       NULL               });
-   FSM_AddState(S_MOISTURIZE,   &(state_funcs_t){  S_moisturize_onEntry,    NULL               });
-   FSM_AddState(S_HEAT,         &(state_funcs_t){  S_heat_onEntry,          NULL               });
-
-
-
-
-   /// Define the state transistions
-   //                                 From            Event                To
-   FSM_AddTransition(&(transition_t){ S_START,        E_INIT,              S_INIT           });
-   FSM_AddTransition(&(transition_t){ S_INIT,         E_INITSUCCES,        S_WAITINPUT      });
-   FSM_AddTransition(&(transition_t){ S_WAITINPUT,    E_INPUTCHANGED,      S_CHECKCHANGE    });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_NOACTION,          S_WAITINPUT      });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_OUTSIDEBOUNDS,     S_LOGERROR       });
-   FSM_AddTransition(&(transition_t){ S_LOGERROR,     E_ERRORLOGGED,       S_INIT           });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_CO2LOW,            S_AIRFLOW        });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_MOISTURELOW,       S_MOISTURIZE     });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_TOOCOLD,           S_HEAT           });
-   FSM_AddTransition(&(transition_t){ S_CHECKCHANGE,  E_RESET,             S_WAITINPUT      });
-   FSM_AddTransition(&(transition_t){ S_AIRFLOW,      E_RESET,             S_WAITINPUT      });
-   FSM_AddTransition(&(transition_t){ S_MOISTURIZE,   E_RESET,             S_WAITINPUT      });
-   FSM_AddTransition(&(transition_t){ S_HEAT,         E_RESET,             S_WAITINPUT      });
+/// Options: --record <file> records all input of the FSM,
+///          --replay <file> replays a recording without the console,
+///          --dashboard <n> shows the dashboard of n plants,
+///          --footprint prints the memory use per component,
+///          --backtest <log> classifies a recorded sensor log,
+///          --simulate <n> <days> simulates n plants for days of plant time,
+///          --ingress takes the sensor samples from a shared memory ring
+///          instead of the console,
+///          --reactor sleeps in epoll until a client of the control socket
+///          writes an event or a sample, or a timer or signal fires,
+///          --keys changes the input with single keys, without <Enter>.
+int main(int argc, char *argv[]) {
+
+   /// The state machine model, constant tables so they can stay in flash
+   FSM_SetModel(plantStates, sizeof(plantStates) / sizeof(plantStates[0]),
+                plantTransitions, sizeof(plantTransitions) / sizeof(plantTransitions[0]));
 
    /// Use this test function to test the model
    /// FSM_RevertModel();
 
 
+   /// Handlers that exceed their latency budget raise E_HANDLEROVERRUN
+   FSM_SetWatchdog(E_HANDLEROVERRUN, handlerOverrun);
+
    /// Should unexpected events in a state be flushed or not?
    FSM_FlushEnexpectedEvents(true);
 
+   /// The FSM instance of the plant is used by all FSM_ functions
+   PLTinitialise(&plant, 0);
+   PLTselect(&plant);
+
+   /// Sensors and actuators of the plant are simulated
+   HALinitialise(HALsimulator(1, &busModel));
+   FLTinitialise(&filters, 1, sensorFilters);
+
+   /// Actuator actions are resumed while the FSM is idle, they wait for the
+   /// arbiter of the actuators of the rack
+   ACTinitialise(8);
+   ARBinitialise(&rack, 8);
+   FSM_SetIdleHook(idle);
+
+   if (argc == 2 && strcmp(argv[1], "--footprint") == 0) {
+      return showFootprint();
+   }
+   if (argc == 3 && strcmp(argv[1], "--backtest") == 0) {
+      return backtest(argv[2]);
+   }
+   if (argc == 4 && strcmp(argv[1], "--simulate") == 0) {
+      return simulate(atol(argv[2]), atol(argv[3]));
+   }
+   if (argc == 3 && strcmp(argv[1], "--dashboard") == 0) {
+      return showDashboard(atol(argv[2]));
+   }
+   if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+      replayStats_t stats;
+
+      DCSsetHeadless(1);
+      if (RECreplay(argv[2], &stats) != 0) {
+         printf("Invalid recording: %s\n", argv[2]);
+         return 1;
+      }
+      printf("Replayed %ld events, %ld inputs, %ld divergences, %u ms recorded\n",
+             stats.events, stats.inputs, stats.divergences, stats.ms);
+      return 0;
+   }
+   if (argc == 3 && strcmp(argv[1], "--record") == 0 && RECstartRecording(argv[2]) == 0) {
+      /// The FSM never returns, close the recording on Ctrl+C
+      atexit(RECstopRecording);
+      signal(SIGINT, stopOnInterrupt);
+   }
+   if (argc == 2 && strcmp(argv[1], "--ingress") == 0) {
+      if (IGRcreate(&ingress, INGRESS_NAME, INGRESS_CAPACITY) != 0) {
+         printf("Cannot create the sensor ring: %s\n", INGRESS_NAME);
+         return 1;
+      }
+      /// No prompts and no sampler, the ring is removed at exit
+      DCSsetHeadless(1);
+      FSM_SetWaitHook(waitIngress, wakeIngress);
+      atexit(closeIngress);
+      signal(SIGINT, stopOnInterrupt);
+      signal(SIGTERM, stopOnInterrupt);
+      headless = true;
+      sampling = false;
+   }
+   if (argc == 2 && strcmp(argv[1], "--reactor") == 0) {
+      if (RCTinitialise() != 0 || CTLopen(CONTROL_SOCKET, controlSample) != 0) {
+         printf("Cannot open the control socket: %s\n", CONTROL_SOCKET);
+         return 1;
+      }
+      /// No prompts and no sampler, the socket is removed at exit. Before
+      /// the threads are started, they must not take the signals of the
+      /// reactor.
+      DCSsetHeadless(1);
+      atexit(CTLclose);
+      RCTaddSignal(SIGINT, E_NO);
+      RCTaddSignal(SIGTERM, E_NO);
+      RCTaddTimer(TELEMETRY_PERIOD_MS, E_NO);
+      headless = true;
+      sampling = false;
+   }
+   if (argc == 2 && strcmp(argv[1], "--keys") == 0) {
+      /// The loop sleeps until the reader thread adds the events of a key.
+      /// The signals go to the reactor before the thread is started.
+      if (RCTinitialise() != 0) {
+         printf("Cannot start the reactor\n");
+         return 1;
+      }
+      RCTaddSignal(SIGINT, E_NO);
+      RCTaddSignal(SIGTERM, E_NO);
+      if (KYBstartRaw(keyBindings, sizeof(keyBindings) / sizeof(keyBindings[0])) != 0) {
+         printf("The keyboard is not a terminal\n");
+         return 1;
+      }
+      for (size_t i = 0; i < sizeof(keyBindings) / sizeof(keyBindings[0]); i++) {
+         printf("Press %c for %s\n", keyBindings[i].key, keyBindings[i].help);
+      }
+      printf("Press Ctrl+C to quit\n");
+
+      /// No prompts, the states are still shown
+      headless = true;
+   }
+
+   /// Warm start: the plant is restored from the last snapshot before the
+   /// subsystems below attach their data to it
+   const bool warmStart = SNPrestore(SNAPSHOT_FILE, &plant, 1) == 1 && plant.fsm.state > S_INIT;
+   SNPinitialise(SNAPSHOT_FILE, SNAPSHOT_PERIOD_MS);
+
+   /// Threshold profiles, reloaded while running when the file changes
+   PRFattach(&plant, PLANT_SPECIES);
+   PRFwatch(PROFILE_FILE, PROFILE_POLL_MS);
+
+   /// The simulated sensors start in the normal band, the sampler reads the
+   /// channels that are due while the FSM is idle
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+      threshold_t bounds = PRFthreshold(&plant, ch);
+
+      HALsimulatorSetSensor(plant.id, ch, (bounds.normal + bounds.high) / 2);
+   }
+   if (sampling && SMPinitialise(&sampler, &plant.id, 1, sampleIntervals, SAMPLE_BUDGET,
+                                 busSample, NULL, PLTnow()) != 0) {
+      sampling = false;
+   }
+
+   /// Live telemetry, the segment is removed at exit
+   if (TELopen(TELEMETRY_NAME, 1) == 0) {
+      atexit(TELclose);
+      signal(SIGINT, stopOnInterrupt);
+      signal(SIGTERM, stopOnInterrupt);
+   }
+
+   /// The watchdog of FSM_SetWatchdog() reports an overrun when the handler
+   /// returns, the monitor while it runs
+   if (ACTION_BUDGET_US > 0) {
+      pthread_t monitor;
+
+      if (pthread_create(&monitor, NULL, monitorHandlers, NULL) == 0) {
+         pthread_detach(monitor);
+      }
+   }
+
+   /// Warm start: continue in the state of the last snapshot, skip S_INIT
+   if (warmStart) {
+      DSPinitialise();
+      KYBinitialise();
+      DCSdebugSystemInfo("Warm start in state: %s", stateEnumToText[plant.fsm.state]);
+      FSM_ResumeStateMachine();
+   }
+
    /// Start the state machine
    FSM_RunStateMachine(S_START, E_INIT);
 
@@ -127,12 +753,15 @@ void S_Init_onEntry(void) {
    /// Simulate the initialisation
    nextevent = EF_InitialiseSubsystems();
 
-   FSM_AddEvent(nextevent);           /// Internal generated event
+   FSM_AddInternalEvent(nextevent);           /// Internal generated event
 }
 
 /// WaitInput State Entry Function
 /// Wait for a change in the input signals
 void S_waitinput_onEntry(void)  {
+    /// Idle point of the plant, save it for a warm start
+    SNPcheckpoint(PLTcurrent(), 1);
+
     ChangeLight(0);
     showCurrentState();
 
@@ -140,7 +769,9 @@ void S_waitinput_onEntry(void)  {
 
     nextevent = EF_WAITINPUT();
 
-    FSM_AddEvent(nextevent);
+    if (nextevent != E_NO) {
+        FSM_AddInternalEvent(nextevent);
+    }
 }
 
 /// Check Change State Entry Function
@@ -154,38 +785,45 @@ void S_checkchange_onEntry(void) {
 
     int function;
 
+    /// The sensor ring or the control socket has posted the classified sample
+    /// after E_INPUTCHANGED
+    if (headless) {
+        return;
+    }
+
     /// Show user information on options
     DSPshow(4,"Insert Changed Situation");
-    function = DCSsimulationSystemInputChar("\n"
+    function = RECreplaying() ? 0 : DCSsimulationSystemInputChar("\n"
                                             "Press N for no change\n"
                                             "Press C for changed CO2 level\n"
                                             "Press M for changed moisture level\n"
                                             "Press T for changed temperature level\n"
                                             "Press E to trigger error\n",
                                             "N" "C" "M" "T" "E");
+    function = RECinputInt(function);   /// recorded user choice
 
     /// Process the user response and transition to the next state
     /// depending on user input.
     switch (function) {
         case 'N':
             nextevent = E_NOACTION;
-            FSM_AddEvent(nextevent);
+            FSM_AddInternalEvent(nextevent);
             break;
         case 'C':
             nextevent = EF_CO2LOW();
-            FSM_AddEvent(nextevent);
+            FSM_AddInternalEvent(nextevent);
             break;
         case 'M':
             nextevent = EF_MOISTURELOW();
-            FSM_AddEvent(nextevent);
+            FSM_AddInternalEvent(nextevent);
             break;
         case 'T':
             nextevent = EF_TOOCOLD();
-            FSM_AddEvent(nextevent);
+            FSM_AddInternalEvent(nextevent);
             break;
         case 'E':
             nextevent = E_OUTSIDEBOUNDS;
-            FSM_AddEvent(nextevent);
+            FSM_AddInternalEvent(nextevent);
             break;
         default:
             DSPshow(1,"Invalid input!\nPlease try again!");
@@ -205,7 +843,7 @@ void S_logerror_onEntry(void) {
 
     nextevent = E_ERRORLOGGED;
 
-    FSM_AddEvent(nextevent);
+    FSM_AddInternalEvent(nextevent);
 }
 
 /// Airflow State Entry Function
@@ -213,13 +851,13 @@ void S_logerror_onEntry(void) {
 void S_airflow_onEntry(void) {
     ChangeLight(1);
     showCurrentState();
-    event_t nextevent;
-
-    OpenWindow();
-
-    nextevent = E_RESET;
 
-    FSM_AddEvent(nextevent);
+    /// The action runs while the FSM continues, E_RESET follows when done
+    if (ACTstart(PLTcurrent(), AirflowAction, AIRFLOW_MS, E_RESET) != 0) {
+        setSystemErrorBit(ERR_ACTUATOR_BUSY);
+        OpenWindow();
+        FSM_AddInternalEvent(E_RESET);
+    }
 }
 
 /// Moisturize State Entry Function
@@ -227,13 +865,13 @@ void S_airflow_onEntry(void) {
 void S_moisturize_onEntry(void) {
     ChangeLight(1);
     showCurrentState();
-    event_t nextevent;
-
-    Moisturize();
 
-    nextevent = E_RESET;
-
-    FSM_AddEvent(nextevent);
+    /// The action runs while the FSM continues, E_RESET follows when done
+    if (ACTstart(PLTcurrent(), MoisturizeAction, MOISTURIZE_MS, E_RESET) != 0) {
+        setSystemErrorBit(ERR_ACTUATOR_BUSY);
+        Moisturize();
+        FSM_AddInternalEvent(E_RESET);
+    }
 }
 
 /// Heat State Entry Function
@@ -241,36 +879,102 @@ void S_moisturize_onEntry(void) {
 void S_heat_onEntry(void) {
     ChangeLight(1);
     showCurrentState();
-    event_t nextevent;
 
-    HeatPlant();
+    /// The action runs while the FSM continues, E_RESET follows when done
+    if (ACTstart(PLTcurrent(), HeatAction, HEAT_MS, E_RESET) != 0) {
+        setSystemErrorBit(ERR_ACTUATOR_BUSY);
+        HeatPlant();
+        FSM_AddInternalEvent(E_RESET);
+    }
+}
+
 
-    nextevent = E_RESET;
+/// Runs actuator of act->plant when the arbiter grants it: switches it on,
+/// keeps it on for act->data ms, then switches it off
+static PT_THREAD(runActuator(actuation_t *act, halActuator_t actuator, const char *text)) {
+    PT_BEGIN(&act->pt);
+    ARB_WAIT_GRANT(act, actuator);
+    HALcommand(act->plant->id, actuator, 1);
+    DSPshow(4, "%s", text);
+    ACT_WAIT_MS(act, act->data);
+    HALcommand(act->plant->id, actuator, 0);
+    ARBrelease(act, actuator);
+    PT_END(&act->pt);
+}
+
+/// Airflow action: opens the window
+PT_THREAD(AirflowAction(actuation_t *act)) {
+    return runActuator(act, HAL_WINDOW, "Opening Window");
+}
 
-    FSM_AddEvent(nextevent);
+/// Moisturize action: runs the pump of the zone
+PT_THREAD(MoisturizeAction(actuation_t *act)) {
+    return runActuator(act, HAL_PUMP, "Moisturizing plant");
 }
 
+/// Heat action: switches the heater on
+PT_THREAD(HeatAction(actuation_t *act)) {
+    return runActuator(act, HAL_HEATER, "Heating plant");
+}
+
+
+/// Init State Entry Function of the simulation, the subsystems are simulated
+void S_Init_onSimulate(void) {
+    FSM_AddInternalEvent(E_INITSUCCES);
+}
+
+/// Log Error State Entry Function of the simulation
+void S_logerror_onSimulate(void) {
+    PLTcurrent()->lightstatus = 2;
+    setSystemErrorBit(ERR_OUTSIDEBOUNDS);
+    FSM_AddInternalEvent(E_ERRORLOGGED);
+}
+
+/// Airflow State Entry Function of the simulation, E_RESET follows when the
+/// window has been open for its action time
+void S_airflow_onSimulate(void) {
+    PLTcurrent()->lightstatus = 1;
+    MCSactuate(HAL_WINDOW, E_RESET);
+}
+
+/// Moisturize State Entry Function of the simulation
+void S_moisturize_onSimulate(void) {
+    PLTcurrent()->lightstatus = 1;
+    MCSactuate(HAL_PUMP, E_RESET);
+}
+
+/// Heat State Entry Function of the simulation
+void S_heat_onSimulate(void) {
+    PLTcurrent()->lightstatus = 1;
+    MCSactuate(HAL_HEATER, E_RESET);
+}
 
 ///Subsystem Change Light function
 void ChangeLight(int d) {
-    lightstatus = d;
+    PLTcurrent()->lightstatus = d;
+    HALcommand(PLTcurrent()->id, HAL_LIGHT, d);
     DCSdebugSystemInfo("lightstatus variable changed to: %d", d);
 }
 
 void LogError(void) {
+    setSystemErrorBit(ERR_OUTSIDEBOUNDS);
+    HALcommand(PLTcurrent()->id, HAL_ERRORLOG, 1);
     DSPshow(4, "Logging Error");
 }
 
 void OpenWindow(void) {
+    HALcommand(PLTcurrent()->id, HAL_WINDOW, 1);
     DSPshow(4, "Opening Window");
 }
 
 void Moisturize(void) {
+    HALcommand(PLTcurrent()->id, HAL_PUMP, 1);
     DSPshow(4, "Moisturizing plant");
 }
 
 void HeatPlant(void) {
-    DSPshow(4, "");
+    HALcommand(PLTcurrent()->id, HAL_HEATER, 1);
+    DSPshow(4, "Heating plant");
 }
 
 /// function to show current state on display and debug
@@ -281,8 +985,11 @@ void showCurrentState(void) {
     state = FSM_GetState();
 
     /// Show current state to user
-    DSPshow(2, "Lightstatus: %s", lightStateEnumToText[lightstatus]);
+    DSPshow(2, "Lightstatus: %s", lightStateEnumToText[PLTcurrent()->lightstatus]);
     DCSdebugSystemInfo("Current State: %s", stateEnumToText[state]);
+
+    /// Live telemetry for fsmtop, only stores to shared memory
+    TELpublish(PLTcurrent());
 }
 
 ///Subsystem Initialisation function
@@ -302,59 +1009,93 @@ event_t EF_InitialiseSubsystems(void) {
 
 event_t EF_WAITINPUT(void) {
     DSPshow(4, "Awaiting Input");
-    return E_INPUTCHANGED;
+
+    /// The sensor ring or the control socket posts E_INPUTCHANGED when a
+    /// sample needs an action
+    return headless ? E_NO : E_INPUTCHANGED;
 }
 
-event_t EF_CO2LOW(void) {
+/// Reads a sensor value: the user (or the log while replaying) sets the
+/// simulated sensor, then all channels of the plant are read in one bus
+/// transaction. A typed value is exact, it is not filtered: a median would
+/// drop a single low value.
+sensorValue_t EF_readSensor(channel_t channel, const char name[]) {
     char input[10];
-    float value;
-
-    /// change co2 value here
-    printf("Enter a co2 value(20-25 normal, 10-20 too low, otherwise error): ");
-    fgets(input, sizeof(input), stdin); /// get user input
-    value = atof(input);/// set value as float
+    sensorValue_t value = 0;
+    sensorValue_t values[CH_NOF_CHANNELS];
+    plant_t *current = PLTcurrent();
+
+    if (!RECreplaying()) {
+        /// The bounds of the profile of the plant, they can be reloaded
+        threshold_t bounds = PRFthreshold(current, channel);
+        char low[12], normal[12], high[12];
+
+        VALformat(low, sizeof(low), bounds.low);
+        VALformat(normal, sizeof(normal), bounds.normal);
+        VALformat(high, sizeof(high), bounds.high);
+        printf("Enter a %s value(%s-%s normal, %s-%s too low, otherwise error): ",
+               name, normal, high, low, normal);
+        fgets(input, sizeof(input), stdin); /// get user input
+        value = VALparse(input, NULL);/// no floating point needed
+    }
+    value = RECinputValue(value);
+    HALsimulatorSetSensor(current->id, channel, value);
 
-    if ((value < 20) & (value > 10)) {
-        return E_CO2LOW;
+    if (HALreadPlant(current->id, values) != 0) {
+        setSystemErrorBit(ERR_SENSOR_BUS);
+        DCSshowSystemError("Sensor bus error");
+        return value;
+    }
+    for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+        PLTaddSample(current, ch, values[ch]);
     }
-    else if ((value < 25) & (value > 20)) {
-        return E_NOACTION;
+
+    return values[channel];
+}
+
+/// Classifies a sensor value: 10-20 too low, 20-25 normal, otherwise error.
+/// Used for the entered values and for the samples of ingested logs.
+event_t EF_classify(plant_t *plant, channel_t channel, sensorValue_t value) {
+    static const event_t lowEvent[CH_NOF_CHANNELS] = {
+        [CH_CO2] = E_CO2LOW,
+        [CH_MOISTURE] = E_MOISTURELOW,
+        [CH_TEMPERATURE] = E_TOOCOLD,
+    };
+
+    /// The bounds come from the threshold profile of the plant
+    switch (PRFclassify(plant, channel, value)) {
+        case PRF_LOW:
+            return lowEvent[channel];   /// E_NO for channels without an action
+        case PRF_NORMAL:
+            return E_NOACTION;
+        default:
+            return E_OUTSIDEBOUNDS;
     }
-    return E_OUTSIDEBOUNDS;
+}
+
+event_t EF_CO2LOW(void) {
+    sensorValue_t value;
+
+    /// change co2 value here
+    value = EF_readSensor(CH_CO2, "co2");
+
+    return EF_classify(PLTcurrent(), CH_CO2, value);
 }
 
 event_t EF_MOISTURELOW(void) {
-    char input[10];
-    float value;
+    sensorValue_t value;
 
-    /// change moisture level here
-    printf("Enter a moisture value(20-25 normal, 10-20 too low, otherwise error): ");
-    fgets(input, sizeof(input), stdin); /// get user input
-    value = atof(input);/// set value as float
+    /// change moisture level value here
+    value = EF_readSensor(CH_MOISTURE, "moisture");
 
-    if ((value < 20) & (value > 10)) {
-        return E_MOISTURELOW;
-    }
-    else if ((value < 25) & (value > 20)) {
-        return E_NOACTION;
-    }
-    return E_OUTSIDEBOUNDS;
+    return EF_classify(PLTcurrent(), CH_MOISTURE, value);
 }
 
 event_t EF_TOOCOLD(void) {
-    char input[10];
-    float value;
+    sensorValue_t value;
 
-    /// change temperature here
-    printf("Enter a temperature value(20-25 normal, 10-20 too low, otherwise error): ");
-    fgets(input, sizeof(input), stdin); /// get user input
-    value = atof(input);/// set value as float
+    /// change temperature value here
+    value = EF_readSensor(CH_TEMPERATURE, "temperature");
 
-    if ((value < 20) & (value > 10)) {
-        return E_TOOCOLD;
-    }
-    else if ((value < 25) & (value > 20)) {
-        return E_NOACTION;
-    }
-    return E_OUTSIDEBOUNDS;
+    return EF_classify(PLTcurrent(), CH_TEMPERATURE, value);
 }
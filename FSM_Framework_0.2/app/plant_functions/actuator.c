@@ -0,0 +1,135 @@
+#include "actuator.h"
+#include "fsm_functions/recorder.h"
+
+#include <stdlib.h>
+
+//--------------------------------------------------------------------- ACTuator
+
+static actuation_t *pool = NULL;
+static actuation_t *freeList = NULL;
+static actuation_t *active = NULL;
+static size_t nofActive = 0;
+
+int ACTinitialise(size_t capacity)
+{
+   free(pool);
+   pool = calloc(capacity, sizeof(actuation_t));
+   freeList = NULL;
+   active = NULL;
+   nofActive = 0;
+   if (pool == NULL)
+   {
+      return -1;
+   }
+   for (size_t i = 0; i < capacity; i++)
+   {
+      pool[i].next = freeList;
+      freeList = &pool[i];
+   }
+   return 0;
+}
+
+/// Posts the done event in the FSM instance of the plant.
+static void finish(actuation_t *actuation)
+{
+   fsm_context_t *selected = FSM_GetContext();
+
+   FSM_SelectContext(&actuation->plant->fsm);
+   FSM_AddEvent(actuation->done);
+   FSM_SelectContext(selected);
+}
+
+int ACTstart(plant_t *plant, actAction_t action, uint32_t data, event_t done)
+{
+   actuation_t *actuation = freeList;
+
+   if (actuation == NULL)
+   {
+      return -1;
+   }
+   freeList = actuation->next;
+
+   PT_INIT(&actuation->pt);
+   actuation->action = action;
+   actuation->plant = plant;
+   actuation->done = done;
+   actuation->waitMs = 0;
+   actuation->signalled = 0;
+   actuation->data = data;
+
+   // While replaying the done event is part of the recording
+   if (action(actuation) == PT_ENDED || RECreplaying())
+   {
+      if (!RECreplaying())
+      {
+         finish(actuation);
+      }
+      actuation->next = freeList;
+      freeList = actuation;
+      return 0;
+   }
+
+   actuation->next = active;
+   active = actuation;
+   nofActive++;
+   return 0;
+}
+
+void ACTsignal(plant_t *plant)
+{
+   for (actuation_t *actuation = active; actuation != NULL; actuation = actuation->next)
+   {
+      if (actuation->plant == plant)
+      {
+         actuation->signalled = 1;
+      }
+   }
+}
+
+size_t ACTprocess(uint32_t now)
+{
+   actuation_t **link = &active;
+
+   while (*link != NULL)
+   {
+      actuation_t *actuation = *link;
+
+      if (actuation->waitMs)
+      {
+         // Signed difference, so the wrap around of the ms counter is handled
+         if ((int32_t)(now - actuation->wake) < 0)
+         {
+            link = &actuation->next;
+            continue;
+         }
+         actuation->waitMs = 0;
+      }
+
+      if (actuation->action(actuation) == PT_ENDED)
+      {
+         *link = actuation->next;
+         nofActive--;
+         finish(actuation);
+         actuation->next = freeList;
+         freeList = actuation;
+      }
+      else
+      {
+         link = &actuation->next;
+      }
+   }
+   return nofActive;
+}
+
+size_t ACTinProgress(void)
+{
+   return nofActive;
+}
+
+void ACTpoll(void)
+{
+   if (active != NULL)
+   {
+      ACTprocess(PLTnow());
+   }
+}
@@ -0,0 +1,78 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fsm_functions/protothread.h"
+#include "plant.h"
+
+//--------------------------------------------------------------------- ACTuator
+
+/// An actuation is a long running actuator action of a plant (a pump running
+/// for seconds), written as a protothread. The state action starts it and
+/// returns, so the event loop and the other plants are not blocked. The
+/// actuation waits for a time or a signal (e.g. a hardware acknowledge) and is
+/// resumed by ACTprocess(). When it ends the done event is posted in the FSM
+/// instance of the plant.
+
+typedef struct actuation actuation_t;
+
+/// Protothread function of an actuation.
+typedef ptStatus_t (*actAction_t)(actuation_t *actuation);
+
+struct actuation {
+   pt_t pt;
+   actAction_t action;
+   plant_t *plant;
+   event_t done;        ///< Posted in the plant FSM when the action ends
+   uint32_t wake;       ///< Time to resume, see ACT_WAIT_MS()
+   uint8_t waitMs;      ///< Waiting for wake
+   uint8_t signalled;   ///< Set by ACTsignal(), see ACT_WAIT_SIGNAL()
+   uint32_t data;       ///< Free for the action, e.g. a duration
+   actuation_t *next;
+};
+
+/// Waits ms milliseconds, without blocking.
+#define ACT_WAIT_MS(actuation, ms)                                   \
+   do {                                                              \
+      (actuation)->wake = PLTnow() + (ms);                           \
+      (actuation)->waitMs = 1;                                       \
+      PT_WAIT_UNTIL(&(actuation)->pt, !(actuation)->waitMs);         \
+   } while (0)
+
+/// Waits until ACTsignal() is called for the plant of the actuation.
+#define ACT_WAIT_SIGNAL(actuation)                                   \
+   do {                                                              \
+      (actuation)->signalled = 0;                                    \
+      PT_WAIT_UNTIL(&(actuation)->pt, (actuation)->signalled);       \
+   } while (0)
+
+/// Initialises the ACTuator subsystem with room for capacity actuations in
+/// progress at the same time.
+/// \return 0 on success, -1 on out of memory.
+int ACTinitialise(size_t capacity);
+
+/// Starts action for plant, the first part runs immediately.
+/// While a recording is replayed only the first part runs, the done event is
+/// part of the recording.
+/// \param data free for the action, e.g. a duration in ms
+/// \return 0 when started, also when the action ended at once, -1 if all
+/// actuations are in progress.
+int ACTstart(plant_t *plant, actAction_t action, uint32_t data, event_t done);
+
+/// Resumes the actuations of plant that wait for a signal.
+void ACTsignal(plant_t *plant);
+
+/// Resumes all actuations that can continue, call this when the FSM is idle.
+/// \return the number of actuations still in progress.
+size_t ACTprocess(uint32_t now);
+
+/// \return the number of actuations in progress.
+size_t ACTinProgress(void);
+
+/// Idle function for FSM_SetIdleHook(), calls ACTprocess().
+void ACTpoll(void);
+
+#endif
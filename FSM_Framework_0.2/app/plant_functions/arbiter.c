@@ -0,0 +1,260 @@
+#include "arbiter.h"
+#include "fsm_functions/recorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------- ARBiter
+
+typedef struct arbiterJob arbiterJob_t;
+typedef struct arbiterRun arbiterRun_t;
+
+/// The request of one actuation
+struct arbiterJob {
+   actuation_t *actuation;
+   uint32_t requested;
+   arbiterJob_t *next;
+};
+
+/// The requests served by one run of an actuator
+struct arbiterRun {
+   halActuator_t actuator;
+   uint32_t owner;            ///< Zone of a shared actuator, else the plant id
+   uint32_t requested;        ///< Time of the first request
+   arbiterJob_t *jobs;
+   arbiterRun_t *next;
+};
+
+static arbiterConfig_t settings;
+static arbiterJob_t *jobPool = NULL;
+static arbiterJob_t *freeJobs = NULL;
+static arbiterRun_t *runPool = NULL;
+static arbiterRun_t *freeRuns = NULL;
+static arbiterRun_t *queue = NULL;        ///< Waiting runs, oldest first
+static arbiterRun_t **queueEnd = &queue;
+static arbiterRun_t *running = NULL;
+static arbiterStats_t stats;
+
+int ARBinitialise(const arbiterConfig_t *config, size_t capacity)
+{
+   ARBterminate();
+   if (config->zoneSize == 0)
+   {
+      return -1;
+   }
+   jobPool = calloc(capacity, sizeof(arbiterJob_t));
+   runPool = calloc(capacity, sizeof(arbiterRun_t));
+   if (jobPool == NULL || runPool == NULL)
+   {
+      ARBterminate();
+      return -1;
+   }
+   for (size_t i = 0; i < capacity; i++)
+   {
+      jobPool[i].next = freeJobs;
+      freeJobs = &jobPool[i];
+      runPool[i].next = freeRuns;
+      freeRuns = &runPool[i];
+   }
+   settings = *config;
+   return 0;
+}
+
+void ARBterminate(void)
+{
+   free(jobPool);
+   free(runPool);
+   jobPool = NULL;
+   runPool = NULL;
+   freeJobs = NULL;
+   freeRuns = NULL;
+   queue = NULL;
+   queueEnd = &queue;
+   running = NULL;
+   memset(&stats, 0, sizeof(stats));
+}
+
+/// \return the zone of plant for a shared actuator, else its id
+static uint32_t ownerOf(const plant_t *plant, halActuator_t actuator)
+{
+   return settings.actuators[actuator].shared ? plant->id / settings.zoneSize : plant->id;
+}
+
+/// \return the first run of actuator and owner in list, NULL if there is none
+static arbiterRun_t *findRun(arbiterRun_t *list, uint32_t owner, halActuator_t actuator)
+{
+   for (arbiterRun_t *run = list; run != NULL; run = run->next)
+   {
+      if (run->owner == owner && run->actuator == actuator)
+      {
+         return run;
+      }
+   }
+   return NULL;
+}
+
+/// \return true if a run of power stays within the budgets
+static bool fits(uint32_t power)
+{
+   return (settings.maxRunning == 0 || stats.running < settings.maxRunning) &&
+          (settings.powerBudget == 0 || stats.power + power <= settings.powerBudget);
+}
+
+/// Switches run on, grants all its requests
+static void start(arbiterRun_t *run, uint32_t now)
+{
+   run->next = running;
+   running = run;
+   stats.runs++;
+   stats.running++;
+   stats.power += settings.actuators[run->actuator].power;
+   if (stats.running > stats.peakRunning)
+   {
+      stats.peakRunning = stats.running;
+   }
+   if (stats.power > stats.peakPower)
+   {
+      stats.peakPower = stats.power;
+   }
+
+   for (arbiterJob_t *job = run->jobs; job != NULL; job = job->next)
+   {
+      const uint32_t wait = now - job->requested;
+
+      stats.jobs++;
+      stats.queued--;
+      stats.waitMs += wait;
+      if (wait > stats.maxWaitMs)
+      {
+         stats.maxWaitMs = wait;
+      }
+      job->actuation->signalled = 1;
+   }
+}
+
+int ARBrequest(actuation_t *actuation, halActuator_t actuator)
+{
+   const uint32_t owner = ownerOf(actuation->plant, actuator);
+   const uint32_t now = PLTnow();
+   arbiterRun_t *run = findRun(queue, owner, actuator);
+   arbiterJob_t *job = freeJobs;
+
+   // While replaying the actuations do not run
+   if (RECreplaying())
+   {
+      actuation->signalled = 1;
+      return 0;
+   }
+   if (job == NULL || (run == NULL && freeRuns == NULL))
+   {
+      actuation->signalled = 1;
+      return -1;
+   }
+
+   // A request joins the waiting run of its zone, or starts a new one
+   if (run == NULL)
+   {
+      run = freeRuns;
+      freeRuns = run->next;
+      run->actuator = actuator;
+      run->owner = owner;
+      run->requested = now;
+      run->jobs = NULL;
+      run->next = NULL;
+      *queueEnd = run;
+      queueEnd = &run->next;
+   }
+   freeJobs = job->next;
+   job->actuation = actuation;
+   job->requested = now;
+   job->next = run->jobs;
+   run->jobs = job;
+   stats.queued++;
+
+   ARBprocess(now);
+   return 0;
+}
+
+void ARBrelease(const actuation_t *actuation, halActuator_t actuator)
+{
+   arbiterRun_t *run = findRun(running, ownerOf(actuation->plant, actuator), actuator);
+
+   if (run == NULL)
+   {
+      // Granted outside the budgets, or while replaying
+      return;
+   }
+   for (arbiterJob_t **link = &run->jobs; *link != NULL; link = &(*link)->next)
+   {
+      arbiterJob_t *job = *link;
+
+      if (job->actuation == actuation)
+      {
+         *link = job->next;
+         job->next = freeJobs;
+         freeJobs = job;
+         break;
+      }
+   }
+   if (run->jobs != NULL)
+   {
+      return;
+   }
+
+   // The last actuation of the run, the actuator is free for the next run
+   for (arbiterRun_t **link = &running; *link != NULL; link = &(*link)->next)
+   {
+      if (*link == run)
+      {
+         *link = run->next;
+         break;
+      }
+   }
+   stats.running--;
+   stats.power -= settings.actuators[actuator].power;
+   run->next = freeRuns;
+   freeRuns = run;
+   ARBprocess(PLTnow());
+}
+
+size_t ARBprocess(uint32_t now)
+{
+   arbiterRun_t **link = &queue;
+
+   while (*link != NULL && (settings.maxRunning == 0 || stats.running < settings.maxRunning))
+   {
+      arbiterRun_t *run = *link;
+      const arbiterActuator_t *kind = &settings.actuators[run->actuator];
+      // Signed difference, so the wrap around of the ms counter is handled
+      const int32_t waited = (int32_t)(now - run->requested);
+
+      if (waited < (int32_t)kind->gatherMs || findRun(running, run->owner, run->actuator) != NULL)
+      {
+         link = &run->next;
+         continue;
+      }
+      if (!fits(kind->power))
+      {
+         // Later runs that fit go first, until this one has waited too long
+         if (waited >= (int32_t)settings.maxWaitMs)
+         {
+            break;
+         }
+         link = &run->next;
+         continue;
+      }
+
+      *link = run->next;
+      if (queueEnd == &run->next)
+      {
+         queueEnd = link;
+      }
+      start(run, now);
+   }
+   return stats.queued;
+}
+
+void ARBstatistics(arbiterStats_t *out)
+{
+   *out = stats;
+}
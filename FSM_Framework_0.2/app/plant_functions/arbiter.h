@@ -0,0 +1,95 @@
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "actuator.h"
+#include "hal_functions/hal.h"
+
+//---------------------------------------------------------------------- ARBiter
+
+/// Arbitrates the actuators of a rack. An actuation asks for its actuator
+/// with ARB_WAIT_GRANT() and waits until the arbiter grants it, so plants that
+/// need an action at the same time do not all switch on at once:
+/// - the requests are queued as runs, oldest first,
+/// - a shared actuator (the pump of a zone) serves all plants of the zone
+///   that wait for it in one run, the requests of a zone are gathered for
+///   gatherMs before the run starts,
+/// - a run starts when the number of runs on and their power stay within
+///   the budgets. A run that does not fit is overtaken by later runs that
+///   do, until it has waited maxWaitMs,
+/// - one actuator of a zone (shared) or of a plant runs one run at a time.
+/// The actuation switches the actuator on and off and posts its done event
+/// as before, ARBrelease() ends its part of the run.
+///
+/// The arbiter resumes a granted actuation with its signalled flag, it must
+/// not wait for ACTsignal() at the same time. While a recording is replayed
+/// a request is granted at once, the actuations do not run.
+
+/// Settings of one kind of actuator.
+typedef struct {
+   uint32_t power;      ///< Load while on, in W
+   uint32_t gatherMs;   ///< Time the requests of a run are gathered before it starts
+   bool shared;         ///< One actuator per zone, else one per plant
+} arbiterActuator_t;
+
+typedef struct {
+   uint32_t zoneSize;      ///< Plants per zone, the zone of a plant is id / zoneSize
+   uint32_t maxRunning;    ///< Runs on at the same time, 0 is unlimited
+   uint32_t powerBudget;   ///< Power of the runs on, in W, 0 is unlimited
+   uint32_t maxWaitMs;     ///< Wait after which a run is not overtaken
+   arbiterActuator_t actuators[HAL_NOF_ACTUATORS];
+} arbiterConfig_t;
+
+typedef struct {
+   uint64_t jobs;          ///< Requests granted
+   uint64_t runs;          ///< Runs started
+   uint64_t waitMs;        ///< Total wait of the granted requests
+   uint32_t maxWaitMs;     ///< Longest wait of a granted request
+   uint32_t queued;        ///< Requests waiting now
+   uint32_t running;       ///< Runs on now
+   uint32_t power;         ///< Power of the runs on now
+   uint32_t peakRunning;
+   uint32_t peakPower;
+} arbiterStats_t;
+
+/// Waits in the protothread of actuation until the arbiter grants actuator.
+/// A queued request is granted in the idle function, so after the wait the
+/// plant of actuation need not be the selected plant: use actuation->plant.
+#define ARB_WAIT_GRANT(actuation, actuator)                          \
+   do {                                                              \
+      (actuation)->signalled = 0;                                    \
+      ARBrequest((actuation), (actuator));                           \
+      PT_WAIT_UNTIL(&(actuation)->pt, (actuation)->signalled);       \
+   } while (0)
+
+/// Initialises the ARBiter subsystem with room for capacity requests, use
+/// the capacity of ACTinitialise().
+/// \return 0 on success, -1 on out of memory or a zoneSize of 0.
+int ARBinitialise(const arbiterConfig_t *config, size_t capacity);
+
+/// Frees the queue, the requests are dropped.
+void ARBterminate(void);
+
+/// Queues a request of actuation for actuator of its plant, see
+/// ARB_WAIT_GRANT(). Sets the signalled flag of actuation when it is
+/// granted, at once when the budgets allow it.
+/// \return 0 when queued or granted, -1 when the queue is full: the request
+/// is granted at once, outside the budgets.
+int ARBrequest(actuation_t *actuation, halActuator_t actuator);
+
+/// Ends the part of actuation in the run of actuator, the run ends with the
+/// last actuation of it and the next runs are started.
+void ARBrelease(const actuation_t *actuation, halActuator_t actuator);
+
+/// Starts the queued runs that are gathered and fit the budgets, call this
+/// when the FSM is idle.
+/// \return the number of requests still waiting.
+size_t ARBprocess(uint32_t now);
+
+/// Copies the counters of the arbiter to stats.
+void ARBstatistics(arbiterStats_t *stats);
+
+#endif
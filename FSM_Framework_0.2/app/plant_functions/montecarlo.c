@@ -0,0 +1,492 @@
+#include "montecarlo.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "events.h"
+#include "states.h"
+#include "profile.h"
+
+//------------------------------------------------------- Monte Carlo Simulation
+
+#define MCS_PI 3.14159265f
+#define MCS_HOLD 0.5f      ///< Return to the middle per hour, the other channels
+
+/// Outcomes of a plant, the rows of the outcome table
+enum {
+   MCS_NORMAL = 0,
+   MCS_LOW = MCS_NORMAL + CH_NOF_CHANNELS,
+   MCS_ACTIONS = MCS_LOW + CH_NOF_CHANNELS,
+   MCS_HOURS = MCS_ACTIONS + HAL_NOF_ACTUATORS,
+   MCS_ERRORS = MCS_HOURS + HAL_NOF_ACTUATORS,
+   MCS_NOF_OUTCOMES,
+};
+
+/// A virtual plant, the rates are per step
+typedef struct {
+   plant_t plant;                                ///< KEEP FIRST, see MCSactuate()
+   const mcsConfig_t *config;
+   uint64_t rng[4];                              ///< xoshiro256** state
+   float level[CH_NOF_CHANNELS];                 ///< True values
+   float low[CH_NOF_CHANNELS];                   ///< Bounds of the profile
+   float normal[CH_NOF_CHANNELS];
+   float high[CH_NOF_CHANNELS];
+   float drying;
+   float co2Uptake;
+   float co2Leak;
+   float vent;
+   float watering;
+   float heating;
+   float insulation;
+   float hold;
+   float processNoise;
+   uint32_t remaining[HAL_NOF_ACTUATORS];        ///< Steps until the action is done
+   event_t done[HAL_NOF_ACTUATORS];
+   uint32_t actions[HAL_NOF_ACTUATORS];
+   uint32_t onSteps[HAL_NOF_ACTUATORS];
+   uint32_t normalSteps[CH_NOF_CHANNELS];
+   uint32_t lowSteps[CH_NOF_CHANNELS];
+   uint32_t errors;
+} mcsPlant_t;
+
+/// A run, shared by its threads
+typedef struct {
+   const mcsConfig_t *config;
+   uint32_t stepsPerDay;
+   float *cycle;                 ///< Day cycle per step of a day, -1 at 5:00
+   float *daylight;              ///< Per step of a day, 1 at noon
+   float *outcome;               ///< [MCS_NOF_OUTCOMES][plants]
+   _Atomic uint32_t next;        ///< Next plant to simulate
+   _Atomic uint64_t events;      ///< Handled by the FSMs of the plants
+} mcsRun_t;
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+/// xoshiro256** of D. Blackman and S. Vigna
+static inline uint64_t next(uint64_t s[4])
+{
+   const uint64_t result = rotl(s[1] * 5, 7) * 9;
+   const uint64_t t = s[1] << 17;
+
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = rotl(s[3], 45);
+   return result;
+}
+
+/// Seeds the streams, consecutive ids give unrelated streams
+static uint64_t splitmix(uint64_t *x)
+{
+   uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+   return z ^ (z >> 31);
+}
+
+/// The sum of four 16 bit uniforms scaled to unit variance: close to a
+/// normal distribution within 3.5 sigma, at a fraction of the cost of
+/// Box-Muller
+static inline float gaussian(uint64_t s[4])
+{
+   const uint64_t r = next(s);
+   const uint32_t sum = (uint32_t)(r & 0xFFFF) + (uint32_t)((r >> 16) & 0xFFFF) +
+                        (uint32_t)((r >> 32) & 0xFFFF) + (uint32_t)(r >> 48);
+
+   return ((float)sum * (1.0f / 65536.0f) - 2.0f) * 1.7320508f;
+}
+
+static inline float toFloat(sensorValue_t value)
+{
+   return (float)value / VAL_SCALE;
+}
+
+static inline sensorValue_t toValue(float x)
+{
+#ifdef SENSOR_FIXED
+   return (sensorValue_t)lrintf(x * VAL_SCALE);
+#else
+   return x;
+#endif
+}
+
+/// \return rate varied by the spread of the model, never below 10%
+static float vary(mcsPlant_t *p, float rate)
+{
+   return rate * fmaxf(0.1f, 1.0f + p->config->model.spread * gaussian(p->rng));
+}
+
+static void initialise(mcsPlant_t *p, const mcsConfig_t *config, uint32_t id)
+{
+   const mcsModel_t *m = &config->model;
+   const float hours = config->stepMinutes / 60.0f;
+   uint64_t seed = config->seed ^ ((uint64_t)id << 32 | id);
+
+   memset(p, 0, sizeof(mcsPlant_t));
+   PLTinitialise(&p->plant, id);
+   p->config = config;
+   for (int i = 0; i < 4; i++)
+   {
+      p->rng[i] = splitmix(&seed);
+   }
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      const threshold_t threshold = PRFthreshold(&p->plant, ch);
+
+      p->low[ch] = toFloat(threshold.low);
+      p->normal[ch] = toFloat(threshold.normal);
+      p->high[ch] = toFloat(threshold.high);
+      p->level[ch] = (p->normal[ch] + p->high[ch]) / 2;
+   }
+   p->drying = vary(p, m->drying) * hours;
+   p->co2Uptake = vary(p, m->co2Uptake) * hours;
+   p->co2Leak = vary(p, m->co2Leak) * hours;
+   p->vent = vary(p, m->vent) * hours;
+   p->watering = vary(p, m->watering) * hours;
+   p->heating = vary(p, m->heating) * hours;
+   p->insulation = vary(p, m->insulation) * hours;
+   p->hold = MCS_HOLD * hours;
+   p->processNoise = m->processNoise * sqrtf(hours);
+}
+
+/// Handles the events of the plant, they are added by MCSactuate() and for
+/// the samples
+static void dispatch(void)
+{
+   const fsm_event_t *events;
+   uint8_t n;
+
+   // The handlers do not look at the event buffer, a span is released at once
+   while ((n = FSM_GetEvents(&events)) > 0)
+   {
+      for (uint8_t i = 0; i < n; i++)
+      {
+         FSM_EventHandler(FSM_GetState(), (event_t)events[i]);
+      }
+      FSM_ReleaseEvents(n);
+   }
+}
+
+/// Simulates plant id from the first to the last day, writes its outcome
+static void simulate(mcsRun_t *run, mcsPlant_t *p, filterBank_t *bank, uint32_t id)
+{
+   const mcsConfig_t *config = run->config;
+   const mcsModel_t *m = &config->model;
+   const uint32_t steps = config->days * run->stepsPerDay;
+   const uint64_t spikeRate = (uint64_t)(m->spikeRate * 16777216.0f);
+   float *level = p->level;
+
+   initialise(p, config, id);
+   if (bank->size > 0)
+   {
+      FLTreset(bank, 0);
+   }
+   PLTselect(&p->plant);
+   FSM_EventHandler(S_START, E_INIT);
+
+   for (uint32_t day = 0; day < config->days; day++)
+   {
+      const float season = cosf(2 * MCS_PI * ((float)day - 15.0f) / 365.0f);
+      const float climate = m->climate - m->yearlySwing * season;
+
+      for (uint32_t k = 0; k < run->stepsPerDay; k++)
+      {
+         const float temperature = level[CH_TEMPERATURE];
+         const float warmth = 1.0f + 0.05f * (temperature - 20.0f);
+         const bool window = p->remaining[HAL_WINDOW] > 0;
+         const bool pump = p->remaining[HAL_PUMP] > 0;
+         const bool heater = p->remaining[HAL_HEATER] > 0;
+         bool posted = false;
+
+         // The models advance with the actuators of the last step
+         level[CH_MOISTURE] += -p->drying * warmth * level[CH_MOISTURE] +
+                               (pump ? p->watering : 0.0f) + p->processNoise * gaussian(p->rng);
+         level[CH_MOISTURE] = fmaxf(level[CH_MOISTURE], 0.0f);
+         level[CH_CO2] += -p->co2Uptake * run->daylight[k] +
+                          (p->co2Leak + (window ? p->vent : 0.0f)) *
+                          (m->outsideCo2 - level[CH_CO2]) +
+                          p->processNoise * gaussian(p->rng);
+         level[CH_CO2] = fmaxf(level[CH_CO2], 0.0f);
+         level[CH_TEMPERATURE] += p->insulation *
+                                  (climate + m->dailySwing * run->cycle[k] - temperature) +
+                                  (heater ? p->heating : 0.0f) +
+                                  p->processNoise * gaussian(p->rng);
+         for (int ch = CH_HUMIDITY; ch < CH_NOF_CHANNELS; ch++)
+         {
+            level[ch] += p->hold * ((p->normal[ch] + p->high[ch]) / 2 - level[ch]) +
+                         p->processNoise * gaussian(p->rng);
+         }
+         for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+         {
+            p->normalSteps[ch] += (level[ch] > p->normal[ch]) & (level[ch] < p->high[ch]);
+            p->lowSteps[ch] += (level[ch] > p->low[ch]) & (level[ch] < p->normal[ch]);
+         }
+
+         // The actions that have run their time are done
+         for (int a = 0; a < HAL_NOF_ACTUATORS; a++)
+         {
+            if (p->remaining[a] > 0)
+            {
+               p->onSteps[a]++;
+               if (--p->remaining[a] == 0)
+               {
+                  FSM_AddEvent(p->done[a]);
+                  posted = true;
+               }
+            }
+         }
+         if (posted)
+         {
+            dispatch();
+            posted = false;
+         }
+
+         // Read, filter and classify all channels, the first sample that
+         // needs an action starts it
+         for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+         {
+            const uint64_t r = next(p->rng);
+            float reading = level[ch] + m->sensorNoise * gaussian(p->rng);
+            sensorValue_t value;
+            event_t event;
+
+            if ((r >> 40) < spikeRate)
+            {
+               reading += (r & 1) ? m->spike : -m->spike;
+            }
+            value = toValue(reading);
+            if (bank->size > 0)
+            {
+               value = FLTsample(bank, 0, ch, value);
+            }
+            event = config->classify(&p->plant, ch, value);
+            if (event != E_NO && event != E_NOACTION && !posted &&
+                FSM_GetState() == S_WAITINPUT)
+            {
+               FSM_AddEvents((event_t[]){E_INPUTCHANGED, event}, 2);
+               p->errors += (event == E_OUTSIDEBOUNDS);
+               posted = true;
+            }
+         }
+         if (posted)
+         {
+            dispatch();
+         }
+      }
+   }
+
+   // Outcome of the plant
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      run->outcome[(MCS_NORMAL + ch) * config->plants + id] = (float)p->normalSteps[ch] / steps;
+      run->outcome[(MCS_LOW + ch) * config->plants + id] = (float)p->lowSteps[ch] / steps;
+   }
+   for (int a = 0; a < HAL_NOF_ACTUATORS; a++)
+   {
+      run->outcome[(MCS_ACTIONS + a) * config->plants + id] = (float)p->actions[a];
+      run->outcome[(MCS_HOURS + a) * config->plants + id] =
+         (float)p->onSteps[a] * config->stepMinutes / 60.0f;
+   }
+   run->outcome[MCS_ERRORS * config->plants + id] = (float)p->errors;
+   atomic_fetch_add_explicit(&run->events, p->plant.fsm.handled, memory_order_relaxed);
+}
+
+static void *worker(void *arg)
+{
+   mcsRun_t *run = arg;
+   const mcsConfig_t *config = run->config;
+   mcsPlant_t *plant = malloc(sizeof(mcsPlant_t));
+   filterBank_t bank = { .size = 0 };
+   uint32_t id;
+
+   if (plant == NULL)
+   {
+      return arg;
+   }
+   if (config->filters != NULL && FLTinitialise(&bank, 1, config->filters) != 0)
+   {
+      free(plant);
+      return arg;
+   }
+   while ((id = atomic_fetch_add(&run->next, 1)) < config->plants)
+   {
+      simulate(run, plant, &bank, id);
+   }
+   FSM_SelectContext(NULL);
+   selectSystemErrors(NULL);
+   FLTterminate(&bank);
+   free(plant);
+   return NULL;
+}
+
+static unsigned cores(void)
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors;
+#else
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+   return (n > 0) ? (unsigned)n : 1;
+#endif
+}
+
+static int compare(const void *a, const void *b)
+{
+   const float x = *(const float *)a;
+   const float y = *(const float *)b;
+
+   return (x > y) - (x < y);
+}
+
+/// Distribution of an outcome over the plants, the mean is summed in plant
+/// order so it does not depend on the threads
+static mcsDistribution_t distribution(const float outcome[], float sorted[], uint32_t n)
+{
+   mcsDistribution_t d;
+   double sum = 0;
+
+   for (uint32_t i = 0; i < n; i++)
+   {
+      sum += outcome[i];
+   }
+   memcpy(sorted, outcome, n * sizeof(float));
+   qsort(sorted, n, sizeof(float), compare);
+   d.mean = (float)(sum / n);
+   d.p5 = sorted[(uint64_t)(n - 1) * 5 / 100];
+   d.p50 = sorted[(n - 1) / 2];
+   d.p95 = sorted[(uint64_t)(n - 1) * 95 / 100];
+   d.max = sorted[n - 1];
+   return d;
+}
+
+int MCSrun(const mcsConfig_t *config, mcsResult_t *result)
+{
+   mcsRun_t run = { .config = config };
+   unsigned threads = (config->threads > 0) ? config->threads : cores();
+   pthread_t *thread;
+   float *sorted;
+   unsigned started = 0;
+   int error = 0;
+   struct timespec start;
+   struct timespec end;
+
+   memset(result, 0, sizeof(mcsResult_t));
+   if (config->plants == 0 || config->days == 0 || config->stepMinutes == 0 ||
+       1440 % config->stepMinutes != 0 || config->classify == NULL ||
+       FSM_FreezeModel() != 0)
+   {
+      // The threads share the compiled model, it cannot be compiled lazily
+      return -1;
+   }
+   if (threads > config->plants)
+   {
+      threads = config->plants;
+   }
+   run.stepsPerDay = 1440 / config->stepMinutes;
+   run.cycle = malloc(run.stepsPerDay * sizeof(float));
+   run.daylight = malloc(run.stepsPerDay * sizeof(float));
+   run.outcome = malloc((size_t)MCS_NOF_OUTCOMES * config->plants * sizeof(float));
+   sorted = malloc(config->plants * sizeof(float));
+   thread = malloc(threads * sizeof(pthread_t));
+   if (run.cycle == NULL || run.daylight == NULL || run.outcome == NULL ||
+       sorted == NULL || thread == NULL)
+   {
+      error = -1;
+   }
+   for (uint32_t k = 0; error == 0 && k < run.stepsPerDay; k++)
+   {
+      const float minute = (float)(k * config->stepMinutes);
+
+      run.cycle[k] = -cosf(2 * MCS_PI * (minute - 300.0f) / 1440.0f);
+      run.daylight[k] = fmaxf(0.0f, sinf(2 * MCS_PI * (minute - 360.0f) / 1440.0f));
+   }
+   atomic_init(&run.next, 0);
+   atomic_init(&run.events, 0);
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (; error == 0 && started < threads; started++)
+   {
+      if (pthread_create(&thread[started], NULL, worker, &run) != 0)
+      {
+         // The started threads take all plants
+         break;
+      }
+   }
+   if (started == 0)
+   {
+      error = -1;
+   }
+   for (unsigned i = 0; i < started; i++)
+   {
+      void *failed;
+
+      pthread_join(thread[i], &failed);
+      if (failed != NULL)
+      {
+         error = -1;
+      }
+   }
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   if (error == 0)
+   {
+      const uint32_t n = config->plants;
+
+      result->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+      result->threads = started;
+      result->events = atomic_load(&run.events);
+      result->steps = (uint64_t)n * config->days * run.stepsPerDay;
+      for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+      {
+         result->normal[ch] = distribution(&run.outcome[(MCS_NORMAL + ch) * n], sorted, n);
+         result->low[ch] = distribution(&run.outcome[(MCS_LOW + ch) * n], sorted, n);
+      }
+      for (int a = 0; a < HAL_NOF_ACTUATORS; a++)
+      {
+         result->actions[a] = distribution(&run.outcome[(MCS_ACTIONS + a) * n], sorted, n);
+         result->hours[a] = distribution(&run.outcome[(MCS_HOURS + a) * n], sorted, n);
+      }
+      result->errors = distribution(&run.outcome[MCS_ERRORS * n], sorted, n);
+   }
+   free(run.cycle);
+   free(run.daylight);
+   free(run.outcome);
+   free(sorted);
+   free(thread);
+   return error;
+}
+
+void MCSactuate(halActuator_t actuator, event_t done)
+{
+   mcsPlant_t *p = (mcsPlant_t *)PLTcurrent();
+   const uint32_t step = p->config->stepMinutes;
+
+   p->actions[actuator]++;
+   if (p->remaining[actuator] > 0 || p->config->actionMinutes[actuator] < step)
+   {
+      // Busy, or shorter than a step
+      FSM_AddEvent(done);
+      return;
+   }
+   p->remaining[actuator] = (p->config->actionMinutes[actuator] + step / 2) / step;
+   p->done[actuator] = done;
+}
@@ -0,0 +1,105 @@
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <stdint.h>
+
+#include "channels.h"
+#include "hal_functions/hal.h"
+#include "plant.h"
+#include "sensor_functions/filter.h"
+
+//------------------------------------------------------- Monte Carlo Simulation
+
+/// Runs the plant FSM against stochastic models of the plant and its
+/// greenhouse, to tune the threshold profiles and the action durations
+/// without real plants. Each virtual plant draws its own rates at the start
+/// and has its own random stream, derived from the seed and its id, so a run
+/// gives the same result with any number of threads.
+///
+/// The threads take whole plants, one plant runs from the first to the last
+/// day before the next is taken, so its FSM instance, filters and models
+/// stay in the cache. At every step of plant time the models advance, the
+/// sensors are read with noise and spikes, filtered and classified. As with
+/// the sensor ring, a sample that needs an action while the plant waits for
+/// input adds E_INPUTCHANGED and the event of the action. An action state
+/// starts a simulated actuator with MCSactuate(), its done event follows when
+/// the action time has passed.
+///
+/// The models, in the units of the sensors:
+/// - the soil dries out, faster when it is warm; the pump waters,
+/// - the plant takes up CO2 in daylight, CO2 leaks in from outside; an open
+///   window vents towards the outside level,
+/// - the temperature follows the greenhouse climate, with a daily and a
+///   yearly cycle; the heater warms,
+/// - humidity, light and salinity wander around the middle of their band.
+
+/// Rates of the models, a virtual plant draws its rates around them.
+typedef struct {
+   float drying;              ///< Moisture lost per hour at 20 degrees, fraction
+   float co2Uptake;           ///< CO2 taken up per hour at noon
+   float co2Leak;             ///< Part of the difference with outside per hour
+   float vent;                ///< Same, with the window open
+   float outsideCo2;
+   float watering;            ///< Moisture added per hour of watering
+   float heating;             ///< Degrees per hour of heating
+   float insulation;          ///< Part of the difference with the climate per hour
+   float climate;             ///< Mean temperature of the greenhouse climate
+   float dailySwing;          ///< Amplitude of the day cycle, coldest at 5:00
+   float yearlySwing;         ///< Amplitude of the year cycle, coldest mid January
+   float processNoise;        ///< Standard deviation per sqrt(hour)
+   float sensorNoise;         ///< Standard deviation of a reading
+   float spikeRate;           ///< Probability of a spike in a reading
+   float spike;               ///< Size of a spike
+   float spread;              ///< Relative standard deviation of the rates
+} mcsModel_t;
+
+/// Classifies a sample of plant, see EF_classify().
+/// \return the event for the FSM, E_NO or E_NOACTION for no action.
+typedef event_t (*mcsClassify_t)(plant_t *plant, channel_t channel, sensorValue_t value);
+
+typedef struct {
+   uint32_t plants;
+   uint32_t days;
+   uint32_t stepMinutes;                     ///< Sample period in plant time
+   uint64_t seed;
+   unsigned threads;                         ///< 0 for one per core
+   mcsModel_t model;
+   uint32_t actionMinutes[HAL_NOF_ACTUATORS];
+   const filterConfig_t *filters;            ///< Per channel, NULL for none
+   mcsClassify_t classify;
+} mcsConfig_t;
+
+/// Distribution of an outcome over the plants.
+typedef struct {
+   float mean;
+   float p5;
+   float p50;
+   float p95;
+   float max;
+} mcsDistribution_t;
+
+typedef struct {
+   uint64_t steps;                                  ///< Plant steps simulated
+   uint64_t events;                                 ///< Events handled by the FSMs
+   double seconds;                                  ///< Wall time
+   unsigned threads;
+   mcsDistribution_t normal[CH_NOF_CHANNELS];       ///< Part of the time in the normal band
+   mcsDistribution_t low[CH_NOF_CHANNELS];          ///< Part of the time too low
+   mcsDistribution_t actions[HAL_NOF_ACTUATORS];    ///< Actions per plant
+   mcsDistribution_t hours[HAL_NOF_ACTUATORS];      ///< Hours on per plant
+   mcsDistribution_t errors;                        ///< E_OUTSIDEBOUNDS per plant
+} mcsResult_t;
+
+/// Simulates config->plants plants for config->days days with the model set
+/// by FSM_SetModel(). Each plant starts in S_START with E_INIT. The bands of
+/// the outcome are those of the threshold profile of a plant.
+/// \return 0 on success, -1 on an invalid model or config, out of memory,
+/// or if the threads cannot be started.
+int MCSrun(const mcsConfig_t *config, mcsResult_t *result);
+
+/// Starts actuator of the simulated plant of the selected FSM instance for
+/// its action time, done is added when it has passed. An actuator that is
+/// already on adds done at once.
+void MCSactuate(halActuator_t actuator, event_t done);
+
+#endif
@@ -0,0 +1,137 @@
+#include "plant.h"
+#include "fsm_functions/recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+//------------------------------------------------------------------------ PLanT
+
+void PLTinitialise(plant_t *plant, uint32_t id)
+{
+   memset(plant, 0, sizeof(plant_t));
+   FSM_InitContext(&plant->fsm, plant);
+   initErrorSet(&plant->errors);
+   plant->id = id;
+}
+
+void PLTselect(plant_t *plant)
+{
+   FSM_SelectContext(&plant->fsm);
+   selectSystemErrors(&plant->errors);
+}
+
+plant_t *PLTcurrent(void)
+{
+   return FSM_GetContext()->data;
+}
+
+static void errorRaised(errorSet_t *set, systemErrors_t raised, void *data)
+{
+   plant_t *plant = data;
+   fsm_context_t *selected = FSM_GetContext();
+
+   (void)set;
+   (void)raised;
+   FSM_SelectContext(&plant->fsm);
+   FSM_AddEvent(plant->errorEvent);
+   FSM_SelectContext(selected);
+}
+
+void PLTpostOnError(plant_t *plant, event_t event)
+{
+   plant->errorEvent = event;
+   setErrorNotification(&plant->errors, errorRaised, plant);
+}
+
+void PLTaddSample(plant_t *plant, channel_t channel, sensorValue_t value)
+{
+   plantAggregate_t *aggregate = &plant->sensors[channel];
+
+   if (aggregate->count == 0 || value < aggregate->min)
+   {
+      aggregate->min = value;
+   }
+   if (aggregate->count == 0 || value > aggregate->max)
+   {
+      aggregate->max = value;
+   }
+   aggregate->last = value;
+   aggregate->sum += value;
+   aggregate->count++;
+}
+
+sensorValue_t PLTaverage(const plant_t *plant, channel_t channel)
+{
+   const plantAggregate_t *aggregate = &plant->sensors[channel];
+
+   return VALaverage(aggregate->sum, aggregate->count);
+}
+
+void PLTstartTimer(plant_t *plant, int timer, uint32_t ms, event_t event)
+{
+   plant->timers[timer].deadline = PLTnow() + ms;
+   plant->timers[timer].event = event;
+   plant->timers[timer].running = 1;
+}
+
+void PLTstopTimer(plant_t *plant, int timer)
+{
+   plant->timers[timer].running = 0;
+}
+
+void PLTprocessTimers(plant_t *plant, uint32_t now)
+{
+   fsm_context_t *selected = FSM_GetContext();
+
+   for (int i = 0; i < PLT_NOF_TIMERS; i++)
+   {
+      plantTimer_t *timer = &plant->timers[i];
+
+      // Signed difference, so the wrap around of the ms counter is handled
+      if (timer->running && (int32_t)(now - timer->deadline) >= 0)
+      {
+         timer->running = 0;
+         FSM_SelectContext(&plant->fsm);
+         FSM_AddEvent(timer->event);
+      }
+   }
+   FSM_SelectContext(selected);
+}
+
+/// Formats the last reading of channel, "-" if there is none.
+static void formatReading(char text[], const plant_t *plant, channel_t channel)
+{
+   if (plant->sensors[channel].count == 0)
+   {
+      strcpy(text, "-");
+      return;
+   }
+   VALformat(text, 6, plant->sensors[channel].last);
+}
+
+void PLTformatStatus(char text[], int size, size_t index, void *plants)
+{
+   extern const char * const stateEnumToText[];
+   extern const char * const lightStateEnumToText[];
+   const plant_t *plant = &((const plant_t *)plants)[index];
+   char co2[6];
+   char moisture[6];
+   char temperature[6];
+
+   formatReading(co2, plant, CH_CO2);
+   formatReading(moisture, plant, CH_MOISTURE);
+   formatReading(temperature, plant, CH_TEMPERATURE);
+   snprintf(text, size, "%5u %-6.6s %-13.13s C%5s M%5s T%5s",
+            (unsigned)plant->id, lightStateEnumToText[plant->lightstatus],
+            stateEnumToText[plant->fsm.state], co2, moisture, temperature);
+}
+
+uint32_t PLTnow(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   // While replaying the recorded time is used
+   return RECtime((uint32_t)(now.tv_sec * 1000u + now.tv_nsec / 1000000));
+}
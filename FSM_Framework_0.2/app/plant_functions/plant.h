@@ -0,0 +1,86 @@
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdint.h>
+
+#include "channels.h"
+#include "console_functions/systemErrors.h"
+#include "fsm_functions/fsm.h"
+#include "sensor_functions/sensorValue.h"
+
+//------------------------------------------------------------------------ PLanT
+
+#define PLT_NOF_TIMERS 4 ///< The number of timers of one plant
+#define PLT_STATUS_WIDTH 47 ///< Number of columns of PLTformatStatus()
+
+/// Aggregated sensor readings of one channel.
+typedef struct {
+   sensorValue_t last;  ///< Last reading
+   sensorValue_t min;   ///< Lowest reading
+   sensorValue_t max;   ///< Highest reading
+   sensorSum_t sum;     ///< Sum of all readings, for the average
+   uint32_t count;      ///< Number of readings
+} plantAggregate_t;
+
+/// One shot timer, posts event in the plant FSM when it expires.
+typedef struct {
+   uint32_t deadline;   ///< Expiry time in ms, see PLTnow()
+   event_t event;       ///< Event posted on expiry
+   uint8_t running;
+} plantTimer_t;
+
+/// All runtime data of one plant module.
+typedef struct {
+   fsm_context_t fsm;                           ///< FSM instance, KEEP FIRST
+   uint32_t id;
+   int lightstatus;                             ///< 0 green, 1 orange, 2 red
+   errorSet_t errors;                           ///< Error bits of this plant
+   plantTimer_t timers[PLT_NOF_TIMERS];
+   plantAggregate_t sensors[CH_NOF_CHANNELS];
+   event_t errorEvent;                          ///< See PLTpostOnError()
+   uint8_t species;                             ///< Threshold profile, see PRFattach()
+   uint8_t band[CH_NOF_CHANNELS];               ///< Last prfBand_t, for the hysteresis
+} plant_t;
+
+/// Initialises plant and its FSM instance. The plant is not selected.
+void PLTinitialise(plant_t *plant, uint32_t id);
+
+/// Selects the FSM instance and the error bits of plant, all FSM_ and
+/// System error functions work on this plant.
+void PLTselect(plant_t *plant);
+
+/// \return the plant of the selected FSM instance, NULL if the selected
+/// instance is not a plant.
+plant_t *PLTcurrent(void);
+
+/// Posts event in the FSM instance of plant when one of its error bits is
+/// raised. The event is posted by the thread that raised the bit.
+void PLTpostOnError(plant_t *plant, event_t event);
+
+/// Adds a sensor reading to the aggregates of channel.
+void PLTaddSample(plant_t *plant, channel_t channel, sensorValue_t value);
+
+/// \return the average of all readings of channel, 0 if there are none.
+sensorValue_t PLTaverage(const plant_t *plant, channel_t channel);
+
+/// Starts a one shot timer, event will be posted after ms milliseconds.
+/// A running timer is restarted.
+void PLTstartTimer(plant_t *plant, int timer, uint32_t ms, event_t event);
+
+/// Stops a timer, the event will not be posted.
+void PLTstopTimer(plant_t *plant, int timer);
+
+/// Posts the events of all expired timers in the FSM instance of plant.
+/// \param now current time, see PLTnow()
+void PLTprocessTimers(plant_t *plant, uint32_t now);
+
+/// Formats the status of plants[index] in one line: id, light status,
+/// state and the last CO2, moisture and temperature readings.
+/// The signature matches dspCell_t, for the dashboard of the display.
+/// \param plants array of plant_t
+void PLTformatStatus(char text[], int size, size_t index, void *plants);
+
+/// \return monotonic time in milliseconds, the recorded time while replaying.
+uint32_t PLTnow(void);
+
+#endif
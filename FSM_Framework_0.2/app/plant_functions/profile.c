@@ -0,0 +1,508 @@
+#include "profile.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+//---------------------------------------------------------------------- PRoFile
+
+#define PRF_LINE_LENGTH 256
+#define PRF_PATH_LENGTH 256
+
+typedef struct profileSet profileSet_t;
+
+/// A loaded profile file, never changed after it is active.
+struct profileSet {
+   threshold_t threshold[PRF_MAX_SPECIES][CH_NOF_CHANNELS];
+   uint32_t generation;
+   profileSet_t *next;        ///< Next retired set
+};
+
+extern const char * const channelEnumToText[];
+
+/// Bounds without a profile file
+static const threshold_t builtin = { VAL(10), VAL(20), VAL(25), 0 };
+
+#define PRF_MAX_READERS 16   ///< Threads with a slot, more threads read under lock
+
+/// The set a reader thread uses, NULL between reads. Each slot has a cache
+/// line of its own, the readers do not write a shared line.
+typedef struct {
+   _Alignas(64) _Atomic(const profileSet_t *) set;
+   atomic_bool used;          ///< Claimed by a thread
+} prfReader_t;
+
+static _Atomic(const profileSet_t *) active = NULL;
+static prfReader_t readers[PRF_MAX_READERS];
+static _Thread_local prfReader_t *slot = NULL;
+static _Thread_local bool slotless = false;   ///< All slots were taken
+static pthread_key_t slotKey;
+static pthread_once_t slotOnce = PTHREAD_ONCE_INIT;
+static profileSet_t *retired = NULL;   ///< Replaced sets, freed when no slot holds them
+static uint32_t generation = 0;
+
+/// Species names, index 0 is "default". Only added, so the index in a plant
+/// stays valid for every set.
+static char species[PRF_MAX_SPECIES][PRF_NAME_LENGTH] = { "default" };
+static int nofSpecies = 1;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_t watcher;
+static bool watcherRunning = false;
+static bool stopWatcher = false;
+static char watchPath[PRF_PATH_LENGTH];
+static uint32_t watchPeriod;
+
+/// \return the index of name, added if create is set, -1 if not found or full.
+/// The caller holds lock.
+static int findSpecies(const char name[], bool create)
+{
+   for (int i = 0; i < nofSpecies; i++)
+   {
+      if (strcmp(species[i], name) == 0)
+      {
+         return i;
+      }
+   }
+   if (!create || nofSpecies == PRF_MAX_SPECIES)
+   {
+      return -1;
+   }
+   snprintf(species[nofSpecies], PRF_NAME_LENGTH, "%s", name);
+   return nofSpecies++;
+}
+
+static int findChannel(const char name[])
+{
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      // "CH_CO2" or "CO2"
+      if (strcmp(channelEnumToText[ch], name) == 0 ||
+          strcmp(channelEnumToText[ch] + 3, name) == 0)
+      {
+         return ch;
+      }
+   }
+   return -1;
+}
+
+/// Parses "species channel low normal high [hysteresis]".
+/// \return true if the line is valid.
+static bool parseLine(const char line[], int *speciesIndex, int *channel,
+                      threshold_t *threshold)
+{
+   char name[PRF_NAME_LENGTH];
+   char channelName[24];
+   sensorValue_t *bounds[] = { &threshold->low, &threshold->normal,
+                               &threshold->high, &threshold->hysteresis };
+   const char *p;
+   const char *end;
+   int n = 0;
+
+   if (sscanf(line, "%15s %23s %n", name, channelName, &n) != 2 || n == 0)
+   {
+      return false;
+   }
+   *channel = findChannel(channelName);
+
+   p = line + n;
+   threshold->hysteresis = 0;
+   for (int i = 0; i < 4; i++)
+   {
+      *bounds[i] = VALparse(p, &end);
+      if (end == p)
+      {
+         // Only the hysteresis is optional
+         if (i < 3)
+         {
+            return false;
+         }
+         threshold->hysteresis = 0;
+         break;
+      }
+      p = end;
+   }
+   while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+   {
+      p++;
+   }
+
+   if (*p != '\0' || *channel < 0 || threshold->low >= threshold->normal ||
+       threshold->normal >= threshold->high || threshold->hysteresis < 0)
+   {
+      return false;
+   }
+
+   // Only a valid line adds its species
+   *speciesIndex = findSpecies(name, true);
+   return *speciesIndex >= 0;
+}
+
+/// \return true if a reader slot holds set.
+static bool inUse(const profileSet_t *set)
+{
+   for (int i = 0; i < PRF_MAX_READERS; i++)
+   {
+      if (atomic_load(&readers[i].set) == set)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+/// Frees the retired sets that no reader slot holds. A reader that starts
+/// after its set was replaced uses a later set, so at most PRF_MAX_READERS
+/// sets stay retired. The slotless readers hold lock while they read.
+/// The caller holds lock.
+static void collect(void)
+{
+   profileSet_t **link = &retired;
+
+   while (*link != NULL)
+   {
+      profileSet_t *set = *link;
+
+      if (inUse(set))
+      {
+         link = &set->next;
+      }
+      else
+      {
+         *link = set->next;
+         free(set);
+      }
+   }
+}
+
+/// Makes set the active set, the replaced set is freed by a later collect().
+/// The caller holds lock.
+static void replace(profileSet_t *set)
+{
+   profileSet_t *old = (profileSet_t *)atomic_exchange(&active, set);
+
+   if (old != NULL)
+   {
+      old->next = retired;
+      retired = old;
+   }
+   collect();
+}
+
+int PRFload(const char path[])
+{
+   FILE *file = fopen(path, "r");
+   char line[PRF_LINE_LENGTH];
+   bool own[PRF_MAX_SPECIES][CH_NOF_CHANNELS] = {{false}};
+   profileSet_t *set;
+   int number = 0;
+   int error = 0;
+
+   if (file == NULL)
+   {
+      return -1;
+   }
+   set = malloc(sizeof(profileSet_t));
+   if (set == NULL)
+   {
+      fclose(file);
+      return -1;
+   }
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      set->threshold[0][ch] = builtin;
+   }
+
+   pthread_mutex_lock(&lock);
+   while (error == 0 && fgets(line, sizeof(line), file) != NULL)
+   {
+      const char *p = line;
+      threshold_t threshold;
+      int index;
+      int channel;
+
+      number++;
+      while (*p == ' ' || *p == '\t')
+      {
+         p++;
+      }
+      if (*p == '#' || *p == '\r' || *p == '\n' || *p == '\0')
+      {
+         continue;
+      }
+      if (!parseLine(p, &index, &channel, &threshold))
+      {
+         error = number;
+         break;
+      }
+      set->threshold[index][channel] = threshold;
+      own[index][channel] = true;
+   }
+   fclose(file);
+
+   if (error != 0)
+   {
+      pthread_mutex_unlock(&lock);
+      free(set);
+      return error;
+   }
+
+   // Species without a line of their own use the default bounds
+   for (int i = 1; i < PRF_MAX_SPECIES; i++)
+   {
+      for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+      {
+         if (!own[i][ch])
+         {
+            set->threshold[i][ch] = set->threshold[0][ch];
+         }
+      }
+   }
+   set->generation = ++generation;
+   replace(set);
+   pthread_mutex_unlock(&lock);
+   return 0;
+}
+
+static void *watcherThread(void *arg)
+{
+   struct stat loaded = {0};
+   struct stat st;
+
+   (void)arg;
+   if (stat(watchPath, &st) == 0)
+   {
+      loaded = st;
+   }
+
+   pthread_mutex_lock(&lock);
+   while (!stopWatcher)
+   {
+      struct timespec until;
+
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_sec += watchPeriod / 1000;
+      until.tv_nsec += (long)(watchPeriod % 1000) * 1000000L;
+      if (until.tv_nsec >= 1000000000L)
+      {
+         until.tv_sec++;
+         until.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&wakeup, &lock, &until);
+      if (stopWatcher)
+      {
+         break;
+      }
+      pthread_mutex_unlock(&lock);
+
+      if (stat(watchPath, &st) == 0 &&
+          (st.st_mtime != loaded.st_mtime || st.st_size != loaded.st_size))
+      {
+         // An invalid file is reloaded when it changes again
+         PRFload(watchPath);
+         loaded = st;
+      }
+
+      pthread_mutex_lock(&lock);
+      // Sets of a reload that met a reader
+      collect();
+   }
+   pthread_mutex_unlock(&lock);
+   return NULL;
+}
+
+int PRFwatch(const char path[], uint32_t periodMs)
+{
+   PRFload(path);
+
+   if (!watcherRunning)
+   {
+      snprintf(watchPath, PRF_PATH_LENGTH, "%s", path);
+      watchPeriod = periodMs;
+      stopWatcher = false;
+      if (pthread_create(&watcher, NULL, watcherThread, NULL) != 0)
+      {
+         return -1;
+      }
+      watcherRunning = true;
+   }
+   return 0;
+}
+
+void PRFstop(void)
+{
+   if (watcherRunning)
+   {
+      pthread_mutex_lock(&lock);
+      stopWatcher = true;
+      pthread_cond_signal(&wakeup);
+      pthread_mutex_unlock(&lock);
+      pthread_join(watcher, NULL);
+      watcherRunning = false;
+   }
+}
+
+int PRFattach(plant_t *plant, const char name[])
+{
+   int index;
+
+   pthread_mutex_lock(&lock);
+   index = findSpecies(name, true);
+   pthread_mutex_unlock(&lock);
+   if (index < 0)
+   {
+      return -1;
+   }
+   plant->species = (uint8_t)index;
+   return 0;
+}
+
+/// Frees the slot of an exiting thread.
+static void releaseSlot(void *data)
+{
+   prfReader_t *reader = data;
+
+   atomic_store_explicit(&reader->used, false, memory_order_release);
+}
+
+static void createSlotKey(void)
+{
+   pthread_key_create(&slotKey, releaseSlot);
+}
+
+/// Claims a reader slot for the calling thread, once.
+static void claimSlot(void)
+{
+   pthread_once(&slotOnce, createSlotKey);
+   for (int i = 0; i < PRF_MAX_READERS; i++)
+   {
+      bool expected = false;
+
+      if (atomic_compare_exchange_strong(&readers[i].used, &expected, true))
+      {
+         slot = &readers[i];
+         pthread_setspecific(slotKey, slot);
+         return;
+      }
+   }
+   slotless = true;
+}
+
+/// \return the active set, it is not freed before endRead().
+static const profileSet_t *beginRead(void)
+{
+   const profileSet_t *set;
+   const profileSet_t *again;
+
+   if (slot == NULL && !slotless)
+   {
+      claimSlot();
+   }
+   if (slot == NULL)
+   {
+      pthread_mutex_lock(&lock);
+      return atomic_load_explicit(&active, memory_order_relaxed);
+   }
+
+   // Hold the set in the slot, then check it is still active: a replace
+   // after the check finds it in the slot. Both sequentially consistent, so
+   // the store is not moved after the load.
+   set = atomic_load(&active);
+   for (;;)
+   {
+      atomic_store(&slot->set, set);
+      again = atomic_load(&active);
+      if (again == set)
+      {
+         return set;
+      }
+      set = again;
+   }
+}
+
+/// Ends the read of beginRead().
+static void endRead(void)
+{
+   if (slot == NULL)
+   {
+      pthread_mutex_unlock(&lock);
+   }
+   else
+   {
+      atomic_store_explicit(&slot->set, NULL, memory_order_release);
+   }
+}
+
+/// \return a copy of the bounds of the active set.
+static threshold_t activeThreshold(const plant_t *plant, channel_t channel)
+{
+   const profileSet_t *set = beginRead();
+   threshold_t threshold;
+
+   threshold = (set != NULL) ? set->threshold[plant->species][channel] : builtin;
+   endRead();
+   return threshold;
+}
+
+prfBand_t PRFclassify(plant_t *plant, channel_t channel, sensorValue_t value)
+{
+   const threshold_t threshold = activeThreshold(plant, channel);
+   sensorValue_t low = threshold.low;
+   sensorValue_t normal = threshold.normal;
+   sensorValue_t high = threshold.high;
+   prfBand_t band;
+
+   // The current band is widened by the hysteresis
+   if (plant->band[channel] == PRF_LOW)
+   {
+      low -= threshold.hysteresis;
+      normal += threshold.hysteresis;
+   }
+   else if (plant->band[channel] == PRF_NORMAL)
+   {
+      normal -= threshold.hysteresis;
+      high += threshold.hysteresis;
+   }
+
+   if ((value < normal) & (value > low))
+   {
+      band = PRF_LOW;
+   }
+   else if ((value < high) & (value > normal))
+   {
+      band = PRF_NORMAL;
+   }
+   else
+   {
+      band = PRF_OUTSIDE;
+   }
+   plant->band[channel] = (uint8_t)band;
+   return band;
+}
+
+threshold_t PRFthreshold(const plant_t *plant, channel_t channel)
+{
+   return activeThreshold(plant, channel);
+}
+
+const char *PRFspecies(const plant_t *plant)
+{
+   // Names are only added, an index in a plant stays valid
+   return species[plant->species];
+}
+
+uint32_t PRFgeneration(void)
+{
+   const profileSet_t *set = beginRead();
+   uint32_t number;
+
+   number = (set != NULL) ? set->generation : 0;
+   endRead();
+   return number;
+}
@@ -0,0 +1,75 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "plant.h"
+
+//---------------------------------------------------------------------- PRoFile
+
+/// Threshold profiles: the sensor bounds per plant species and channel, read
+/// from a text file with a line per species and channel:
+///
+///    # species   channel      low  normal  high  hysteresis
+///    default     TEMPERATURE  10   20      25    0
+///    tomato      TEMPERATURE  12   18      28    0.5
+///
+/// The "default" lines apply to every species without a line of its own for
+/// the channel; without a file all bounds are 10, 20 and 25.
+///
+/// A loaded file is an immutable set that replaces the previous set with one
+/// atomic pointer swap, classifying never waits for a reload. Each reader
+/// thread holds the set it reads in a slot of its own; a replaced set is
+/// freed by a later reload or by the watcher once no slot holds it, a reload
+/// never waits for the readers either.
+
+#define PRF_MAX_SPECIES 32     ///< Species, including "default"
+#define PRF_NAME_LENGTH 16     ///< Longest species name + 1
+
+/// Bounds of one channel. A value in (low, normal) is too low, a value in
+/// (normal, high) is normal and otherwise it is out of bounds. A plant leaves
+/// its current band only when the value is hysteresis beyond the bound.
+typedef struct {
+   sensorValue_t low;
+   sensorValue_t normal;
+   sensorValue_t high;
+   sensorValue_t hysteresis;
+} threshold_t;
+
+typedef enum {
+   PRF_OUTSIDE,         ///< Out of bounds, KEEP FIRST (the initial band)
+   PRF_LOW,             ///< Too low, the plant needs an action
+   PRF_NORMAL,
+} prfBand_t;
+
+/// Loads path and replaces the active profiles.
+/// \return 0 on success, -1 if path cannot be read, or the number of the
+/// first invalid line; the active profiles are kept on an error.
+int PRFload(const char path[]);
+
+/// Loads path now and starts a thread that reloads it when it changes.
+/// \return 0 on success, -1 if the thread could not be started.
+int PRFwatch(const char path[], uint32_t periodMs);
+
+/// Stops the thread of PRFwatch().
+void PRFstop(void);
+
+/// Attaches the profile of species to the plant, the species need not be in
+/// the file (yet), it uses the "default" bounds then.
+/// \return 0 on success, -1 if there are PRF_MAX_SPECIES species already.
+int PRFattach(plant_t *plant, const char species[]);
+
+/// Classifies value of channel with the profile of the plant, updates the
+/// band of the plant for the hysteresis.
+prfBand_t PRFclassify(plant_t *plant, channel_t channel, sensorValue_t value);
+
+/// \return the active bounds of channel for the plant.
+threshold_t PRFthreshold(const plant_t *plant, channel_t channel);
+
+/// \return the species name of the plant, "default" if none is attached.
+const char *PRFspecies(const plant_t *plant);
+
+/// \return the number of loaded files, 0 for the built-in bounds.
+uint32_t PRFgeneration(void);
+
+#endif
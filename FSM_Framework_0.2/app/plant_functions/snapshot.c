@@ -0,0 +1,476 @@
+#include "snapshot.h"
+#include "profile.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------- SNaPshot
+
+#define SNP_MAGIC 0x504E5350u ///< "PSNP"
+#ifdef SENSOR_FIXED
+#define SNP_VERSION 0x104  ///< Fixed point aggregates
+#else
+#define SNP_VERSION 4
+#endif
+#define AGGREGATE_SIZE (3 * sizeof(sensorValue_t) + sizeof(sensorSum_t))
+#define SNP_PATH_LENGTH 256
+
+/// Snapshot file header, followed by size bytes of plant records.
+typedef struct {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t count;      ///< Number of plant records
+   uint32_t size;       ///< Number of bytes after the header
+   uint32_t checksum;   ///< FNV-1a of the plant records
+} snapshotHeader_t;
+
+typedef struct {
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+} snapshotBuffer_t;
+
+static snapshotBuffer_t buffers[2] = {{0}};
+static int captured = -1;  ///< Buffer with the last capture
+static int pending = -1;   ///< Buffer waiting for the writer
+static int writing = -1;   ///< Buffer the writer is busy with
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static bool writerRunning = false;
+static bool stopWriter = false;
+
+static char snapshotPath[SNP_PATH_LENGTH] = "";
+static uint32_t period = 0;
+static uint32_t lastCheckpoint = 0;
+static bool checkpointed = false;
+
+static uint32_t checksum(const uint8_t *data, size_t size)
+{
+   uint32_t hash = 2166136261u;
+
+   for (size_t i = 0; i < size; i++)
+   {
+      hash = (hash ^ data[i]) * 16777619u;
+   }
+   return hash;
+}
+
+static uint8_t *put(uint8_t *p, const void *value, size_t size)
+{
+   memcpy(p, value, size);
+   return p + size;
+}
+
+static const uint8_t *get(const uint8_t *p, void *value, size_t size)
+{
+   memcpy(value, p, size);
+   return p + size;
+}
+
+/// \return the worst case record size of one plant.
+static size_t recordSize(void)
+{
+   return sizeof(uint32_t) + 3 + sizeof(systemErrors_t) + MAX_EVENTS_IN_BUFFER
+        + 1 + MAX_INTERNAL_EVENTS + 1 + PLT_NOF_TIMERS * (sizeof(uint32_t) + 1)
+        + CH_NOF_CHANNELS * (sizeof(uint32_t) + AGGREGATE_SIZE)
+        + 1 + PRF_NAME_LENGTH + CH_NOF_CHANNELS;
+}
+
+static uint8_t *encodePlant(uint8_t *p, const plant_t *plant, uint32_t now)
+{
+   const fsm_context_t *fsm = &plant->fsm;
+   const uint8_t tail = atomic_load_explicit(&fsm->tail, memory_order_relaxed);
+   uint8_t nofEvents = (atomic_load_explicit(&fsm->head, memory_order_acquire) - tail) &
+                       (MAX_EVENTS_IN_BUFFER - 1);
+   uint8_t nofInternal = (fsm->internal_head - fsm->internal_tail) & (MAX_INTERNAL_EVENTS - 1);
+   uint8_t timerMask = 0;
+   const char *species = PRFspecies(plant);
+   systemErrors_t errors;
+
+   p = put(p, &plant->id, sizeof(uint32_t));
+   *p++ = (uint8_t)fsm->state;
+   *p++ = (uint8_t)plant->lightstatus;
+   errors = getErrorBits(&plant->errors);
+   p = put(p, &errors, sizeof(systemErrors_t));
+
+   // Pending events, oldest first
+   *p++ = nofEvents;
+   for (uint8_t i = 1; i <= nofEvents; i++)
+   {
+      *p++ = (uint8_t)fsm->events[(tail + i) & (MAX_EVENTS_IN_BUFFER - 1)];
+   }
+
+   // Run-to-completion channel, a run that stopped at a cycle continues
+   *p++ = nofInternal;
+   for (uint8_t i = 1; i <= nofInternal; i++)
+   {
+      *p++ = (uint8_t)fsm->internal_events[(fsm->internal_tail + i) & (MAX_INTERNAL_EVENTS - 1)];
+   }
+
+   // Running timers, stored as remaining time
+   for (int i = 0; i < PLT_NOF_TIMERS; i++)
+   {
+      timerMask |= plant->timers[i].running << i;
+   }
+   *p++ = timerMask;
+   for (int i = 0; i < PLT_NOF_TIMERS; i++)
+   {
+      if (plant->timers[i].running)
+      {
+         int32_t remaining = (int32_t)(plant->timers[i].deadline - now);
+         uint32_t ms = remaining > 0 ? (uint32_t)remaining : 0;
+
+         p = put(p, &ms, sizeof(uint32_t));
+         *p++ = (uint8_t)plant->timers[i].event;
+      }
+   }
+
+   // Sensor aggregates, empty channels only take the count
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      const plantAggregate_t *aggregate = &plant->sensors[ch];
+
+      p = put(p, &aggregate->count, sizeof(uint32_t));
+      if (aggregate->count != 0)
+      {
+         // last, min and max in one go
+         p = put(p, &aggregate->last, 3 * sizeof(sensorValue_t));
+         p = put(p, &aggregate->sum, sizeof(sensorSum_t));
+      }
+   }
+
+   // Profile by species name, the index depends on the load order; the bands
+   // keep their hysteresis
+   *p++ = (uint8_t)strlen(species);
+   p = put(p, species, strlen(species));
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      *p++ = plant->band[ch];
+   }
+   return p;
+}
+
+static const uint8_t *decodePlant(const uint8_t *p, const uint8_t *end,
+                                  plant_t *plant, uint32_t now)
+{
+   uint32_t id;
+   uint8_t nofEvents;
+   uint8_t nofInternal;
+   uint8_t timerMask;
+   uint8_t nameLength;
+   char name[PRF_NAME_LENGTH];
+   systemErrors_t errors;
+   // A plant that does not decode is left as it is
+   plant_t decoded = *plant;
+
+   if (end - p < (long)(sizeof(uint32_t) + 3 + sizeof(systemErrors_t) + 1))
+   {
+      return NULL;
+   }
+   p = get(p, &id, sizeof(uint32_t));
+
+   // Only the data of the snapshot is replaced, e.g. the error notification
+   // of the plant stays
+   FSM_InitContext(&decoded.fsm, plant);
+   decoded.id = id;
+   memset(decoded.timers, 0, sizeof(decoded.timers));
+   memset(decoded.sensors, 0, sizeof(decoded.sensors));
+   if (p[0] >= S_NOF_STATES || p[1] > 2)
+   {
+      return NULL;
+   }
+   decoded.fsm.state = (state_t)*p++;
+   decoded.lightstatus = *p++;
+   p = get(p, &errors, sizeof(systemErrors_t));
+   // Restored, not raised: no notification, the events are in the snapshot
+   atomic_store_explicit(&decoded.errors.bits, errors, memory_order_release);
+
+   nofEvents = *p++;
+   if (nofEvents >= MAX_EVENTS_IN_BUFFER || end - p < nofEvents + 1)
+   {
+      return NULL;
+   }
+   for (uint8_t i = 1; i <= nofEvents; i++)
+   {
+      decoded.fsm.events[i] = (event_t)*p++;
+   }
+   atomic_store_explicit(&decoded.fsm.claim, nofEvents, memory_order_relaxed);
+   atomic_store_explicit(&decoded.fsm.head, nofEvents, memory_order_release);
+
+   nofInternal = *p++;
+   if (nofInternal >= MAX_INTERNAL_EVENTS || end - p < nofInternal + 1)
+   {
+      return NULL;
+   }
+   for (uint8_t i = 1; i <= nofInternal; i++)
+   {
+      decoded.fsm.internal_events[i] = (event_t)*p++;
+   }
+   decoded.fsm.internal_head = nofInternal;
+
+   timerMask = *p++;
+   for (int i = 0; i < PLT_NOF_TIMERS; i++)
+   {
+      if (timerMask & (1 << i))
+      {
+         uint32_t ms;
+
+         if (end - p < 5)
+         {
+            return NULL;
+         }
+         p = get(p, &ms, sizeof(uint32_t));
+         decoded.timers[i].deadline = now + ms;
+         decoded.timers[i].event = (event_t)*p++;
+         decoded.timers[i].running = 1;
+      }
+   }
+
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      plantAggregate_t *aggregate = &decoded.sensors[ch];
+
+      if (end - p < 4)
+      {
+         return NULL;
+      }
+      p = get(p, &aggregate->count, sizeof(uint32_t));
+      if (aggregate->count != 0)
+      {
+         if (end - p < (long)AGGREGATE_SIZE)
+         {
+            return NULL;
+         }
+         p = get(p, &aggregate->last, 3 * sizeof(sensorValue_t));
+         p = get(p, &aggregate->sum, sizeof(sensorSum_t));
+      }
+   }
+
+   if (end - p < 1 || *p >= PRF_NAME_LENGTH || end - p < 1 + *p + CH_NOF_CHANNELS)
+   {
+      return NULL;
+   }
+   nameLength = *p++;
+   p = get(p, name, nameLength);
+   name[nameLength] = '\0';
+   if (PRFattach(&decoded, name) != 0)
+   {
+      decoded.species = 0;
+   }
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      decoded.band[ch] = *p++;
+   }
+   *plant = decoded;
+   return p;
+}
+
+static int writeBuffer(const char path[], const snapshotBuffer_t *buffer)
+{
+   char tmpPath[SNP_PATH_LENGTH + 4];
+   FILE *file;
+   size_t written;
+
+   snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+   file = fopen(tmpPath, "wb");
+   if (file == NULL)
+   {
+      return -1;
+   }
+   written = fwrite(buffer->data, 1, buffer->size, file);
+   if (fclose(file) != 0 || written != buffer->size)
+   {
+      remove(tmpPath);
+      return -1;
+   }
+
+#ifdef _WIN32
+   remove(path); // rename() does not replace an existing file
+#endif
+   return rename(tmpPath, path) == 0 ? 0 : -1;
+}
+
+static void *writerThread(void *arg)
+{
+   (void)arg;
+
+   pthread_mutex_lock(&lock);
+   while (!stopWriter || pending >= 0)
+   {
+      if (pending < 0)
+      {
+         pthread_cond_wait(&wakeup, &lock);
+         continue;
+      }
+      writing = pending;
+      pending = -1;
+      pthread_mutex_unlock(&lock);
+
+      writeBuffer(snapshotPath, &buffers[writing]);
+
+      pthread_mutex_lock(&lock);
+      writing = -1;
+   }
+   pthread_mutex_unlock(&lock);
+   return NULL;
+}
+
+int SNPinitialise(const char path[], uint32_t periodMs)
+{
+   strncpy(snapshotPath, path, SNP_PATH_LENGTH - 1);
+   period = periodMs;
+   checkpointed = false;
+
+   if (!writerRunning)
+   {
+      stopWriter = false;
+      if (pthread_create(&writer, NULL, writerThread, NULL) != 0)
+      {
+         return -1;
+      }
+      writerRunning = true;
+   }
+   return 0;
+}
+
+void SNPterminate(void)
+{
+   if (writerRunning)
+   {
+      pthread_mutex_lock(&lock);
+      stopWriter = true;
+      pthread_cond_signal(&wakeup);
+      pthread_mutex_unlock(&lock);
+      pthread_join(writer, NULL);
+      writerRunning = false;
+   }
+}
+
+bool SNPcheckpoint(const plant_t plants[], size_t n)
+{
+   uint32_t now = PLTnow();
+
+   if (checkpointed && now - lastCheckpoint < period)
+   {
+      return false;
+   }
+   lastCheckpoint = now;
+   checkpointed = true;
+   return SNPcapture(plants, n) >= 0;
+}
+
+long SNPcapture(const plant_t plants[], size_t n)
+{
+   snapshotBuffer_t *buffer;
+   snapshotHeader_t header = {SNP_MAGIC, SNP_VERSION, (uint32_t)n, 0, 0};
+   size_t capacity = sizeof(snapshotHeader_t) + n * recordSize();
+   uint32_t now = PLTnow();
+   uint8_t *p;
+   int index;
+
+   // Take the buffer the writer is not busy with
+   pthread_mutex_lock(&lock);
+   index = (writing == 0) ? 1 : 0;
+   if (pending == index)
+   {
+      pending = -1;
+   }
+   captured = -1;
+   pthread_mutex_unlock(&lock);
+
+   buffer = &buffers[index];
+   if (buffer->capacity < capacity)
+   {
+      uint8_t *data = realloc(buffer->data, capacity);
+
+      if (data == NULL)
+      {
+         return -1;
+      }
+      buffer->data = data;
+      buffer->capacity = capacity;
+   }
+
+   p = buffer->data + sizeof(snapshotHeader_t);
+   for (size_t i = 0; i < n; i++)
+   {
+      p = encodePlant(p, &plants[i], now);
+   }
+   buffer->size = p - buffer->data;
+
+   header.size = buffer->size - sizeof(snapshotHeader_t);
+   header.checksum = checksum(buffer->data + sizeof(snapshotHeader_t), header.size);
+   memcpy(buffer->data, &header, sizeof(snapshotHeader_t));
+
+   // Hand the snapshot to the writer
+   pthread_mutex_lock(&lock);
+   captured = index;
+   if (writerRunning)
+   {
+      pending = index;
+      pthread_cond_signal(&wakeup);
+   }
+   pthread_mutex_unlock(&lock);
+
+   return (long)buffer->size;
+}
+
+int SNPwrite(const char path[])
+{
+   int result = -1;
+
+   pthread_mutex_lock(&lock);
+   if (captured >= 0)
+   {
+      result = writeBuffer(path, &buffers[captured]);
+   }
+   pthread_mutex_unlock(&lock);
+   return result;
+}
+
+long SNPrestore(const char path[], plant_t plants[], size_t n)
+{
+   snapshotHeader_t header;
+   FILE *file = fopen(path, "rb");
+   uint8_t *data;
+   const uint8_t *p;
+   uint32_t now = PLTnow();
+   long restored = -1;
+
+   if (file == NULL)
+   {
+      return -1;
+   }
+   if (fread(&header, sizeof(header), 1, file) != 1 ||
+       header.magic != SNP_MAGIC || header.version != SNP_VERSION)
+   {
+      fclose(file);
+      return -1;
+   }
+
+   data = malloc(header.size);
+   if (data != NULL && fread(data, 1, header.size, file) == header.size &&
+       checksum(data, header.size) == header.checksum)
+   {
+      p = data;
+      restored = 0;
+      while ((size_t)restored < n && restored < (long)header.count)
+      {
+         p = decodePlant(p, data + header.size, &plants[restored], now);
+         if (p == NULL)
+         {
+            restored = -1;
+            break;
+         }
+         restored++;
+      }
+   }
+
+   free(data);
+   fclose(file);
+   return restored;
+}
@@ -0,0 +1,50 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plant.h"
+
+//--------------------------------------------------------------------- SNaPshot
+
+/// A snapshot holds per plant: the FSM state, the pending events and internal
+/// events, the running timers (remaining time), the light status, the error
+/// bits, the sensor aggregates, the species and the bands of the profile. The
+/// file starts with a header with a checksum, a damaged or truncated file is
+/// never restored.
+///
+/// Capturing only encodes the plants into a memory buffer, writing the file is
+/// done by a writer thread. Two buffers are used: a capture never waits for a
+/// write in progress, the writer always writes the most recent capture.
+
+/// Initialises the SNaPshot subsystem and starts the writer thread.
+/// \param path snapshot file, written via path + ".tmp" and renamed
+/// \param periodMs minimal time between two checkpoints, see SNPcheckpoint()
+/// \return 0 on success, -1 if the writer thread could not be started.
+int SNPinitialise(const char path[], uint32_t periodMs);
+
+/// Writes the last capture (if not yet written) and stops the writer thread.
+void SNPterminate(void);
+
+/// Captures the plants if the checkpoint period has elapsed.
+/// Call this between two dispatches, e.g. from an onEntry() function.
+/// \return true if a snapshot has been captured.
+bool SNPcheckpoint(const plant_t plants[], size_t n);
+
+/// Captures the plants and hands the snapshot to the writer thread.
+/// \return size of the snapshot in bytes, -1 on out of memory.
+long SNPcapture(const plant_t plants[], size_t n);
+
+/// Writes the last capture to path in the calling thread.
+/// \return 0 on success, -1 on error.
+int SNPwrite(const char path[]);
+
+/// Restores the plants from the snapshot file (warm start). Only the data of
+/// the snapshot is replaced, the rest of a plant is kept, e.g. its error
+/// notification. Initialise the plants with PLTinitialise() first.
+/// \return the number of restored plants, -1 if there is no valid snapshot.
+long SNPrestore(const char path[], plant_t plants[], size_t n);
+
+#endif
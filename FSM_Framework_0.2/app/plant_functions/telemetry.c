@@ -0,0 +1,252 @@
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//-------------------------------------------------------------------- TELemetry
+
+#define TEL_RETRIES 1000   ///< Reads of a slot before a viewer gives up
+
+static telemetry_t *segment = NULL;   ///< Segment of the controller
+static size_t segmentSize = 0;
+static char segmentName[64];
+#ifdef _WIN32
+static HANDLE mapping = NULL;
+#endif
+
+static size_t sizeOf(uint32_t nofSlots)
+{
+   return sizeof(telemetry_t) + nofSlots * sizeof(telemetrySlot_t);
+}
+
+int TELopen(const char name[], uint32_t nofSlots)
+{
+   size_t size = sizeOf(nofSlots);
+   void *p;
+
+   TELclose();
+#ifdef _WIN32
+   mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                0, (DWORD)size, name);
+   if (mapping == NULL)
+   {
+      return -1;
+   }
+   p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+   if (p == NULL)
+   {
+      CloseHandle(mapping);
+      mapping = NULL;
+      return -1;
+   }
+#else
+   int fd;
+
+   // A new segment: truncating a stale one would pull the pages from under
+   // a viewer that still maps it, it keeps the old pages after the unlink
+   shm_unlink(name);
+   fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+   if (fd < 0)
+   {
+      return -1;
+   }
+   if (ftruncate(fd, size) != 0)
+   {
+      close(fd);
+      shm_unlink(name);
+      return -1;
+   }
+   p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (p == MAP_FAILED)
+   {
+      shm_unlink(name);
+      return -1;
+   }
+#endif
+   segment = p;
+   segmentSize = size;
+   snprintf(segmentName, sizeof(segmentName), "%s", name);
+
+   memset(segment, 0, size);
+   segment->version = TEL_VERSION;
+   segment->nofSlots = nofSlots;
+#ifdef _WIN32
+   segment->pid = (uint32_t)GetCurrentProcessId();
+#else
+   segment->pid = (uint32_t)getpid();
+#endif
+   // A viewer checks the magic last
+   atomic_thread_fence(memory_order_release);
+   segment->magic = TEL_MAGIC;
+   return 0;
+}
+
+void TELclose(void)
+{
+   if (segment == NULL)
+   {
+      return;
+   }
+#ifdef _WIN32
+   UnmapViewOfFile(segment);
+   CloseHandle(mapping);
+   mapping = NULL;
+#else
+   munmap(segment, segmentSize);
+   shm_unlink(segmentName);
+#endif
+   segment = NULL;
+}
+
+void TELpublish(const plant_t *plant)
+{
+   telemetrySlot_t *slot;
+   telemetryData_t *data;
+   uint32_t seq;
+
+   if (segment == NULL || plant->id >= segment->nofSlots)
+   {
+      return;
+   }
+   slot = &segment->slot[plant->id];
+   data = &slot->data;
+
+   // Odd: a viewer that reads now retries
+   seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+   atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+   atomic_thread_fence(memory_order_release);
+
+   data->id = plant->id;
+   data->state = plant->fsm.state;
+   data->queue = (uint8_t)(atomic_load_explicit(&plant->fsm.head, memory_order_relaxed) -
+                           atomic_load_explicit(&plant->fsm.tail, memory_order_relaxed)) %
+                 MAX_EVENTS_IN_BUFFER;
+   data->handled = plant->fsm.handled;
+   data->overruns = plant->fsm.overruns;
+   data->errors = getErrorBits(&plant->errors);
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      const plantAggregate_t *sensor = &plant->sensors[ch];
+
+      data->tenths[ch] = (sensor->count == 0 || VAL_IS_NONE(sensor->last))
+                       ? TEL_NONE : VAL_TO_TENTHS(sensor->last);
+   }
+
+   atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+const telemetry_t *TELattach(const char name[])
+{
+   telemetry_t header;
+   const telemetry_t *telemetry;
+#ifdef _WIN32
+   HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+   const telemetry_t *view;
+
+   if (handle == NULL)
+   {
+      return NULL;
+   }
+   // The view of the whole mapping, its size is known after mapping
+   view = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+   CloseHandle(handle);
+   if (view == NULL)
+   {
+      return NULL;
+   }
+   memcpy(&header, view, sizeof(header));
+   telemetry = view;
+#else
+   int fd = shm_open(name, O_RDONLY, 0);
+   void *p;
+
+   if (fd < 0)
+   {
+      return NULL;
+   }
+   if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+   {
+      close(fd);
+      return NULL;
+   }
+   p = mmap(NULL, sizeOf(header.nofSlots), PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (p == MAP_FAILED)
+   {
+      return NULL;
+   }
+   telemetry = p;
+#endif
+   if (header.magic != TEL_MAGIC || header.version != TEL_VERSION)
+   {
+      TELdetach(telemetry);
+      return NULL;
+   }
+   return telemetry;
+}
+
+void TELdetach(const telemetry_t *telemetry)
+{
+#ifdef _WIN32
+   UnmapViewOfFile(telemetry);
+#else
+   munmap((void *)telemetry, sizeOf(telemetry->nofSlots));
+#endif
+}
+
+bool TELread(const telemetry_t *telemetry, uint32_t index, telemetryData_t *data)
+{
+   const telemetrySlot_t *slot;
+   uint32_t seq;
+
+   if (index >= telemetry->nofSlots)
+   {
+      return false;
+   }
+   slot = &telemetry->slot[index];
+   // Bounded, a controller that stopped while writing leaves the slot odd
+   for (int i = 0; i < TEL_RETRIES; i++)
+   {
+      seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+      if (seq & 1)
+      {
+         continue;
+      }
+      memcpy(data, (const void *)&slot->data, sizeof(*data));
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+bool TELalive(const telemetry_t *telemetry)
+{
+#ifdef _WIN32
+   HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)telemetry->pid);
+   bool running;
+
+   if (process == NULL)
+   {
+      return false;
+   }
+   running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+   CloseHandle(process);
+   return running;
+#else
+   // Signal 0 only checks the process, EPERM: it runs as another user
+   return kill((pid_t)telemetry->pid, 0) == 0 || errno == EPERM;
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plant.h"
+
+//-------------------------------------------------------------------- TELemetry
+
+/// Live telemetry of the plants in a shared memory segment, read by fsmtop.
+/// The controller publishes one slot per plant; publishing only stores to
+/// memory, a slot is protected by a sequence lock so a viewer never blocks
+/// the controller. A viewer copies a slot and retries if it was written
+/// meanwhile. A viewer never waits for the controller: it gives up on a slot
+/// after a bounded number of retries and checks the pid of the controller.
+
+#define TEL_MAGIC 0x4C455446u ///< "FTEL"
+#define TEL_VERSION 1
+#define TEL_NONE INT32_MIN    ///< No reading on the channel
+
+/// Published data of one plant.
+typedef struct {
+   uint32_t id;
+   uint32_t state;                     ///< Current state_t
+   uint32_t queue;                     ///< Events in the event buffer
+   uint32_t handled;                   ///< Events handled, for the event rate
+   uint32_t overruns;                  ///< Handler budget overruns
+   uint64_t errors;                    ///< System error bits
+   int32_t tenths[CH_NOF_CHANNELS];    ///< Last readings in tenths, or TEL_NONE
+} telemetryData_t;
+
+/// One slot per plant, in its own cache line.
+typedef struct {
+   _Alignas(64) _Atomic uint32_t seq;  ///< Odd while the data is written
+   telemetryData_t data;
+} telemetrySlot_t;
+
+/// The shared memory segment.
+typedef struct {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t nofSlots;
+   uint32_t pid;                       ///< Process id of the controller
+   telemetrySlot_t slot[];
+} telemetry_t;
+
+/// Creates the shared memory segment name with nofSlots slots (controller).
+/// \return 0 on success, -1 on error, publishing is a no-op then.
+int TELopen(const char name[], uint32_t nofSlots);
+
+/// Removes the shared memory segment (controller).
+void TELclose(void);
+
+/// Publishes the plant in the slot of its id, if there is one.
+void TELpublish(const plant_t *plant);
+
+/// Maps the shared memory segment name read-only (viewer).
+/// \return the segment, NULL if no controller has created it.
+const telemetry_t *TELattach(const char name[]);
+
+/// Unmaps a segment of TELattach().
+void TELdetach(const telemetry_t *telemetry);
+
+/// Copies a consistent snapshot of slot index into data, retries a bounded
+/// number of times while the slot is written.
+/// \return false if index is not a slot of the segment, or the slot stayed
+/// in a write, e.g. the controller stopped while publishing; see TELalive().
+bool TELread(const telemetry_t *telemetry, uint32_t index, telemetryData_t *data);
+
+/// \return true if the controller of the segment still runs, a segment of a
+/// controller that stopped without TELclose() is stale.
+bool TELalive(const telemetry_t *telemetry);
+
+#endif
@@ -15,3 +15,10 @@ void S_logerror_onEntry(void);
 void S_airflow_onEntry(void);
 void S_moisturize_onEntry(void);
 void S_heat_onEntry(void);
+
+//State Functions of the Monte Carlo simulation
+void S_Init_onSimulate(void);
+void S_logerror_onSimulate(void);
+void S_airflow_onSimulate(void);
+void S_moisturize_onSimulate(void);
+void S_heat_onSimulate(void);
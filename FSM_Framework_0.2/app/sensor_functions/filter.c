@@ -0,0 +1,289 @@
+#include "filter.h"
+
+#include <stdlib.h>
+
+// The kernels are written for the vectoriser, at -O2 (and in debug builds) it
+// leaves them scalar
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("O3")
+#endif
+
+//----------------------------------------------------------------------- FiLTer
+
+#define FLT_BLOCK 16   ///< Plants per block, a constant trip count vectorises
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+/// Compare and exchange of a sorting network, without branches
+#define SORT(a, b) { sensorValue_t t = MIN(a, b); (b) = MAX(a, b); (a) = t; }
+
+/// Median networks of N. Devillard, "Fast median search", 1998
+static inline sensorValue_t median(sensorValue_t s[], int window)
+{
+   if (window == 3)
+   {
+      SORT(s[0], s[1]); SORT(s[1], s[2]); SORT(s[0], s[1]);
+      return s[1];
+   }
+   if (window == 5)
+   {
+      SORT(s[0], s[1]); SORT(s[3], s[4]); SORT(s[0], s[3]);
+      SORT(s[1], s[4]); SORT(s[1], s[2]); SORT(s[2], s[3]);
+      SORT(s[1], s[2]);
+      return s[2];
+   }
+   SORT(s[0], s[5]); SORT(s[0], s[3]); SORT(s[1], s[6]);
+   SORT(s[2], s[4]); SORT(s[0], s[1]); SORT(s[3], s[5]);
+   SORT(s[2], s[6]); SORT(s[2], s[3]); SORT(s[3], s[6]);
+   SORT(s[4], s[5]); SORT(s[1], s[4]); SORT(s[1], s[3]);
+   SORT(s[3], s[4]);
+   return s[3];
+}
+
+/// Shifts x into the window of one plant, returns the median. The window of
+/// a plant without readings is filled with its first reading.
+static inline sensorValue_t medianSample(sensorValue_t *v, size_t stride, int window,
+                                         sensorValue_t x)
+{
+   sensorValue_t s[FLT_MAX_WINDOW];
+   const int first = VAL_IS_NONE(v[0]);
+
+   for (int k = 0; k < window - 1; k++)
+   {
+      s[k] = first ? x : v[(k + 1) * stride];
+      v[k * stride] = s[k];
+   }
+   s[window - 1] = x;
+   v[(window - 1) * stride] = x;
+   return median(s, window);
+}
+
+/// Shifts x[i] into the window of n <= FLT_BLOCK plants, x[i] becomes the
+/// median. The window of a plant without readings is filled with its first
+/// reading. The windows are copied to a local block, which the compiler
+/// knows does not alias the rows of the bank.
+static inline void medianKernel(sensorValue_t *v, size_t stride, int window,
+                                sensorValue_t *restrict x, size_t n)
+{
+   sensorValue_t s[FLT_MAX_WINDOW][FLT_BLOCK];
+   int first[FLT_BLOCK];
+
+   for (size_t i = 0; i < n; i++)
+   {
+      first[i] = VAL_IS_NONE(v[i]);
+   }
+   for (int k = 0; k < window - 1; k++)
+   {
+      for (size_t i = 0; i < n; i++)
+      {
+         s[k][i] = first[i] ? x[i] : v[(k + 1) * stride + i];
+         v[k * stride + i] = s[k][i];
+      }
+   }
+   for (size_t i = 0; i < n; i++)
+   {
+      s[window - 1][i] = x[i];
+      v[(window - 1) * stride + i] = x[i];
+   }
+   for (size_t i = 0; i < n; i++)
+   {
+      sensorValue_t column[FLT_MAX_WINDOW];
+
+      for (int k = 0; k < window; k++)
+      {
+         column[k] = s[k][i];
+      }
+      x[i] = median(column, window);
+   }
+}
+
+static inline void emaKernel(sensorValue_t *restrict y, filterWeight_t weight,
+                             sensorValue_t *restrict x, size_t n)
+{
+   for (size_t i = 0; i < n; i++)
+   {
+      const sensorValue_t d = x[i] - y[i];
+#ifdef SENSOR_FIXED
+      const sensorValue_t next = y[i] + d * weight / FLT_ONE;
+#else
+      const sensorValue_t next = y[i] + d * weight;
+#endif
+      y[i] = VAL_IS_NONE(y[i]) ? x[i] : next;
+      x[i] = y[i];
+   }
+}
+
+/// The covariance normalised by the measurement noise equals the gain after
+/// an update, so the gain is the only state besides the estimate.
+static inline void kalmanKernel(sensorValue_t *restrict y, filterWeight_t *restrict gain,
+                                filterWeight_t ratio, sensorValue_t *restrict x, size_t n)
+{
+   for (size_t i = 0; i < n; i++)
+   {
+      const filterWeight_t p = gain[i] + ratio;
+#ifdef SENSOR_FIXED
+      const filterWeight_t k = p * FLT_ONE / (p + FLT_ONE);
+      const sensorValue_t next = y[i] + (x[i] - y[i]) * k / FLT_ONE;
+#else
+      const filterWeight_t k = p / (p + FLT_ONE);
+      const sensorValue_t next = y[i] + (x[i] - y[i]) * k;
+#endif
+      const int first = VAL_IS_NONE(y[i]);
+
+      gain[i] = first ? FLT_ONE : k;
+      y[i] = first ? x[i] : next;
+      x[i] = y[i];
+   }
+}
+
+/// Filters n <= FLT_BLOCK readings, inlined with n = FLT_BLOCK for the
+/// vectorised blocks
+static inline void filterBlock(filterBank_t *bank, channel_t channel,
+                               sensorValue_t x[], size_t plant, size_t n)
+{
+   const filterConfig_t *config = &bank->config[channel];
+   sensorValue_t *v = bank->value[channel] + plant;
+
+   switch (config->type)
+   {
+      case FLT_MEDIAN:
+         if (n == 1)
+         {
+            // A single reading, e.g. FLTsample(), needs no block
+            const int window = config->window;
+
+            x[0] = (window == 3) ? medianSample(v, bank->size, 3, x[0])
+                 : (window == 5) ? medianSample(v, bank->size, 5, x[0])
+                 : medianSample(v, bank->size, 7, x[0]);
+         }
+         else if (config->window == 3)
+         {
+            medianKernel(v, bank->size, 3, x, n);
+         }
+         else if (config->window == 5)
+         {
+            medianKernel(v, bank->size, 5, x, n);
+         }
+         else
+         {
+            medianKernel(v, bank->size, 7, x, n);
+         }
+         break;
+      case FLT_EMA:
+         emaKernel(v, config->weight, x, n);
+         break;
+      case FLT_KALMAN:
+         kalmanKernel(v, bank->gain[channel] + plant, config->weight, x, n);
+         break;
+      default:
+         break;
+   }
+}
+
+int FLTinitialise(filterBank_t *bank, size_t size,
+                  const filterConfig_t config[CH_NOF_CHANNELS])
+{
+   bank->size = size;
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      bank->config[ch] = config[ch];
+      bank->value[ch] = NULL;
+      bank->gain[ch] = NULL;
+   }
+
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      const filterConfig_t *c = &config[ch];
+      size_t depth = (c->type == FLT_MEDIAN) ? c->window : 1;
+
+      if (c->type == FLT_NONE)
+      {
+         continue;
+      }
+      if ((c->type == FLT_MEDIAN && c->window != 3 && c->window != 5 && c->window != 7) ||
+          (c->type == FLT_EMA && (c->weight <= 0 || c->weight > FLT_ONE)) ||
+          (c->type == FLT_KALMAN && c->weight <= 0) ||
+          c->type > FLT_KALMAN)
+      {
+         FLTterminate(bank);
+         return -1;
+      }
+      bank->value[ch] = malloc(depth * size * sizeof(sensorValue_t));
+      if (c->type == FLT_KALMAN)
+      {
+         bank->gain[ch] = calloc(size, sizeof(filterWeight_t));
+      }
+      if (bank->value[ch] == NULL || (c->type == FLT_KALMAN && bank->gain[ch] == NULL))
+      {
+         FLTterminate(bank);
+         return -1;
+      }
+   }
+   for (size_t plant = 0; plant < size; plant++)
+   {
+      FLTreset(bank, plant);
+   }
+   return 0;
+}
+
+void FLTterminate(filterBank_t *bank)
+{
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      free(bank->value[ch]);
+      free(bank->gain[ch]);
+      bank->value[ch] = NULL;
+      bank->gain[ch] = NULL;
+   }
+   bank->size = 0;
+}
+
+void FLTreset(filterBank_t *bank, size_t plant)
+{
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      size_t depth = (bank->config[ch].type == FLT_MEDIAN) ? bank->config[ch].window : 1;
+
+      if (bank->value[ch] == NULL)
+      {
+         continue;
+      }
+      for (size_t k = 0; k < depth; k++)
+      {
+         bank->value[ch][k * bank->size + plant] = VAL_NONE;
+      }
+   }
+}
+
+sensorValue_t FLTsample(filterBank_t *bank, size_t plant, channel_t channel,
+                        sensorValue_t value)
+{
+   if (plant < bank->size && bank->value[channel] != NULL)
+   {
+      filterBlock(bank, channel, &value, plant, 1);
+   }
+   return value;
+}
+
+void FLTbatch(filterBank_t *bank, channel_t channel, sensorValue_t values[],
+              size_t first, size_t n)
+{
+   size_t i = 0;
+
+   if (bank->value[channel] == NULL || first >= bank->size)
+   {
+      return;
+   }
+   if (n > bank->size - first)
+   {
+      n = bank->size - first;
+   }
+   for (; i + FLT_BLOCK <= n; i += FLT_BLOCK)
+   {
+      filterBlock(bank, channel, &values[i], first + i, FLT_BLOCK);
+   }
+   if (i < n)
+   {
+      filterBlock(bank, channel, &values[i], first + i, n - i);
+   }
+}
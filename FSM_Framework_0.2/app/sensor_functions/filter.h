@@ -0,0 +1,76 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensorValue.h"
+
+//----------------------------------------------------------------------- FiLTer
+
+/// Noise filters between the sensor readings and the classifiers, one per
+/// channel. A filter bank holds the filter state of a number of plants,
+/// stored per channel as arrays over the plants, so a rack is filtered in
+/// batches with SIMD. The filters do not allocate after FLTinitialise().
+///
+/// Median: the median of the last 3, 5 or 7 readings, removes spikes.
+/// EMA: exponential moving average, y += weight * (x - y).
+/// Kalman: scalar Kalman filter of a random walk, weight is the ratio of the
+/// process noise and the measurement noise (q / r); the gain converges to
+/// the EMA weight that fits this noise ratio.
+
+#ifdef SENSOR_FIXED
+typedef int32_t filterWeight_t;
+#define FLT_ONE 1024          ///< Weight 1.0, weights have a 1/1024 resolution
+#define FLT_WEIGHT(x) ((filterWeight_t)((x) * FLT_ONE + 0.5))
+#else
+typedef float filterWeight_t;
+#define FLT_ONE 1.0f
+#define FLT_WEIGHT(x) ((filterWeight_t)(x))
+#endif
+
+#define FLT_MAX_WINDOW 7      ///< Largest median window
+
+typedef enum {
+   FLT_NONE,            ///< Readings are not filtered
+   FLT_MEDIAN,
+   FLT_EMA,
+   FLT_KALMAN,
+} filterType_t;
+
+typedef struct {
+   filterType_t type;
+   uint8_t window;            ///< Median: 3, 5 or 7 readings
+   filterWeight_t weight;     ///< EMA: weight of a reading, Kalman: q / r
+} filterConfig_t;
+
+typedef struct {
+   filterConfig_t config[CH_NOF_CHANNELS];
+   size_t size;                              ///< Number of plants
+   sensorValue_t *value[CH_NOF_CHANNELS];    ///< [window][size] readings or estimates
+   filterWeight_t *gain[CH_NOF_CHANNELS];    ///< Kalman gain per plant
+} filterBank_t;
+
+/// Initialises a bank of size plants with a filter per channel.
+/// \return 0 on success, -1 on an invalid config or out of memory.
+int FLTinitialise(filterBank_t *bank, size_t size,
+                  const filterConfig_t config[CH_NOF_CHANNELS]);
+
+/// Frees the filter state.
+void FLTterminate(filterBank_t *bank);
+
+/// Forgets the readings of a plant, the next reading passes unfiltered.
+void FLTreset(filterBank_t *bank, size_t plant);
+
+/// Filters one reading of a plant, the reading must not be VAL_NONE.
+/// \return the filtered value.
+sensorValue_t FLTsample(filterBank_t *bank, size_t plant, channel_t channel,
+                        sensorValue_t value);
+
+/// Filters the readings of channel of the plants first to first + n - 1 in
+/// place, values[i] is the reading of plant first + i.
+void FLTbatch(filterBank_t *bank, channel_t channel, sensorValue_t values[],
+              size_t first, size_t n);
+
+#endif
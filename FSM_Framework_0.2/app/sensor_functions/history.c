@@ -0,0 +1,521 @@
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------- HiSTory
+
+#define HST_NO_WINDOW 0xFF      ///< No XOR window in the block yet
+
+/// A bit field of an encoded sample, written most significant bit first
+typedef struct {
+   uint32_t value;
+   uint8_t n;
+} historyField_t;
+
+/// Reads the bits of a block through a 64-bit window
+typedef struct {
+   const uint8_t *p;
+   const uint8_t *end;
+   uint64_t window;
+   unsigned avail;                  ///< Unread bits in the window
+} historyReader_t;
+
+/// Widths of the signed field after the codes 10, 110, 1110 and 1111, a 0
+/// is a zero change
+static const uint8_t timeWidths[4] = {7, 9, 12, 32};
+#ifdef SENSOR_FIXED
+static const uint8_t valueWidths[4] = {6, 10, 16, 32};
+#endif
+
+/// Bucket of the first 4 bits of a signed field: -1 for a zero change,
+/// otherwise the index in the widths, and the length of the code
+static const int8_t codeBucket[16] = {
+   -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 1, 1, 2, 3
+};
+static const uint8_t codeLength[16] = {
+   1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 4, 4
+};
+
+static inline uint32_t toBits(sensorValue_t value)
+{
+#ifdef SENSOR_FIXED
+   return (uint32_t)value;
+#else
+   uint32_t bits;
+
+   memcpy(&bits, &value, sizeof(bits));
+   return bits;
+#endif
+}
+
+static inline sensorValue_t toValue(uint32_t bits)
+{
+#ifdef SENSOR_FIXED
+   return (sensorValue_t)bits;
+#else
+   sensorValue_t value;
+
+   memcpy(&value, &bits, sizeof(value));
+   return value;
+#endif
+}
+
+/// Appends the n lowest bits of value, n is at most 56
+static void putBits(historyBlock_t *block, uint64_t value, unsigned n)
+{
+   uint8_t *p = &block->data[block->bits >> 3];
+   unsigned used = block->bits & 7;
+   uint64_t bits = ((uint64_t)*p << 56) | (value << (64 - used - n));
+
+   // Only the bytes that hold the new bits are written
+   for (unsigned i = 0; i < (used + n + 7) / 8; i++)
+   {
+      p[i] = (uint8_t)(bits >> (56 - 8 * i));
+   }
+   block->bits += n;
+}
+
+static inline void fill(historyReader_t *reader, unsigned n)
+{
+   while (reader->avail < n)
+   {
+      reader->window = (reader->window << 8) |
+                       (reader->p < reader->end ? *reader->p++ : 0);
+      reader->avail += 8;
+   }
+}
+
+/// \return the next n bits, n is 1 to 32
+static inline uint32_t getBits(historyReader_t *reader, unsigned n)
+{
+   fill(reader, n);
+   reader->avail -= n;
+   return (uint32_t)((reader->window >> reader->avail) & (((uint64_t)1 << n) - 1));
+}
+
+/// \return the next n bits without reading them
+static inline uint32_t peekBits(historyReader_t *reader, unsigned n)
+{
+   fill(reader, n);
+   return (uint32_t)((reader->window >> (reader->avail - n)) & ((1u << n) - 1));
+}
+
+/// Encodes v as a code and a signed field of the smallest width that fits.
+/// \return the number of fields, 0 if v does not fit the widest field.
+static unsigned encodeSigned(int64_t v, const uint8_t widths[4], historyField_t fields[])
+{
+   static const historyField_t codes[4] = {{2, 2}, {6, 3}, {14, 4}, {15, 4}};
+
+   if (v == 0)
+   {
+      fields[0] = (historyField_t){0, 1};
+      return 1;
+   }
+   for (int i = 0; i < 4; i++)
+   {
+      int64_t half = (int64_t)1 << (widths[i] - 1);
+
+      if (v >= -half && v < half)
+      {
+         fields[0] = codes[i];
+         fields[1] = (historyField_t){(uint32_t)((uint64_t)v & (((uint64_t)1 << widths[i]) - 1)),
+                                      widths[i]};
+         return 2;
+      }
+   }
+   return 0;
+}
+
+static inline int64_t decodeSigned(historyReader_t *reader, const uint8_t widths[4])
+{
+   uint32_t code = peekBits(reader, 4);
+   int bucket = codeBucket[code];
+   unsigned width;
+   uint32_t v;
+
+   reader->avail -= codeLength[code];
+   if (bucket < 0)
+   {
+      return 0;
+   }
+   width = widths[bucket];
+   v = getBits(reader, width);
+   return (v & ((uint64_t)1 << (width - 1))) ? (int64_t)v - ((int64_t)1 << width) : (int64_t)v;
+}
+
+#ifndef SENSOR_FIXED
+
+/// Encodes the XOR of the value with the previous value: 0 for the same
+/// value, 10 and the bits within the window of the previous XOR, or 11, the
+/// leading zeros, the length and the bits of a new window.
+/// \return the number of fields
+static unsigned encodeValue(uint32_t previous, uint32_t bits, uint8_t *leading,
+                            uint8_t *trailing, historyField_t fields[])
+{
+   uint32_t x = previous ^ bits;
+   unsigned lead;
+   unsigned trail;
+   unsigned length;
+
+   if (x == 0)
+   {
+      fields[0] = (historyField_t){0, 1};
+      return 1;
+   }
+   lead = (unsigned)__builtin_clz(x);
+   trail = (unsigned)__builtin_ctz(x);
+   if (*leading != HST_NO_WINDOW && lead >= *leading && trail >= *trailing)
+   {
+      length = 32 - *leading - *trailing;
+      fields[0] = (historyField_t){2, 2};
+      fields[1] = (historyField_t){x >> *trailing, (uint8_t)length};
+      return 2;
+   }
+   length = 32 - lead - trail;
+   fields[0] = (historyField_t){(3u << 10) | (lead << 5) | (length - 1), 12};
+   fields[1] = (historyField_t){x >> trail, (uint8_t)length};
+   *leading = (uint8_t)lead;
+   *trailing = (uint8_t)trail;
+   return 2;
+}
+
+static inline uint32_t decodeValue(historyReader_t *reader, uint32_t previous,
+                                   unsigned *leading, unsigned *trailing)
+{
+   uint32_t code = peekBits(reader, 2);
+
+   if (code < 2)
+   {
+      reader->avail--;
+      return previous;
+   }
+   reader->avail -= 2;
+   if (code == 3)
+   {
+      unsigned lead = getBits(reader, 5);
+      unsigned length = getBits(reader, 5) + 1;
+
+      *leading = lead;
+      *trailing = 32 - lead - length;
+   }
+   return previous ^ (getBits(reader, 32 - *leading - *trailing) << *trailing);
+}
+
+#endif
+
+static inline historyBlock_t *blockAt(const historySeries_t *series, uint32_t i)
+{
+   uint32_t index = series->oldest + i;
+
+   return series->blocks[(index >= series->capacity) ? index - series->capacity : index];
+}
+
+/// \return the index of the first block of series with samples at or after
+/// from, nofBlocks if there is none.
+static uint32_t findBlock(const historySeries_t *series, uint64_t from)
+{
+   uint32_t low = 0;
+   uint32_t high = series->nofBlocks;
+
+   while (low < high)
+   {
+      uint32_t middle = low + (high - low) / 2;
+
+      if (blockAt(series, middle)->last < from)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+   return low;
+}
+
+/// \return a new empty block at the end of series, the oldest block when
+/// series has all its blocks, NULL on out of memory.
+static historyBlock_t *addBlock(history_t *history, historySeries_t *series)
+{
+   historyBlock_t *block;
+
+   if (history->maxBlocks != 0 && series->nofBlocks >= history->maxBlocks)
+   {
+      block = series->blocks[series->oldest];
+      series->oldest = (series->oldest + 1 == series->capacity) ? 0 : series->oldest + 1;
+      series->nofBlocks--;
+   }
+   else
+   {
+      // The ring only wraps when it is full at maxBlocks, so it grows in place
+      if (series->nofBlocks == series->capacity)
+      {
+         uint32_t capacity = (series->capacity == 0) ? 16 : 2 * series->capacity;
+         historyBlock_t **blocks;
+
+         if (history->maxBlocks != 0 && capacity > history->maxBlocks)
+         {
+            capacity = history->maxBlocks;
+         }
+         blocks = realloc(series->blocks, capacity * sizeof(historyBlock_t *));
+         if (blocks == NULL)
+         {
+            return NULL;
+         }
+         series->blocks = blocks;
+         series->capacity = capacity;
+      }
+      block = malloc(sizeof(historyBlock_t));
+      if (block == NULL)
+      {
+         return NULL;
+      }
+   }
+   memset(block, 0, sizeof(historyBlock_t));
+   series->nofBlocks++;
+   series->blocks[(series->oldest + series->nofBlocks - 1) % series->capacity] = block;
+   series->newest = block;
+   return block;
+}
+
+void HSTinitialise(history_t *history, uint32_t maxBlocks)
+{
+   memset(history, 0, sizeof(history_t));
+   history->maxBlocks = maxBlocks;
+}
+
+void HSTterminate(history_t *history)
+{
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      historySeries_t *series = &history->series[ch];
+
+      for (uint32_t i = 0; i < series->nofBlocks; i++)
+      {
+         free(blockAt(series, i));
+      }
+      free(series->blocks);
+   }
+   HSTinitialise(history, history->maxBlocks);
+}
+
+int HSTappend(history_t *history, channel_t channel, uint64_t time, sensorValue_t value)
+{
+   historySeries_t *series = &history->series[channel];
+   historyBlock_t *block = series->newest;
+   const uint32_t bits = toBits(value);
+
+   if (VAL_IS_NONE(value) || (block != NULL && time < block->last))
+   {
+      return -1;
+   }
+   if (block != NULL && block->count < HST_BLOCK_SAMPLES)
+   {
+      historyField_t fields[4];
+      uint64_t delta = time - block->last;
+      uint8_t leading = series->leading;
+      uint8_t trailing = series->trailing;
+      unsigned n = encodeSigned((int64_t)(delta - series->delta), timeWidths, fields);
+      unsigned size = 0;
+
+      // A time that does not fit starts a block
+      if (n > 0)
+      {
+#ifdef SENSOR_FIXED
+         n += encodeSigned((int32_t)(bits - series->value), valueWidths, fields + n);
+         (void)leading;
+         (void)trailing;
+#else
+         n += encodeValue(series->value, bits, &leading, &trailing, fields + n);
+#endif
+         for (unsigned i = 0; i < n; i++)
+         {
+            size += fields[i].n;
+         }
+      }
+      if (n > 0 && block->bits + size <= HST_BLOCK_BYTES * 8)
+      {
+         uint64_t packed = 0;
+         unsigned nofPacked = 0;
+
+         // The fields are collected and written in one or two parts
+         for (unsigned i = 0; i < n; i++)
+         {
+            if (nofPacked + fields[i].n > 56)
+            {
+               putBits(block, packed, nofPacked);
+               packed = 0;
+               nofPacked = 0;
+            }
+            packed = (packed << fields[i].n) | fields[i].value;
+            nofPacked += fields[i].n;
+         }
+         putBits(block, packed, nofPacked);
+         series->delta = delta;
+         series->value = bits;
+         series->leading = leading;
+         series->trailing = trailing;
+         block->last = time;
+         block->min = (value < block->min) ? value : block->min;
+         block->max = (value > block->max) ? value : block->max;
+         block->sum += value;
+         block->count++;
+         return 0;
+      }
+   }
+
+   // The first sample of a block is stored in full
+   block = addBlock(history, series);
+   if (block == NULL)
+   {
+      return -1;
+   }
+   putBits(block, bits, 32);
+   block->first = block->last = time;
+   block->min = block->max = value;
+   block->sum = value;
+   block->count = 1;
+   series->delta = 0;
+   series->value = bits;
+   series->leading = HST_NO_WINDOW;
+   series->trailing = 0;
+   return 0;
+}
+
+/// Decodes all samples of block.
+static void decodeBlock(const historyBlock_t *block, uint64_t times[], sensorValue_t values[])
+{
+   historyReader_t reader = {block->data, block->data + (block->bits + 7) / 8, 0, 0};
+   uint64_t time = block->first;
+   uint64_t delta = 0;
+   uint32_t bits = getBits(&reader, 32);
+#ifndef SENSOR_FIXED
+   unsigned leading = 0;
+   unsigned trailing = 0;
+#endif
+
+   times[0] = time;
+   values[0] = toValue(bits);
+   for (unsigned i = 1; i < block->count; i++)
+   {
+      delta += (uint64_t)decodeSigned(&reader, timeWidths);
+      time += delta;
+#ifdef SENSOR_FIXED
+      bits += (uint32_t)decodeSigned(&reader, valueWidths);
+#else
+      bits = decodeValue(&reader, bits, &leading, &trailing);
+#endif
+      times[i] = time;
+      values[i] = toValue(bits);
+   }
+}
+
+size_t HSTread(const history_t *history, channel_t channel, uint64_t from, uint64_t to,
+               uint64_t times[], sensorValue_t values[], size_t max)
+{
+   uint64_t blockTimes[HST_BLOCK_SAMPLES];
+   sensorValue_t blockValues[HST_BLOCK_SAMPLES];
+   const historySeries_t *series = &history->series[channel];
+   size_t n = 0;
+
+   for (uint32_t b = findBlock(series, from); b < series->nofBlocks && n < max; b++)
+   {
+      const historyBlock_t *block = blockAt(series, b);
+
+      if (block->first >= to)
+      {
+         break;
+      }
+      if (block->first >= from && block->last < to && block->count <= max - n)
+      {
+         // The whole block, decoded in place
+         decodeBlock(block, times + n, values + n);
+         n += block->count;
+         continue;
+      }
+      decodeBlock(block, blockTimes, blockValues);
+      for (unsigned i = 0; i < block->count && n < max; i++)
+      {
+         if (blockTimes[i] >= from && blockTimes[i] < to)
+         {
+            times[n] = blockTimes[i];
+            values[n] = blockValues[i];
+            n++;
+         }
+      }
+   }
+   return n;
+}
+
+static void addToAggregate(historyAggregate_t *aggregate, uint64_t first, uint64_t last,
+                           sensorValue_t min, sensorValue_t max, sensorSum_t sum, uint32_t count)
+{
+   if (aggregate->count == 0)
+   {
+      aggregate->first = first;
+      aggregate->min = min;
+      aggregate->max = max;
+   }
+   aggregate->min = (min < aggregate->min) ? min : aggregate->min;
+   aggregate->max = (max > aggregate->max) ? max : aggregate->max;
+   aggregate->last = last;
+   aggregate->sum += sum;
+   aggregate->count += count;
+}
+
+void HSTaggregate(const history_t *history, channel_t channel, uint64_t from, uint64_t to,
+                  historyAggregate_t *aggregate)
+{
+   uint64_t blockTimes[HST_BLOCK_SAMPLES];
+   sensorValue_t blockValues[HST_BLOCK_SAMPLES];
+   const historySeries_t *series = &history->series[channel];
+
+   memset(aggregate, 0, sizeof(historyAggregate_t));
+   for (uint32_t b = findBlock(series, from); b < series->nofBlocks; b++)
+   {
+      const historyBlock_t *block = blockAt(series, b);
+
+      if (block->first >= to)
+      {
+         break;
+      }
+      if (block->first >= from && block->last < to)
+      {
+         addToAggregate(aggregate, block->first, block->last, block->min, block->max,
+                        block->sum, block->count);
+         continue;
+      }
+      decodeBlock(block, blockTimes, blockValues);
+      for (unsigned i = 0; i < block->count; i++)
+      {
+         if (blockTimes[i] >= from && blockTimes[i] < to)
+         {
+            addToAggregate(aggregate, blockTimes[i], blockTimes[i], blockValues[i],
+                           blockValues[i], blockValues[i], 1);
+         }
+      }
+   }
+}
+
+size_t HSTsize(const history_t *history, uint64_t *samples)
+{
+   size_t bytes = 0;
+
+   if (samples != NULL)
+   {
+      *samples = 0;
+   }
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      const historySeries_t *series = &history->series[ch];
+
+      bytes += series->nofBlocks * sizeof(historyBlock_t) +
+               series->capacity * sizeof(historyBlock_t *);
+      for (uint32_t b = 0; b < series->nofBlocks && samples != NULL; b++)
+      {
+         *samples += blockAt(series, b)->count;
+      }
+   }
+   return bytes;
+}
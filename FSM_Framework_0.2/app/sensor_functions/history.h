@@ -0,0 +1,99 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensorValue.h"
+
+//---------------------------------------------------------------------- HiSTory
+
+/// Stores months of sensor readings per plant in compressed blocks, one list
+/// of blocks per channel. Within a block a sample takes a few bits:
+/// - the time is stored as the change of the interval to the previous
+///   sample (delta of delta), 1 bit for a regular sample period,
+/// - the value is stored as the XOR with the previous value (float), or as
+///   the difference with it (SENSOR_FIXED), 1 bit for an unchanged value.
+/// The first sample of a block is stored in full, so a block decodes on its
+/// own. A block keeps the time range, minimum, maximum and sum of its
+/// samples: a range query decodes only the blocks in the range, an
+/// aggregate decodes only the two blocks at its edges. The first block of a
+/// range is found by a binary search.
+///
+/// Times are in ms, 64 bits so a history can span more than the 49 days of
+/// PLTnow(). Samples of a channel are added in time order.
+
+#define HST_BLOCK_BYTES 224     ///< Compressed samples of a block
+#define HST_BLOCK_SAMPLES 1024  ///< Most samples in a block
+
+typedef struct {
+   uint64_t first;                  ///< Time of the first sample
+   uint64_t last;                   ///< Time of the last sample
+   sensorValue_t min;
+   sensorValue_t max;
+   sensorSum_t sum;
+   uint16_t count;                  ///< Number of samples
+   uint16_t bits;                   ///< Bits used in data
+   uint8_t data[HST_BLOCK_BYTES];
+} historyBlock_t;
+
+/// The blocks of one channel, oldest first, and the encoder state of the
+/// newest block. The blocks are found by a binary search on their time.
+typedef struct {
+   historyBlock_t **blocks;         ///< Ring of capacity blocks
+   historyBlock_t *newest;          ///< Block the samples are added to
+   uint32_t capacity;
+   uint32_t oldest;                 ///< Index of the oldest block in blocks
+   uint32_t nofBlocks;
+   uint64_t delta;                  ///< Interval to the previous sample
+   uint32_t value;                  ///< Previous value, its bits
+   uint8_t leading;                 ///< Zero bits before the last XOR
+   uint8_t trailing;                ///< Zero bits after it
+} historySeries_t;
+
+typedef struct {
+   historySeries_t series[CH_NOF_CHANNELS];
+   uint32_t maxBlocks;              ///< Per channel, 0 for no limit
+} history_t;
+
+/// Aggregated samples of a time range.
+typedef struct {
+   uint64_t first;                  ///< Time of the first sample
+   uint64_t last;                   ///< Time of the last sample
+   sensorValue_t min;
+   sensorValue_t max;
+   sensorSum_t sum;                 ///< Sum of the samples, for the average
+   uint32_t count;                  ///< Number of samples, 0 for none
+} historyAggregate_t;
+
+/// Initialises an empty history.
+/// \param maxBlocks blocks per channel, when all are full the oldest block
+/// is reused; 0 keeps all samples.
+void HSTinitialise(history_t *history, uint32_t maxBlocks);
+
+/// Frees the blocks of history.
+void HSTterminate(history_t *history);
+
+/// Adds a sample of channel.
+/// \return 0 on success, -1 if time is before the last sample of channel,
+/// value is VAL_NONE or out of memory.
+int HSTappend(history_t *history, channel_t channel, uint64_t time, sensorValue_t value);
+
+/// Reads the samples of channel from time from up to, not including, time
+/// to, oldest first. Only the blocks in the range are decoded. For more
+/// than max samples, call again with from after the last time read.
+/// \return the number of samples in times and values.
+size_t HSTread(const history_t *history, channel_t channel, uint64_t from, uint64_t to,
+               uint64_t times[], sensorValue_t values[], size_t max);
+
+/// Aggregates the samples of channel from time from up to, not including,
+/// time to. The blocks within the range are taken from their summary.
+void HSTaggregate(const history_t *history, channel_t channel, uint64_t from, uint64_t to,
+                  historyAggregate_t *aggregate);
+
+/// \return the bytes of the blocks of history, sets samples to the number
+/// of samples they hold when not NULL.
+size_t HSTsize(const history_t *history, uint64_t *samples);
+
+#endif
@@ -0,0 +1,313 @@
+#include "ingest.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------- INGest
+
+#define INGEST_MAGIC "PSLG"
+#define INGEST_VERSION 1
+#define INGEST_HEADER_SIZE 8
+#define INGEST_LINE 128         ///< Longest last line without a newline
+
+int INGopen(ingest_t *log, const char path[])
+{
+   memset(log, 0, sizeof(ingest_t));
+
+#ifndef _WIN32
+   struct stat info;
+   int fd = open(path, O_RDONLY);
+
+   if (fd < 0)
+   {
+      return -1;
+   }
+   if (fstat(fd, &info) != 0)
+   {
+      close(fd);
+      return -1;
+   }
+   log->size = (size_t)info.st_size;
+   if (log->size > 0)
+   {
+      void *data = mmap(NULL, log->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data == MAP_FAILED)
+      {
+         close(fd);
+         return -1;
+      }
+      madvise(data, log->size, MADV_SEQUENTIAL);
+      log->data = data;
+      log->mapping = data;
+   }
+   close(fd);   // The mapping stays valid
+#else
+   // No mmap(), the log is read in one buffer
+   FILE *file = fopen(path, "rb");
+   long size;
+
+   if (file == NULL)
+   {
+      return -1;
+   }
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   log->mapping = malloc(size > 0 ? size : 1);
+   if (size < 0 || log->mapping == NULL ||
+       fread(log->mapping, 1, size, file) != (size_t)size)
+   {
+      free(log->mapping);
+      fclose(file);
+      return -1;
+   }
+   fclose(file);
+   log->data = log->mapping;
+   log->size = (size_t)size;
+#endif
+
+   if (log->size >= INGEST_HEADER_SIZE &&
+       memcmp(log->data, INGEST_MAGIC, 4) == 0)
+   {
+      if (log->data[4] != INGEST_VERSION)
+      {
+         // Records of another layout
+         INGclose(log);
+         return -1;
+      }
+      log->binary = 1;
+      log->pos = INGEST_HEADER_SIZE;
+   }
+   else
+   {
+      // Find the end of the last complete line
+      log->lastLine = log->size;
+      while (log->lastLine > 0 && log->data[log->lastLine - 1] != '\n')
+      {
+         log->lastLine--;
+      }
+   }
+   return 0;
+}
+
+void INGclose(ingest_t *log)
+{
+#ifndef _WIN32
+   if (log->mapping != NULL)
+   {
+      munmap(log->mapping, log->size);
+   }
+#else
+   free(log->mapping);
+#endif
+   memset(log, 0, sizeof(ingest_t));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+   return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static size_t readBinary(ingest_t *log, ingestSample_t samples[], size_t max)
+{
+   size_t n = 0;
+
+   while (n < max && log->size - log->pos >= INGEST_RECORD_SIZE)
+   {
+      const uint8_t *record = log->data + log->pos;
+
+      log->pos += INGEST_RECORD_SIZE;
+      if (record[8] >= CH_NOF_CHANNELS)
+      {
+         log->errors++;
+         continue;
+      }
+      samples[n].ms = get32(record);
+      samples[n].plant = get32(record + 4);
+      samples[n].channel = record[8];
+      samples[n].value = VAL_FROM_TENTHS((int16_t)(record[10] | record[11] << 8));
+      n++;
+   }
+   if (n < max && log->pos < log->size)
+   {
+      // Incomplete last record
+      log->errors++;
+      log->pos = log->size;
+   }
+   return n;
+}
+
+/// Parses an unsigned number at *p, the line is known to end with '\n'.
+/// \return false if there are no digits.
+static bool parseUint(const char **p, uint32_t *value)
+{
+   const char *s = *p;
+   uint32_t v = 0;
+
+   while (*s >= '0' && *s <= '9')
+   {
+      v = v * 10 + (*s++ - '0');
+   }
+   *value = v;
+   if (s == *p)
+   {
+      return false;
+   }
+   *p = s;
+   return true;
+}
+
+/// Parses one line "ms,plant,channel,value\n" at *p, the parsers stop at
+/// the '\n' at the latest.
+/// \return true and *p after the '\n', or false on a malformed line.
+static bool parseLine(const char **p, ingestSample_t *sample)
+{
+   const char *s = *p;
+   const char *value;
+   uint32_t channel;
+
+   if (!parseUint(&s, &sample->ms) || *s++ != ',' ||
+       !parseUint(&s, &sample->plant) || *s++ != ',' ||
+       !parseUint(&s, &channel) || *s++ != ',' || channel >= CH_NOF_CHANNELS)
+   {
+      return false;
+   }
+   sample->channel = (uint8_t)channel;
+   value = s;
+   sample->value = VALparse(value, &s);
+   if (s == value)
+   {
+      return false;
+   }
+   if (*s == '\r')
+   {
+      s++;
+   }
+   if (*s != '\n')
+   {
+      return false;
+   }
+   *p = s + 1;
+   return true;
+}
+
+/// Parses or skips the line at *p.
+/// \return 1 for a sample, 0 for a skipped line, *p is after the line.
+static int csvLine(ingest_t *log, const char **p, const char *end,
+                   ingestSample_t *sample)
+{
+   const char *line = *p;
+
+   if (*line >= '0' && *line <= '9' && parseLine(p, sample))
+   {
+      return 1;
+   }
+   // Header, comment, empty or malformed line
+   if (*line >= '0' && *line <= '9')
+   {
+      log->errors++;
+   }
+   line = memchr(line, '\n', end - line);
+   *p = line + 1;
+   return 0;
+}
+
+static size_t readCsv(ingest_t *log, ingestSample_t samples[], size_t max)
+{
+   const char *data = (const char *)log->data;
+   const char *p = data + log->pos;
+   const char *end = data + log->lastLine;
+   size_t n = 0;
+
+   // All lines up to lastLine end with '\n', they are parsed in place
+   while (n < max && p < end)
+   {
+      n += csvLine(log, &p, end, &samples[n]);
+   }
+   log->pos = p - data;
+
+   if (n < max && log->pos == log->lastLine && log->lastLine < log->size)
+   {
+      // The unterminated last line is parsed in a copy, with a '\n'
+      char last[INGEST_LINE + 1];
+      size_t length = log->size - log->lastLine;
+
+      if (length > INGEST_LINE)
+      {
+         // Too long for a sample, it is not parsed truncated
+         if (*p >= '0' && *p <= '9')
+         {
+            log->errors++;
+         }
+         log->pos = log->size;
+         return n;
+      }
+      memcpy(last, data + log->lastLine, length);
+      last[length] = '\n';
+      p = last;
+      n += csvLine(log, &p, last + length + 1, &samples[n]);
+      log->pos = log->size;
+   }
+   return n;
+}
+
+size_t INGread(ingest_t *log, ingestSample_t samples[], size_t max)
+{
+   return log->binary ? readBinary(log, samples, max) : readCsv(log, samples, max);
+}
+
+int INGwrite(const char path[], const ingestSample_t samples[], size_t n)
+{
+   FILE *file = fopen(path, "wb");
+   uint8_t header[INGEST_HEADER_SIZE] = INGEST_MAGIC;
+   int result = 0;
+
+   if (file == NULL)
+   {
+      return -1;
+   }
+   header[4] = INGEST_VERSION;
+   if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
+   {
+      result = -1;
+   }
+   for (size_t i = 0; i < n && result == 0; i++)
+   {
+      sensorValue_t value = samples[i].value;
+      int32_t tenths;
+      uint8_t record[INGEST_RECORD_SIZE];
+
+      // Clip to the int16 range of the record
+      value = value > VAL(3276.7) ? VAL(3276.7) : value;
+      value = value < VAL(-3276.8) ? VAL(-3276.8) : value;
+      tenths = VAL_TO_TENTHS(value);
+      for (int b = 0; b < 4; b++)
+      {
+         record[b] = (uint8_t)(samples[i].ms >> (8 * b));
+         record[4 + b] = (uint8_t)(samples[i].plant >> (8 * b));
+      }
+      record[8] = samples[i].channel;
+      record[9] = 0;
+      record[10] = (uint8_t)(tenths & 0xFF);
+      record[11] = (uint8_t)((tenths >> 8) & 0xFF);
+      if (fwrite(record, 1, sizeof(record), file) != sizeof(record))
+      {
+         result = -1;
+      }
+   }
+   if (fclose(file) != 0)
+   {
+      result = -1;
+   }
+   return result;
+}
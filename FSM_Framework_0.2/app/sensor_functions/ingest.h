@@ -0,0 +1,61 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensorValue.h"
+
+//----------------------------------------------------------------------- INGest
+
+/// Bulk ingest of recorded sensor logs, e.g. for backtesting. The log is
+/// memory mapped and parsed in batches into an array of the caller, the
+/// parser does not allocate. Two formats are detected:
+/// - CSV, one sample per line: "ms,plant,channel,value", e.g.
+///   "120500,12,0,15.5". Lines that do not start with a digit (a header)
+///   are skipped, malformed lines are counted in errors.
+/// - binary, "PSLG" and a version, then records of INGEST_RECORD_SIZE
+///   bytes: uint32 ms, uint32 plant, uint8 channel, uint8 0, int16 value in
+///   0.1 units, all little endian. See INGwrite().
+
+#define INGEST_BATCH 4096       ///< Suggested batch size
+#define INGEST_RECORD_SIZE 12   ///< Bytes per binary record
+
+/// One recorded sample.
+typedef struct {
+   uint32_t ms;
+   uint32_t plant;
+   sensorValue_t value;
+   uint8_t channel;           ///< channel_t
+} ingestSample_t;
+
+/// An opened log.
+typedef struct {
+   const uint8_t *data;
+   size_t size;
+   size_t pos;                ///< Parse position
+   size_t lastLine;           ///< End of the last line with a newline
+   int binary;
+   long errors;               ///< Number of malformed lines or records
+   void *mapping;             ///< Platform data of the mapping
+} ingest_t;
+
+/// Maps the log in path and detects its format.
+/// \return 0 on success, -1 if the file cannot be opened or mapped, or is a
+/// binary log of another version.
+int INGopen(ingest_t *log, const char path[]);
+
+/// Parses the next samples of log.
+/// \param samples room for max samples
+/// \return the number of samples, 0 at the end of the log.
+size_t INGread(ingest_t *log, ingestSample_t samples[], size_t max);
+
+/// Unmaps the log.
+void INGclose(ingest_t *log);
+
+/// Writes samples as a binary log, the value is rounded to 0.1 units.
+/// \return 0 on success, -1 on a file error.
+int INGwrite(const char path[], const ingestSample_t samples[], size_t n);
+
+#endif
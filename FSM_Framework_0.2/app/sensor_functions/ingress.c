@@ -0,0 +1,336 @@
+#include "ingress.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+//---------------------------------------------------------------------- InGRess
+
+#ifdef SENSOR_FIXED
+#define IGR_FIXED 1
+#else
+#define IGR_FIXED 0
+#endif
+
+static size_t sizeOf(uint32_t capacity)
+{
+   return sizeof(ingressRing_t) + capacity * sizeof(ingressRecord_t);
+}
+
+#ifdef _WIN32
+/// The wakeup of a ring is a named auto reset event
+static HANDLE openEvent(const char name[], bool create)
+{
+   char eventName[80];
+
+   snprintf(eventName, sizeof(eventName), "%s.wake", name);
+   return create ? CreateEventA(NULL, FALSE, FALSE, eventName)
+                 : OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, eventName);
+}
+#endif
+
+/// Maps the segment of ingress->size bytes, creates it for the consumer
+static void *map(ingress_t *ingress, bool create)
+{
+   void *p;
+#ifdef _WIN32
+   HANDLE mapping = create
+      ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                           (DWORD)ingress->size, ingress->name)
+      : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, ingress->name);
+
+   if (mapping == NULL)
+   {
+      return NULL;
+   }
+   p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, ingress->size);
+   ingress->wake = openEvent(ingress->name, create);
+   if (p == NULL || ingress->wake == NULL)
+   {
+      if (p != NULL)
+      {
+         UnmapViewOfFile(p);
+      }
+      if (ingress->wake != NULL)
+      {
+         CloseHandle(ingress->wake);
+      }
+      CloseHandle(mapping);
+      return NULL;
+   }
+   ingress->mapping = mapping;
+#else
+   int fd;
+
+   if (create)
+   {
+      // A new ring: truncating a stale one would pull the pages from under
+      // a producer that still maps it
+      shm_unlink(ingress->name);
+   }
+   fd = shm_open(ingress->name, create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+   if (fd < 0)
+   {
+      return NULL;
+   }
+   if (create && ftruncate(fd, ingress->size) != 0)
+   {
+      close(fd);
+      shm_unlink(ingress->name);
+      return NULL;
+   }
+   p = mmap(NULL, ingress->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (p == MAP_FAILED)
+   {
+      if (create)
+      {
+         shm_unlink(ingress->name);
+      }
+      return NULL;
+   }
+#endif
+   return p;
+}
+
+/// Sleeps while the consumer is waiting, at most timeoutMs
+static void sleepOn(ingress_t *ingress, uint32_t timeoutMs)
+{
+#if defined(_WIN32)
+   WaitForSingleObject(ingress->wake, timeoutMs);
+#elif defined(__linux__)
+   struct timespec timeout = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000L };
+
+   // A shared futex, the word is in the segment of both processes
+   syscall(SYS_futex, (uint32_t *)&ingress->ring->waiting, FUTEX_WAIT, 1, &timeout, NULL, 0);
+#else
+   // Without a futex the consumer polls every ms
+   struct timespec pause = { 0, 1000000L };
+
+   (void)timeoutMs;
+   nanosleep(&pause, NULL);
+#endif
+}
+
+static void wakeUp(ingress_t *ingress)
+{
+#if defined(_WIN32)
+   SetEvent(ingress->wake);
+#elif defined(__linux__)
+   syscall(SYS_futex, (uint32_t *)&ingress->ring->waiting, FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+   (void)ingress;
+#endif
+}
+
+int IGRcreate(ingress_t *ingress, const char name[], uint32_t capacity)
+{
+   memset(ingress, 0, sizeof(ingress_t));
+   if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+   {
+      return -1;
+   }
+   snprintf(ingress->name, sizeof(ingress->name), "%s", name);
+   ingress->size = sizeOf(capacity);
+   ingress->ring = map(ingress, true);
+   if (ingress->ring == NULL)
+   {
+      return -1;
+   }
+   ingress->capacity = capacity;
+   ingress->owner = true;
+
+   memset(ingress->ring, 0, ingress->size);
+   ingress->ring->version = IGR_VERSION;
+   ingress->ring->capacity = capacity;
+   ingress->ring->fixed = IGR_FIXED;
+   // A producer checks the magic last
+   atomic_thread_fence(memory_order_release);
+   ingress->ring->magic = IGR_MAGIC;
+   return 0;
+}
+
+int IGRattach(ingress_t *ingress, const char name[])
+{
+   ingressRing_t header;
+   ingressRing_t *ring;
+
+   memset(ingress, 0, sizeof(ingress_t));
+   snprintf(ingress->name, sizeof(ingress->name), "%s", name);
+
+   // Map the header first for the capacity
+   ingress->size = sizeof(ingressRing_t);
+   ring = map(ingress, false);
+   if (ring == NULL)
+   {
+      return -1;
+   }
+   memcpy(&header, ring, sizeof(header));
+   ingress->ring = ring;
+   IGRclose(ingress);
+   if (header.magic != IGR_MAGIC || header.version != IGR_VERSION ||
+       header.fixed != IGR_FIXED || header.capacity == 0 ||
+       (header.capacity & (header.capacity - 1)) != 0)
+   {
+      return -1;
+   }
+
+   ingress->size = sizeOf(header.capacity);
+   ingress->ring = map(ingress, false);
+   if (ingress->ring == NULL)
+   {
+      return -1;
+   }
+   ingress->capacity = header.capacity;
+   ingress->head = atomic_load_explicit(&ingress->ring->head, memory_order_relaxed);
+   ingress->tail = atomic_load_explicit(&ingress->ring->tail, memory_order_acquire);
+   return 0;
+}
+
+void IGRclose(ingress_t *ingress)
+{
+   if (ingress->ring == NULL)
+   {
+      return;
+   }
+#ifdef _WIN32
+   UnmapViewOfFile(ingress->ring);
+   CloseHandle(ingress->wake);
+   CloseHandle(ingress->mapping);
+   ingress->wake = NULL;
+   ingress->mapping = NULL;
+#else
+   munmap(ingress->ring, ingress->size);
+   if (ingress->owner)
+   {
+      shm_unlink(ingress->name);
+   }
+#endif
+   ingress->ring = NULL;
+}
+
+uint32_t IGRreserve(ingress_t *ingress, ingressRecord_t **records, uint32_t max)
+{
+   const uint32_t index = ingress->head & (ingress->capacity - 1);
+   uint32_t n = ingress->capacity - (ingress->head - ingress->tail);
+
+   if (n < max)
+   {
+      // Looks full, read the index of the consumer again
+      ingress->tail = atomic_load_explicit(&ingress->ring->tail, memory_order_acquire);
+      n = ingress->capacity - (ingress->head - ingress->tail);
+   }
+   if (n > ingress->capacity - index)
+   {
+      n = ingress->capacity - index;
+   }
+   *records = &ingress->ring->record[index];
+   return (n < max) ? n : max;
+}
+
+void IGRcommit(ingress_t *ingress, uint32_t n)
+{
+   ingressRing_t *ring = ingress->ring;
+
+   ingress->head += n;
+   atomic_store_explicit(&ring->head, ingress->head, memory_order_release);
+
+   // Orders the store of head before the load of waiting, IGRwait() does
+   // the opposite, so either the consumer sees the records or we see it wait
+   atomic_thread_fence(memory_order_seq_cst);
+   if (atomic_load_explicit(&ring->waiting, memory_order_relaxed) != 0 &&
+       atomic_exchange_explicit(&ring->waiting, 0, memory_order_relaxed) != 0)
+   {
+      wakeUp(ingress);
+   }
+}
+
+bool IGRpush(ingress_t *ingress, const ingressRecord_t *record)
+{
+   ingressRecord_t *slot;
+
+   if (IGRreserve(ingress, &slot, 1) == 0)
+   {
+      return false;
+   }
+   *slot = *record;
+   IGRcommit(ingress, 1);
+   return true;
+}
+
+uint32_t IGRpeek(ingress_t *ingress, const ingressRecord_t **records)
+{
+   const uint32_t index = ingress->tail & (ingress->capacity - 1);
+   uint32_t n;
+
+   if (ingress->head == ingress->tail)
+   {
+      // Looks empty, read the index of the producer again
+      ingress->head = atomic_load_explicit(&ingress->ring->head, memory_order_acquire);
+   }
+   n = ingress->head - ingress->tail;
+   if (n > ingress->capacity - index)
+   {
+      n = ingress->capacity - index;
+   }
+   *records = &ingress->ring->record[index];
+   return n;
+}
+
+void IGRrelease(ingress_t *ingress, uint32_t n)
+{
+   ingress->tail += n;
+   atomic_store_explicit(&ingress->ring->tail, ingress->tail, memory_order_release);
+}
+
+bool IGRwait(ingress_t *ingress, uint32_t timeoutMs, bool (*idle)(void))
+{
+   ingressRing_t *ring = ingress->ring;
+
+   if (ingress->head != ingress->tail)
+   {
+      return true;
+   }
+   atomic_store_explicit(&ring->waiting, 1, memory_order_relaxed);
+   atomic_thread_fence(memory_order_seq_cst);
+   if (atomic_load_explicit(&ring->head, memory_order_relaxed) == ingress->tail &&
+       (idle == NULL || idle()))
+   {
+      sleepOn(ingress, timeoutMs);
+   }
+   atomic_store_explicit(&ring->waiting, 0, memory_order_relaxed);
+
+   ingress->head = atomic_load_explicit(&ring->head, memory_order_acquire);
+   return ingress->head != ingress->tail;
+}
+
+void IGRwake(ingress_t *ingress)
+{
+   // Orders the caller's publication before the load of waiting, IGRwait()
+   // checks idle() after its store of waiting
+   atomic_thread_fence(memory_order_seq_cst);
+   if (atomic_load_explicit(&ingress->ring->waiting, memory_order_relaxed) != 0 &&
+       atomic_exchange_explicit(&ingress->ring->waiting, 0, memory_order_relaxed) != 0)
+   {
+      wakeUp(ingress);
+   }
+}
+
+uint32_t IGRmicroseconds(void)
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint32_t)(now.tv_sec * 1000000u + now.tv_nsec / 1000);
+}
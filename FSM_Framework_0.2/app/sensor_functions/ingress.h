@@ -0,0 +1,108 @@
+#ifndef INGRESS_H
+#define INGRESS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensorValue.h"
+
+//---------------------------------------------------------------------- InGRess
+
+/// Sensor ingress from a data acquisition process: a single producer, single
+/// consumer ring of records in a shared memory segment. The producer writes
+/// records in place and publishes them with one store, the consumer reads
+/// them in place and frees them with one store; neither copies a record
+/// through a buffer of its own or makes a system call while records keep
+/// coming. Only a consumer that finds the ring empty sleeps on a futex (an
+/// event on Windows), the producer wakes it when it publishes.
+///
+/// The controller creates the ring, a producer attaches to it. Both ends
+/// cache the index of the other end and read it again only when the ring
+/// looks empty (consumer) or full (producer).
+
+#define IGR_MAGIC 0x52474946u  ///< "FIGR"
+#define IGR_VERSION 1
+
+/// A sample of a channel or an event for the FSM of a plant.
+typedef struct {
+   uint32_t plant;
+   sensorValue_t value;
+   uint32_t us;               ///< Time of the producer, see IGRmicroseconds()
+   uint8_t channel;           ///< channel_t of a sample
+   uint8_t event;             ///< event_t, E_NO for a sample
+   uint16_t reserved;
+} ingressRecord_t;
+
+/// The shared memory segment, the indexes are in cache lines of their own.
+typedef struct {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t capacity;                        ///< Records, a power of two
+   uint32_t fixed;                           ///< SENSOR_FIXED values
+   _Alignas(64) _Atomic uint32_t head;       ///< Records written, by the producer
+   _Alignas(64) _Atomic uint32_t tail;       ///< Records read, by the consumer
+   _Alignas(64) _Atomic uint32_t waiting;    ///< 1 while the consumer sleeps
+   _Alignas(64) ingressRecord_t record[];
+} ingressRing_t;
+
+/// One end of a ring.
+typedef struct {
+   ingressRing_t *ring;
+   uint32_t capacity;
+   uint32_t head;             ///< Producer: own index, consumer: cached
+   uint32_t tail;             ///< Consumer: own index, producer: cached
+   size_t size;
+   bool owner;                ///< Created the ring, removes it on close
+   char name[64];
+   void *mapping;             ///< Platform data of the segment
+   void *wake;                ///< Platform data of the wakeup
+} ingress_t;
+
+/// Creates the ring name of capacity records (consumer).
+/// \return 0 on success, -1 if capacity is not a power of two or on error.
+int IGRcreate(ingress_t *ingress, const char name[], uint32_t capacity);
+
+/// Attaches to the ring name (producer).
+/// \return 0 on success, -1 if no consumer created it or the value format
+/// differs.
+int IGRattach(ingress_t *ingress, const char name[]);
+
+/// Unmaps the ring, the consumer also removes it.
+void IGRclose(ingress_t *ingress);
+
+/// Reserves free records to write in place (producer).
+/// \return the number of consecutive free records, at most max.
+uint32_t IGRreserve(ingress_t *ingress, ingressRecord_t **records, uint32_t max);
+
+/// Publishes n reserved records and wakes the consumer if it sleeps.
+void IGRcommit(ingress_t *ingress, uint32_t n);
+
+/// Writes one record.
+/// \return false if the ring is full.
+bool IGRpush(ingress_t *ingress, const ingressRecord_t *record);
+
+/// Gets the records to read in place (consumer).
+/// \return the number of consecutive records, 0 if the ring is empty.
+uint32_t IGRpeek(ingress_t *ingress, const ingressRecord_t **records);
+
+/// Frees n records of IGRpeek().
+void IGRrelease(ingress_t *ingress, uint32_t n);
+
+/// Sleeps until the producer publishes records or IGRwake() is called, at
+/// most timeoutMs. idle() is checked after the consumer announced its wait,
+/// it does not sleep if idle() returns false; NULL for none.
+/// \return true if there are records.
+bool IGRwait(ingress_t *ingress, uint32_t timeoutMs, bool (*idle)(void));
+
+/// Ends an IGRwait() of the consumer, e.g. for an event of another thread.
+/// Call it after the event is published, that idle() of the consumer sees.
+void IGRwake(ingress_t *ingress);
+
+/// \return the monotonic time in us for the time stamp of a record, the
+/// same clock in all processes.
+uint32_t IGRmicroseconds(void);
+
+#endif
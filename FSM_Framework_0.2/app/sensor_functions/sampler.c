@@ -0,0 +1,232 @@
+#include "sampler.h"
+#include "hal_functions/hal.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------- SaMPler
+
+#define SMP_MASKS (1u << CH_NOF_CHANNELS)
+#define SMP_MILLI 1000u   ///< Tokens per read
+
+int SMPinitialise(sampler_t *sampler, const uint32_t plants[], size_t n,
+                  const samplerConfig_t config[CH_NOF_CHANNELS], uint32_t budget,
+                  samplerCallback_t callback, void *user, uint32_t now)
+{
+   memset(sampler, 0, sizeof(sampler_t));
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      // The sample times are aligned to a multiple of the interval
+      if (config[ch].minMs == 0)
+      {
+         return -1;
+      }
+   }
+   sampler->plants = plants;
+   sampler->n = n;
+   memcpy(sampler->config, config, sizeof(sampler->config));
+   sampler->budget = budget;
+   sampler->tokens = budget * SMP_MILLI;
+   sampler->lastRefill = now;
+   sampler->callback = callback;
+   sampler->user = user;
+
+   sampler->channels = malloc(n * sizeof(*sampler->channels));
+   sampler->ids = malloc(n * sizeof(uint32_t));
+   sampler->order = malloc(n * sizeof(size_t));
+   sampler->mask = calloc(n, 1);
+   sampler->values = malloc(n * sizeof(*sampler->values));
+   if (sampler->channels == NULL || sampler->ids == NULL || sampler->order == NULL ||
+       sampler->mask == NULL || sampler->values == NULL)
+   {
+      SMPterminate(sampler);
+      return -1;
+   }
+
+   for (size_t i = 0; i < n; i++)
+   {
+      for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+      {
+         sampler->channels[i][ch].last = VAL_NONE;
+         sampler->channels[i][ch].due = now;
+         sampler->channels[i][ch].interval = config[ch].baseMs;
+      }
+   }
+   return 0;
+}
+
+void SMPterminate(sampler_t *sampler)
+{
+   free(sampler->channels);
+   free(sampler->ids);
+   free(sampler->order);
+   free(sampler->mask);
+   free(sampler->values);
+   sampler->channels = NULL;
+   sampler->ids = NULL;
+   sampler->order = NULL;
+   sampler->mask = NULL;
+   sampler->values = NULL;
+}
+
+/// Adapts the interval of a channel to a new sample.
+static void adapt(samplerChannel_t *channel, const samplerConfig_t *config,
+                  sensorValue_t value, uint32_t now)
+{
+   bool changing = !VAL_IS_NONE(channel->last) &&
+                   VAL_ABS(value - channel->last) > config->changeDelta;
+   bool near = VAL_ABS(value - config->low) <= config->nearBand ||
+               VAL_ABS(value - config->high) <= config->nearBand;
+
+   if (changing || near)
+   {
+      channel->interval /= 2;
+      if (channel->interval < config->minMs)
+      {
+         channel->interval = config->minMs;
+      }
+   }
+   else
+   {
+      channel->interval *= 2;
+      if (channel->interval > config->maxMs)
+      {
+         channel->interval = config->maxMs;
+      }
+   }
+   channel->last = value;
+
+   // Align to a multiple of the interval, so channels (and plants) with the
+   // same interval are due together and are read in one transaction
+   channel->due = now - now % channel->interval + channel->interval;
+}
+
+/// \return mask of the channels of plant i that are due at now.
+static uint8_t dueChannels(const sampler_t *sampler, size_t i, uint32_t now)
+{
+   uint8_t mask = 0;
+
+   for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+   {
+      // Signed difference, so the wrap around of the ms counter is handled
+      if ((int32_t)(now - sampler->channels[i][ch].due) >= 0)
+      {
+         mask |= 1u << ch;
+      }
+   }
+   return mask;
+}
+
+long SMPprocess(sampler_t *sampler, uint32_t now)
+{
+   size_t count[SMP_MASKS] = {0};
+   size_t start[SMP_MASKS];
+   const size_t cursor = sampler->cursor;
+   size_t nofDue = 0;
+   long reads = 0;
+
+   // Refill the budget, at most one second of reads can be saved up
+   if (sampler->budget > 0)
+   {
+      // budget reads per s is budget milli reads per ms
+      uint64_t tokens = sampler->tokens +
+                        (uint64_t)sampler->budget * (uint32_t)(now - sampler->lastRefill);
+
+      sampler->tokens = tokens > sampler->budget * SMP_MILLI ?
+                        sampler->budget * SMP_MILLI : (uint32_t)tokens;
+   }
+   sampler->lastRefill = now;
+
+   // Select the due plants round robin, within the budget
+   for (size_t k = 0; k < sampler->n; k++)
+   {
+      size_t i = (cursor + k) % sampler->n;
+      uint8_t mask = dueChannels(sampler, i, now);
+      int bits = __builtin_popcount(mask);
+
+      sampler->mask[i] = 0;
+      if (mask == 0)
+      {
+         continue;
+      }
+      if (sampler->budget > 0)
+      {
+         if (sampler->tokens < bits * SMP_MILLI)
+         {
+            // Budget exhausted, this plant is served first next time and
+            // the plants not visited are not read now
+            sampler->cursor = i;
+            for (; k < sampler->n; k++)
+            {
+               sampler->mask[(cursor + k) % sampler->n] = 0;
+            }
+            break;
+         }
+         sampler->tokens -= bits * SMP_MILLI;
+      }
+      sampler->mask[i] = mask;
+      count[mask]++;
+      nofDue++;
+   }
+   if (nofDue == 0)
+   {
+      return 0;
+   }
+
+   // Group the plants per channel mask (counting sort)
+   start[0] = 0;
+   for (unsigned m = 1; m < SMP_MASKS; m++)
+   {
+      start[m] = start[m - 1] + count[m - 1];
+   }
+   for (size_t i = 0; i < sampler->n; i++)
+   {
+      if (sampler->mask[i] != 0)
+      {
+         sampler->order[start[sampler->mask[i]]++] = i;
+      }
+   }
+
+   // One transaction per channel mask
+   for (unsigned m = 1; m < SMP_MASKS; m++)
+   {
+      size_t first = start[m] - count[m];   // start[m] is now the end of group m
+
+      if (count[m] == 0)
+      {
+         continue;
+      }
+      for (size_t k = 0; k < count[m]; k++)
+      {
+         sampler->ids[k] = sampler->plants[sampler->order[first + k]];
+      }
+      if (HALreadChannels(sampler->ids, count[m], (uint8_t)m, sampler->values) != 0)
+      {
+         return -1;
+      }
+      sampler->transactions++;
+
+      for (size_t k = 0; k < count[m]; k++)
+      {
+         size_t i = sampler->order[first + k];
+
+         for (int ch = 0; ch < CH_NOF_CHANNELS; ch++)
+         {
+            if (m & (1u << ch))
+            {
+               sensorValue_t value = sampler->values[k][ch];
+
+               adapt(&sampler->channels[i][ch], &sampler->config[ch], value, now);
+               if (sampler->callback != NULL)
+               {
+                  sampler->callback(i, ch, value, sampler->user);
+               }
+               reads++;
+            }
+         }
+      }
+   }
+   sampler->reads += reads;
+   return reads;
+}
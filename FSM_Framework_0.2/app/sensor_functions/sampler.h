@@ -0,0 +1,81 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channels.h"
+#include "sensorValue.h"
+
+//---------------------------------------------------------------------- SaMPler
+
+/// Schedules the sensor reads of a rack of plants. Every channel of every
+/// plant has its own sample interval:
+/// - a channel that changes (more than changeDelta since the last sample) or
+///   is near a threshold (within nearBand) is sampled twice as fast, down to
+///   minMs,
+/// - a stable channel is sampled twice as slow, up to maxMs.
+/// Sample times are aligned to a multiple of the interval, use a power of two
+/// times minMs for baseMs and maxMs. The reads of one SMPprocess() call are
+/// grouped per channel mask, so all plants that need the same channels are
+/// read in one HAL transaction.
+/// A rack budget (channel reads per second) limits the bus load, plants are
+/// served round robin when the budget is exhausted.
+
+/// Sample settings of one channel.
+typedef struct {
+   uint32_t minMs;      ///< Fastest interval
+   uint32_t baseMs;     ///< Start interval
+   uint32_t maxMs;      ///< Slowest interval
+   sensorValue_t low;         ///< Lower threshold of the classifiers
+   sensorValue_t high;        ///< Upper threshold of the classifiers
+   sensorValue_t nearBand;    ///< Distance to a threshold that counts as near
+   sensorValue_t changeDelta; ///< Change since the last sample that counts as changing
+} samplerConfig_t;
+
+/// Schedule of one channel of one plant.
+typedef struct {
+   sensorValue_t last;  ///< Last sampled value, VAL_NONE before the first
+   uint32_t due;        ///< Time of the next sample
+   uint32_t interval;   ///< Current interval
+} samplerChannel_t;
+
+/// Called for every sampled value.
+/// \param plant index in the plants array of the sampler
+typedef void (*samplerCallback_t)(size_t plant, channel_t channel, sensorValue_t value, void *user);
+
+typedef struct {
+   const uint32_t *plants;                      ///< HAL ids of the rack
+   size_t n;
+   samplerConfig_t config[CH_NOF_CHANNELS];
+   samplerChannel_t (*channels)[CH_NOF_CHANNELS];
+   uint32_t budget;                             ///< Channel reads per second, 0 is unlimited
+   uint32_t tokens;                             ///< Budget left, in 1/1000 reads
+   uint32_t lastRefill;
+   size_t cursor;                               ///< Round robin start
+   samplerCallback_t callback;
+   void *user;
+   uint64_t reads;                              ///< Number of channel reads
+   uint64_t transactions;                       ///< Number of HAL transactions
+   // Work buffers, allocated once
+   uint32_t *ids;
+   size_t *order;
+   uint8_t *mask;
+   sensorValue_t (*values)[CH_NOF_CHANNELS];
+} sampler_t;
+
+/// Initialises sampler for n plants, all channels are due at now.
+/// \param config settings per channel
+/// \return 0 on success, -1 on out of memory or a minMs of 0.
+int SMPinitialise(sampler_t *sampler, const uint32_t plants[], size_t n,
+                  const samplerConfig_t config[CH_NOF_CHANNELS], uint32_t budget,
+                  samplerCallback_t callback, void *user, uint32_t now);
+
+/// Frees the buffers of sampler.
+void SMPterminate(sampler_t *sampler);
+
+/// Reads all due channels within the budget, calls the callback per value.
+/// \return the number of channel reads, -1 on a bus error.
+long SMPprocess(sampler_t *sampler, uint32_t now);
+
+#endif
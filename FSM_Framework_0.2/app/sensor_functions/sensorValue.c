@@ -0,0 +1,125 @@
+#include "sensorValue.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+//------------------------------------------------------------------------ VALue
+
+#define VAL_MAX_WHOLE 9999999u ///< Integer part saturates, fits all builds
+
+static bool isDigit(char c)
+{
+   return c >= '0' && c <= '9';
+}
+
+sensorValue_t VALparse(const char text[], const char **end)
+{
+   const char *p = text;
+   const char *digits;
+   bool negative = false;
+   uint32_t whole = 0;
+   sensorValue_t value;
+
+   while (*p == ' ' || *p == '\t')
+   {
+      p++;
+   }
+   if (*p == '-' || *p == '+')
+   {
+      negative = (*p++ == '-');
+   }
+   digits = p;
+   for (; isDigit(*p); p++)
+   {
+      if (whole <= VAL_MAX_WHOLE)
+      {
+         whole = whole * 10 + (*p - '0');
+      }
+   }
+   if (whole > VAL_MAX_WHOLE)
+   {
+      whole = VAL_MAX_WHOLE;
+   }
+
+#ifdef SENSOR_FIXED
+   int32_t fraction = 0;
+   int32_t weight = VAL_SCALE / 10;   // Of the next fraction digit
+
+   if (*p == '.' && (p > digits || isDigit(p[1])))
+   {
+      for (p++; isDigit(*p); p++)
+      {
+         if (weight > 0)
+         {
+            fraction += (*p - '0') * weight;
+         }
+         else if (weight == 0 && *p >= '5')
+         {
+            fraction++;   // Round on the first digit that does not fit
+         }
+         weight = (weight > 0) ? weight / 10 : -1;
+      }
+   }
+   value = (sensorValue_t)whole * VAL_SCALE + fraction;
+#else
+   static const float powers[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                   1e6f, 1e7f, 1e8f, 1e9f };
+   uint32_t fraction = 0;
+   int decimals = 0;
+
+   if (*p == '.' && (p > digits || isDigit(p[1])))
+   {
+      for (p++; isDigit(*p); p++)
+      {
+         // Digits beyond the precision of a float are ignored
+         if (decimals < 9)
+         {
+            fraction = fraction * 10 + (*p - '0');
+            decimals++;
+         }
+      }
+   }
+   value = (sensorValue_t)whole + (sensorValue_t)fraction / powers[decimals];
+#endif
+
+   if (p == digits)
+   {
+      // No number, nothing is consumed
+      p = text;
+      value = 0;
+   }
+   if (end != NULL)
+   {
+      *end = p;
+   }
+   return negative ? -value : value;
+}
+
+int VALformat(char text[], size_t size, sensorValue_t value)
+{
+#ifdef SENSOR_FIXED
+   int32_t tenths = VAL_TO_TENTHS(value);
+   uint32_t magnitude = tenths < 0 ? -(uint32_t)tenths : (uint32_t)tenths;
+
+   return snprintf(text, size, "%s%lu.%lu", tenths < 0 ? "-" : "",
+                   (unsigned long)(magnitude / 10),
+                   (unsigned long)(magnitude % 10));
+#else
+   return snprintf(text, size, "%.1f", value);
+#endif
+}
+
+sensorValue_t VALaverage(sensorSum_t sum, uint32_t count)
+{
+   if (count == 0)
+   {
+      return 0;
+   }
+#ifdef SENSOR_FIXED
+   // Rounded half away from zero
+   return (sensorValue_t)((sum + (sum < 0 ? -(sensorSum_t)count : (sensorSum_t)count) / 2)
+                          / (sensorSum_t)count);
+#else
+   return sum / count;
+#endif
+}
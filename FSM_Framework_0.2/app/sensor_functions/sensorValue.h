@@ -0,0 +1,61 @@
+#ifndef SENSORVALUE_H
+#define SENSORVALUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//------------------------------------------------------------------------ VALue
+
+/// Sensor values, thresholds and aggregates are sensorValue_t. Define
+/// SENSOR_FIXED for targets without FPU: the values are then integers in
+/// 1/VAL_SCALE units, and sampling, classifying and posting the event use
+/// integer arithmetic only. Use VAL() for constants, it is evaluated by the
+/// compiler.
+
+#ifdef SENSOR_FIXED
+
+#define VAL_SCALE 100                  ///< Resolution 0.01
+typedef int32_t sensorValue_t;
+typedef int64_t sensorSum_t;           ///< Sum of values, for averages
+
+#define VAL(x) ((sensorValue_t)((x) * VAL_SCALE + ((x) < 0 ? -0.5 : 0.5)))
+#define VAL_NONE INT32_MIN             ///< No value (yet)
+#define VAL_IS_NONE(v) ((v) == VAL_NONE)
+#define VAL_FROM_TENTHS(t) ((sensorValue_t)(t) * (VAL_SCALE / 10))
+#define VAL_TO_TENTHS(v) \
+   (((v) + ((v) < 0 ? -VAL_SCALE / 20 : VAL_SCALE / 20)) / (VAL_SCALE / 10))
+
+#else
+
+#include <math.h>
+
+#define VAL_SCALE 1
+typedef float sensorValue_t;
+typedef float sensorSum_t;
+
+#define VAL(x) ((sensorValue_t)(x))
+#define VAL_NONE NAN
+#define VAL_IS_NONE(v) isnan(v)
+#define VAL_FROM_TENTHS(t) ((sensorValue_t)(t) / 10.0f)
+#define VAL_TO_TENTHS(v) ((int32_t)((v) * 10.0f + ((v) < 0 ? -0.5f : 0.5f)))
+
+#endif
+
+#define VAL_ABS(v) ((v) < 0 ? -(v) : (v))
+
+/// Parses a decimal number like "-12.345" without floating point
+/// arithmetic, extra digits are rounded. Leading spaces are skipped.
+/// \param end set to the first char after the number, when not NULL
+/// \return the value, 0 if text does not start with a number (end is then
+///         text).
+sensorValue_t VALparse(const char text[], const char **end);
+
+/// Formats value with one decimal, like "%.1f" but without floating point
+/// arithmetic in the fixed point build.
+/// \return the number of chars written, see snprintf().
+int VALformat(char text[], size_t size, sensorValue_t value);
+
+/// \return sum / count rounded, 0 if count is 0.
+sensorValue_t VALaverage(sensorSum_t sum, uint32_t count);
+
+#endif
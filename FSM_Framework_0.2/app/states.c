@@ -1,4 +1,4 @@
-char * stateEnumToText[] =
+const char * const stateEnumToText[] =
 {
    "S_NO", ///< Used for initialisation if state is not yet known KEEP NO START AND INIT
    "S_START",       /// < simulates [*]
@@ -8,10 +8,11 @@ char * stateEnumToText[] =
    "S_LOGERROR",
    "S_AIRFLOW",
    "S_MOISTURIZE",
-   "S_HEAT"
+   "S_HEAT",
+   "S_PROCESSING"
 };
 
-char * lightStateEnumToText[] =
+const char * const lightStateEnumToText[] =
 {
    "GREEN",
    "ORANGE",
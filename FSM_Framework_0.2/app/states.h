@@ -11,7 +11,8 @@ typedef enum {
    S_AIRFLOW,
    S_MOISTURIZE,
    S_HEAT,
-   //end
+   S_PROCESSING,       ///< Encloses S_CHECKCHANGE and the action states
+   S_NOF_STATES,       ///< Number of states, KEEP LAST
 } state_t;
 
 #endif
@@ -3,5 +3,6 @@
 
 #endif // VARIABLES_H
 
+#include "plant_functions/plant.h"
 
-int lightstatus = 0;    //0 green, 1 orange, 2 red
+plant_t plant;          // the plant module controlled by this application
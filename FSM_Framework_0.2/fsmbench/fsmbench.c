@@ -0,0 +1,2263 @@
+/*!
+ * fsmbench measures the hot paths of the FSM framework and the plant module
+ * subsystems with synthetic loads, so a change can be compared before and
+ * after on the same machine. Every bench prints its own table; build with
+ * -O2 and the same SENSOR_FIXED and FSM_COMPACT flags as the controller.
+ *
+ * usage: fsmbench [bench ...]   runs all benches without arguments
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "appInfo.h"
+#include "console_functions/display.h"
+#include "console_functions/keyboard.h"
+#include "console_functions/systemErrors.h"
+#include "fsm_functions/fsm.h"
+#include "fsm_functions/reactor.h"
+#include "hal_functions/hal.h"
+#include "hal_functions/halSimulator.h"
+#include "plant_functions/actuator.h"
+#include "plant_functions/arbiter.h"
+#include "plant_functions/montecarlo.h"
+#include "plant_functions/plant.h"
+#include "plant_functions/profile.h"
+#include "plant_functions/snapshot.h"
+#include "plant_functions/telemetry.h"
+#include "sensor_functions/filter.h"
+#include "sensor_functions/history.h"
+#include "sensor_functions/ingest.h"
+#include "sensor_functions/ingress.h"
+#include "sensor_functions/sampler.h"
+#include "sensor_functions/sensorValue.h"
+
+/// The event loop of the framework handles this event, see main.c
+event_t event;
+
+/// Keeps the optimiser from removing the work of a bench
+static volatile double sink;
+
+/// Monotonic time in seconds
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/// Deterministic random numbers, the benches do not depend on rand()
+static uint64_t seed = 88172645463325252ull;
+
+/// \return a uniform number in [0, 1)
+static double uniform(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/// \return a normal distributed number, mean 0 and standard deviation 1
+static double gauss(void) {
+    return sqrt(-2.0 * log(1.0 - uniform())) * cos(2.0 * M_PI * uniform());
+}
+
+/// Empties the event buffer of the selected instance between benches
+static void drain(void) {
+    FSM_ReleaseEvents(FSM_NofEvents());
+}
+
+//------------------------------------------------------------ Run to completion
+
+static long cycles;        ///< Cycles left of the loop
+static bool internal;      ///< Post with FSM_AddInternalEvent()
+
+static void post(event_t e) {
+    if (internal) {
+        FSM_AddInternalEvent(e);
+    } else {
+        FSM_AddEvent(e);
+    }
+}
+
+static void loopWaitInput(void) {
+    if (cycles-- > 0) {
+        post(E_INPUTCHANGED);
+    }
+}
+
+static void loopCheckChange(void) {
+    post(E_MOISTURELOW);
+}
+
+static void loopMoisturize(void) {
+    post(E_RESET);
+}
+
+/// The WAITINPUT -> CHECKCHANGE -> MOISTURIZE -> WAITINPUT loop of the plant,
+/// the handlers only post the next event
+static const state_funcs_t loopStates[] = {
+    [S_WAITINPUT]   = { loopWaitInput,   NULL, 0, S_NO         },
+    [S_CHECKCHANGE] = { loopCheckChange, NULL, 0, S_PROCESSING },
+    [S_MOISTURIZE]  = { loopMoisturize,  NULL, 0, S_PROCESSING },
+    [S_PROCESSING]  = { NULL,            NULL, 0, S_NO         },
+};
+
+static const transition_t loopTransitions[] = {
+    { S_START,       E_INIT,         S_WAITINPUT   },
+    { S_WAITINPUT,   E_INPUTCHANGED, S_CHECKCHANGE },
+    { S_CHECKCHANGE, E_MOISTURELOW,  S_MOISTURIZE  },
+    { S_PROCESSING,  E_RESET,        S_WAITINPUT   },
+};
+
+/// \return ns per cycle of n cycles, like the event loop a run that stopped
+/// at a cycle is continued with E_NO
+static double runLoop(bool useInternal, long n) {
+    state_t state;
+    double start;
+
+    internal = useInternal;
+    cycles = n;
+    start = now();
+    state = FSM_EventHandler(S_START, E_INIT);
+    while (cycles >= 0) {
+        state = FSM_EventHandler(state, FSM_NoEvents() ? E_NO : FSM_GetEvent());
+    }
+    return (now() - start) * 1e9 / n;
+}
+
+/// Events of the next transition through the event buffer and
+/// through the run-to-completion channel
+static void benchInternal(void) {
+    FSM_SetModel(loopStates, sizeof(loopStates) / sizeof(loopStates[0]),
+                 loopTransitions, sizeof(loopTransitions) / sizeof(loopTransitions[0]));
+    FSM_FlushEnexpectedEvents(true);
+    printf("%-20s %12s\n", "Next event", "ns/cycle");
+    for (int run = 0; run < 3; run++) {
+        printf("%-20s %12.1f\n", "event buffer", runLoop(false, 5000000));
+        printf("%-20s %12.1f\n", "internal channel", runLoop(true, 5000000));
+    }
+    drain();
+}
+
+//--------------------------------------------------------------------- Snapshot
+
+#define SNAPSHOT_PLANTS 10000
+#define SNAPSHOT_RUNS 20
+
+/// Cost of a checkpoint in the thread of the FSM, of writing it and of a
+/// warm restart of 10000 plants
+static void benchSnapshot(void) {
+    static const char path[] = "fsmbench.snp";
+    plant_t *plants = calloc(SNAPSHOT_PLANTS, sizeof(plant_t));
+    double capture = 1e9;
+    double restore;
+    double start;
+    long size = 0;
+    long restored;
+
+    if (plants == NULL) {
+        printf("Out of memory\n");
+        return;
+    }
+    for (uint32_t i = 0; i < SNAPSHOT_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+        PLTselect(&plants[i]);
+        plants[i].fsm.state = S_WAITINPUT;
+        FSM_AddEvent(E_INPUTCHANGED);
+        PLTstartTimer(&plants[i], 0, 1000 + i, E_RESET);
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            PLTaddSample(&plants[i], ch, VAL(20) + VAL(0.1) * (sensorValue_t)(i % 50));
+        }
+    }
+    /// The default FSM instance and error bits again
+    FSM_SelectContext(NULL);
+    selectSystemErrors(NULL);
+
+    /// The best of the runs, the first one also allocates the buffers
+    for (int run = 0; run < SNAPSHOT_RUNS; run++) {
+        start = now();
+        size = SNPcapture(plants, SNAPSHOT_PLANTS);
+        capture = fmin(capture, now() - start);
+    }
+    if (size < 0) {
+        printf("Out of memory\n");
+        free(plants);
+        return;
+    }
+    printf("%d plants, %ld bytes, %.1f bytes/plant\n", SNAPSHOT_PLANTS, size,
+           (double)size / SNAPSHOT_PLANTS);
+    printf("%-20s %10.3f ms %8.1f ns/plant\n", "capture", capture * 1e3,
+           capture * 1e9 / SNAPSHOT_PLANTS);
+    start = now();
+    if (SNPwrite(path) != 0) {
+        printf("Cannot write %s\n", path);
+        free(plants);
+        return;
+    }
+    printf("%-20s %10.3f ms\n", "write", (now() - start) * 1e3);
+    start = now();
+    restored = SNPrestore(path, plants, SNAPSHOT_PLANTS);
+    restore = now() - start;
+    printf("%-20s %10.3f ms %8.1f ns/plant, %ld restored\n", "restore", restore * 1e3,
+           restore * 1e9 / SNAPSHOT_PLANTS, restored);
+    remove(path);
+    free(plants);
+}
+
+//--------------------------------------------------------------------- Actuator
+
+#define ACTUATIONS 10000
+
+/// Waits 200 .. 1000 ms and then for a signal, like a valve with an acknowledge
+static PT_THREAD(valveAction(actuation_t *act)) {
+    PT_BEGIN(&act->pt);
+    ACT_WAIT_MS(act, act->data);
+    ACT_WAIT_SIGNAL(act);
+    PT_END(&act->pt);
+}
+
+/// Cost of polling many actuations in progress
+static void benchActuator(void) {
+    plant_t *plants = calloc(ACTUATIONS, sizeof(plant_t));
+    double start;
+    double busy = 0;
+    long polls = 0;
+    size_t peak;
+    size_t done = 0;
+
+    if (plants == NULL || ACTinitialise(ACTUATIONS) != 0) {
+        printf("Out of memory\n");
+        free(plants);
+        return;
+    }
+    start = now();
+    for (size_t i = 0; i < ACTUATIONS; i++) {
+        PLTinitialise(&plants[i], (uint32_t)i);
+        ACTstart(&plants[i], valveAction, 200 + (uint32_t)(uniform() * 800), E_RESET);
+    }
+    peak = ACTinProgress();
+    printf("Started %zu actuations in %.2f ms\n", peak, (now() - start) * 1e3);
+
+    start = now();
+    while (ACTinProgress() > 0) {
+        double t = now();
+
+        ACTprocess(PLTnow());
+        busy += now() - t;
+        /// The acknowledges arrive now and then
+        if (++polls % 1000 == 0) {
+            for (size_t i = 0; i < ACTUATIONS; i++) {
+                ACTsignal(&plants[i]);
+            }
+        }
+    }
+    for (size_t i = 0; i < ACTUATIONS; i++) {
+        PLTselect(&plants[i]);
+        done += FSM_NofEvents();
+    }
+    /// The default FSM instance and error bits again
+    FSM_SelectContext(NULL);
+    selectSystemErrors(NULL);
+    printf("All done after %.0f ms, %ld polls of %.2f us with up to %zu in progress, "
+           "%zu done events\n", (now() - start) * 1e3, polls, busy / polls * 1e6, peak, done);
+    free(plants);
+}
+
+//-------------------------------------------------------------------------- HAL
+
+#define HAL_PLANTS 1000
+
+static void report(const char name[], double seconds) {
+    halStats_t stats;
+
+    HALsimulatorStats(&stats, true);
+    printf("%-24s %8llu %9llu %9.1f %9.3f %9.3f\n", name,
+           (unsigned long long)stats.transactions, (unsigned long long)stats.bytes,
+           stats.busUs / 1e3, stats.busUs / 1e3 / HAL_PLANTS, seconds * 1e3);
+}
+
+/// Bus time of per channel, per plant and per rack transactions
+static void benchHal(void) {
+    static sensorValue_t values[HAL_PLANTS][CH_NOF_CHANNELS];
+    static uint32_t ids[HAL_PLANTS];
+    const halBusModel_t model = { 500, 20, false };
+    double start;
+
+    HALinitialise(HALsimulator(HAL_PLANTS, &model));
+    for (uint32_t i = 0; i < HAL_PLANTS; i++) {
+        ids[i] = i;
+    }
+    printf("%-24s %8s %9s %9s %9s %9s\n", "Access", "Trans", "Bytes", "Bus ms",
+           "ms/plant", "CPU ms");
+    start = now();
+    for (uint32_t i = 0; i < HAL_PLANTS; i++) {
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            HALreadChannel(i, ch, &values[i][ch]);
+        }
+    }
+    report("read per channel", now() - start);
+    start = now();
+    for (uint32_t i = 0; i < HAL_PLANTS; i++) {
+        HALreadPlant(i, values[i]);
+    }
+    report("read per plant", now() - start);
+    start = now();
+    HALreadRack(ids, HAL_PLANTS, values);
+    report("read rack", now() - start);
+    start = now();
+    for (uint32_t i = 0; i < HAL_PLANTS; i++) {
+        for (int a = 0; a < HAL_NOF_ACTUATORS; a++) {
+            HALcommand(i, a, 1);
+            HALflush();
+        }
+    }
+    report("commands, flush each", now() - start);
+    start = now();
+    for (uint32_t i = 0; i < HAL_PLANTS; i++) {
+        for (int a = 0; a < HAL_NOF_ACTUATORS; a++) {
+            HALcommand(i, a, 1);
+        }
+    }
+    HALflush();
+    report("commands, one flush", now() - start);
+}
+
+//---------------------------------------------------------------------- Sampler
+
+#define SAMPLE_PLANTS 100
+#define DAY_S 86400
+
+static const sensorValue_t sampleLow[CH_NOF_CHANNELS] = {
+    VAL(20), VAL(20), VAL(20), VAL(40), VAL(100), VAL(0.5),
+};
+static const sensorValue_t sampleHysteresis[CH_NOF_CHANNELS] = {
+    VAL(0.5), VAL(0.5), VAL(0.5), VAL(2), VAL(30), VAL(0.05),
+};
+static long second;                                          ///< Simulated time
+static long crossedAt[SAMPLE_PLANTS][CH_NOF_CHANNELS];       ///< -1 for none
+static long latencySum, latencyN, latencyMax;
+
+/// The true value of a channel: day cycles, a drying soil and noise
+static double truth(int plant, channel_t channel, long t) {
+    const double phase = 2 * M_PI * t / DAY_S + plant * 0.01;
+    const double noise = (uniform() - 0.5) * 0.1;
+
+    switch (channel) {
+        case CH_TEMPERATURE:
+            return 19 + 5 * sin(phase - M_PI / 2) + noise;
+        case CH_LIGHT:
+            return fmax(0, 900 * sin(phase - M_PI / 2));
+        case CH_MOISTURE:
+            return 24.5 - 0.5 * fmod(t / 3600.0 + plant * 0.1, 10) + noise;
+        case CH_CO2:
+            return 22.5 + 3 * sin(2 * phase) + noise;
+        case CH_HUMIDITY:
+            return 55 + 10 * sin(phase) + noise * 10;
+        default:
+            return 1.0;
+    }
+}
+
+/// Latency between a value crossing its low bound and the sample that sees it
+static void sampled(size_t plant, channel_t channel, sensorValue_t value, void *user) {
+    (void)user;
+    if (value < sampleLow[channel] && crossedAt[plant][channel] >= 0) {
+        long latency = second - crossedAt[plant][channel];
+
+        latencySum += latency;
+        latencyN++;
+        if (latency > latencyMax) {
+            latencyMax = latency;
+        }
+        crossedAt[plant][channel] = -1;
+    }
+}
+
+static void sampleDay(const char name[], const samplerConfig_t config[], uint32_t budget) {
+    static bool below[SAMPLE_PLANTS][CH_NOF_CHANNELS];
+    const halBusModel_t model = { 500, 20, false };
+    uint32_t ids[SAMPLE_PLANTS];
+    long crossings = 0;
+    long missed = 0;
+    sampler_t sampler;
+    halStats_t stats;
+
+    HALinitialise(HALsimulator(SAMPLE_PLANTS, &model));
+    for (uint32_t i = 0; i < SAMPLE_PLANTS; i++) {
+        ids[i] = i;
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            below[i][ch] = true;
+            crossedAt[i][ch] = -1;
+        }
+    }
+    latencySum = latencyN = latencyMax = 0;
+    if (SMPinitialise(&sampler, ids, SAMPLE_PLANTS, config, budget, sampled, NULL, 0) != 0) {
+        printf("Out of memory\n");
+        return;
+    }
+    for (second = 0; second < DAY_S; second++) {
+        for (int i = 0; i < SAMPLE_PLANTS; i++) {
+            for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+                /// The sensors have a resolution of 0.1
+                sensorValue_t value = VAL_FROM_TENTHS(lround(truth(i, ch, second) * 10));
+
+                HALsimulatorSetSensor(i, ch, value);
+                if (!below[i][ch] && value < sampleLow[ch]) {
+                    below[i][ch] = true;
+                    crossings++;
+                    crossedAt[i][ch] = second;
+                } else if (below[i][ch] && value > sampleLow[ch] + sampleHysteresis[ch]) {
+                    below[i][ch] = false;
+                    if (crossedAt[i][ch] >= 0) {
+                        /// Back above the bound before it was sampled
+                        missed++;
+                        crossedAt[i][ch] = -1;
+                    }
+                }
+            }
+        }
+        SMPprocess(&sampler, (uint32_t)(second * 1000));
+    }
+    HALsimulatorStats(&stats, true);
+    printf("%-22s %9.1f %8.0f %6.1f%% %7.1f %6ld %5ld/%ld\n", name,
+           sampler.reads / 24.0 / SAMPLE_PLANTS, stats.transactions / 24.0,
+           stats.busUs / 1e6 / DAY_S * 100, latencyN > 0 ? (double)latencySum / latencyN : 0.0,
+           latencyMax, missed, crossings);
+    SMPterminate(&sampler);
+}
+
+/// Fixed sample rates against the adaptive sampler, one day of
+/// simulated plants
+static void benchSampler(void) {
+    static const uint32_t fixedMs[] = { 1000, 10000, 60000 };
+    static const sensorValue_t nearBand[CH_NOF_CHANNELS] = {
+        VAL(1), VAL(1), VAL(1), VAL(3), VAL(50), VAL(0.1),
+    };
+    static const sensorValue_t changeDelta[CH_NOF_CHANNELS] = {
+        VAL(0.3), VAL(0.3), VAL(0.3), VAL(1.5), VAL(20), VAL(0.05),
+    };
+    samplerConfig_t config[CH_NOF_CHANNELS];
+    char name[32];
+
+    printf("%-22s %9s %8s %7s %7s %6s %s\n", "Sampling", "Reads/h", "Trans/h", "Bus",
+           "Lat s", "Max s", "Missed");
+    for (size_t r = 0; r < sizeof(fixedMs) / sizeof(fixedMs[0]); r++) {
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            /// Never near a bound, never changing: the interval stays fixed
+            config[ch] = (samplerConfig_t){ fixedMs[r], fixedMs[r], fixedMs[r],
+                                            sampleLow[ch], VAL(10000), VAL(-1), VAL(10000) };
+        }
+        snprintf(name, sizeof(name), "fixed %u s", fixedMs[r] / 1000);
+        sampleDay(name, config, 0);
+    }
+    for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+        config[ch] = (samplerConfig_t){ 1000, 8000, 256000, sampleLow[ch], VAL(10000),
+                                        nearBand[ch], changeDelta[ch] };
+    }
+    sampleDay("adaptive 1 .. 256 s", config, 0);
+    sampleDay("adaptive, 100 reads/s", config, 100);
+    sampleDay("adaptive, 200 reads/s", config, 200);
+}
+
+//----------------------------------------------------------------------- Errors
+
+#define ERROR_OPS 4000000
+
+static errorSet_t errorSet;
+static pthread_mutex_t errorLock = PTHREAD_MUTEX_INITIALIZER;
+static systemErrors_t lockedBits;   ///< The bits of the mutex baseline
+
+typedef struct {
+    int bit;
+    bool locked;                    ///< The baseline: a mutex around the bits
+    long errors;                    ///< A bit of the thread was lost
+} errorThread_t;
+
+/// Sets, reads and clears a bit of its own, like a subsystem that raises and
+/// solves an error while others read the set
+static void *toggleErrors(void *arg) {
+    errorThread_t *thread = arg;
+    const systemErrors_t mask = (systemErrors_t)1 << thread->bit;
+
+    for (long i = 0; i < ERROR_OPS / 3; i++) {
+        if (thread->locked) {
+            pthread_mutex_lock(&errorLock);
+            lockedBits |= mask;
+            pthread_mutex_unlock(&errorLock);
+            pthread_mutex_lock(&errorLock);
+            thread->errors += (lockedBits & mask) == 0;
+            pthread_mutex_unlock(&errorLock);
+            pthread_mutex_lock(&errorLock);
+            lockedBits &= ~mask;
+            pthread_mutex_unlock(&errorLock);
+        } else {
+            setErrorBit(&errorSet, thread->bit);
+            thread->errors += !getErrorBit(&errorSet, thread->bit);
+            clearErrorBit(&errorSet, thread->bit);
+        }
+    }
+    return NULL;
+}
+
+/// Concurrent set, get and clear of the error bits, and rendering the string
+static void benchErrors(void) {
+    static const int threads[] = { 1, 2, 4 };
+    errorThread_t thread[4];
+    pthread_t id[4];
+    const char *text = NULL;
+    double start;
+
+    initErrorSet(&errorSet);
+    printf("%-8s %14s %14s %8s\n", "Threads", "atomic ns/op", "mutex ns/op", "Lost");
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        double seconds[2];
+        long lost = 0;
+
+        for (int locked = 0; locked < 2; locked++) {
+            start = now();
+            for (int i = 0; i < threads[t]; i++) {
+                thread[i] = (errorThread_t){ i, locked, 0 };
+                pthread_create(&id[i], NULL, toggleErrors, &thread[i]);
+            }
+            for (int i = 0; i < threads[t]; i++) {
+                pthread_join(id[i], NULL);
+                lost += thread[i].errors;
+            }
+            seconds[locked] = now() - start;
+        }
+        lost += getErrorBits(&errorSet) != 0 || lockedBits != 0;
+        printf("%-8d %14.2f %14.2f %8ld\n", threads[t], seconds[0] * 1e9 / ERROR_OPS / threads[t],
+               seconds[1] * 1e9 / ERROR_OPS / threads[t], lost);
+    }
+
+    /// The string is rendered again only when the bits changed
+    start = now();
+    for (long i = 0; i < ERROR_OPS; i++) {
+        text = getErrorBitsString(&errorSet);
+    }
+    printf("%-20s %8.2f ns\n", "render, unchanged", (now() - start) * 1e9 / ERROR_OPS);
+    start = now();
+    for (long i = 0; i < ERROR_OPS; i++) {
+        if (i & 1) {
+            setErrorBit(&errorSet, ERR_NOF_ERRORS - 1);
+        } else {
+            clearErrorBit(&errorSet, ERR_NOF_ERRORS - 1);
+        }
+        text = getErrorBitsString(&errorSet);
+    }
+    printf("%-20s %8.2f ns (with the change)\n", "render, changed", (now() - start) * 1e9 / ERROR_OPS);
+    sink = text[0];
+}
+
+//---------------------------------------------------------------------- Display
+
+#define DISPLAY_UPDATES 20000
+#define CLEAR_UPDATES 50
+
+/// Sends the output of the display to /dev/null while a bench runs.
+/// \return the saved stdout and stderr, for loud()
+static int quiet(int saved[2]) {
+    int null = open("/dev/null", O_WRONLY);
+
+    fflush(stdout);
+    if (null < 0) {
+        return -1;
+    }
+    saved[0] = dup(STDOUT_FILENO);
+    saved[1] = dup(STDERR_FILENO);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    close(null);
+    return 0;
+}
+
+static void loud(const int saved[2]) {
+    fflush(stdout);
+    dup2(saved[0], STDOUT_FILENO);
+    dup2(saved[1], STDERR_FILENO);
+    close(saved[0]);
+    close(saved[1]);
+}
+
+/// The frame of the display in one write() against the former update: a
+/// clear command and a printf() per row
+static void benchDisplay(void) {
+    char rows[DISPLAY_HEIGHT][DISPLAY_WIDTH + 1];
+    double frame;
+    double lines;
+    double clear;
+    double start;
+    int saved[2];
+
+    for (int row = 0; row < DISPLAY_HEIGHT; row++) {
+        memset(rows[row], row == 0 || row == DISPLAY_HEIGHT - 1 ? '=' : ' ', DISPLAY_WIDTH);
+        rows[row][0] = '|';
+        rows[row][DISPLAY_WIDTH] = '\0';
+    }
+    if (quiet(saved) != 0) {
+        printf("Cannot open /dev/null\n");
+        return;
+    }
+    DSPinitialise();
+    start = now();
+    for (int i = 0; i < DISPLAY_UPDATES; i++) {
+        DSPshowDisplay();
+    }
+    frame = (now() - start) / DISPLAY_UPDATES;
+    start = now();
+    for (int i = 0; i < DISPLAY_UPDATES; i++) {
+        /// A terminal flushes each line
+        for (int row = 0; row < DISPLAY_HEIGHT; row++) {
+            printf("%s\n", rows[row]);
+            fflush(stdout);
+        }
+        printf("Errors: %s\n", getSystemErrorBitsString());
+        fflush(stdout);
+        puts("\nDevelopment Console:");
+        fflush(stdout);
+    }
+    lines = (now() - start) / DISPLAY_UPDATES;
+    start = now();
+    for (int i = 0; i < CLEAR_UPDATES; i++) {
+        if (system("clear") == -1) {
+            break;
+        }
+    }
+    clear = (now() - start) / CLEAR_UPDATES;
+    loud(saved);
+
+    printf("%dx%d display\n", DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    printf("%-30s %10.2f us/update\n", "frame buffer, one write()", frame * 1e6);
+    printf("%-30s %10.2f us/update\n", "printf() per row", lines * 1e6);
+    printf("%-30s %10.2f us/update\n", "clear command + per row", (clear + lines) * 1e6);
+}
+
+//-------------------------------------------------------------------- Dashboard
+
+#define DASHBOARD_PLANTS 100000
+#define DASHBOARD_PAGES 2000
+
+/// Time to show a page of the dashboard, for a small and a large rack: only
+/// the cells of the page are formatted
+static void benchDashboard(void) {
+    static const size_t racks[] = { 100, 10000, DASHBOARD_PLANTS };
+    plant_t *plants = calloc(DASHBOARD_PLANTS, sizeof(plant_t));
+    int saved[2];
+
+    if (plants == NULL || DSPsetSize(DASHBOARD_WIDTH, DASHBOARD_HEIGHT) != 0) {
+        printf("Out of memory\n");
+        free(plants);
+        return;
+    }
+    for (uint32_t i = 0; i < DASHBOARD_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+        plants[i].fsm.state = S_WAITINPUT;
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            PLTaddSample(&plants[i], ch, VAL(20));
+        }
+    }
+    printf("%dx%d dashboard\n%-10s %8s %14s %14s\n", DASHBOARD_WIDTH, DASHBOARD_HEIGHT,
+           "Plants", "Pages", "first us/page", "last us/page");
+    for (size_t r = 0; r < sizeof(racks) / sizeof(racks[0]); r++) {
+        double first;
+        double last;
+        double start;
+        int pages;
+
+        DSPsetDashboard(racks[r], PLT_STATUS_WIDTH, PLTformatStatus, plants);
+        pages = DSPdashboardPages();
+        if (quiet(saved) != 0) {
+            printf("Cannot open /dev/null\n");
+            break;
+        }
+        start = now();
+        for (int i = 0; i < DASHBOARD_PAGES; i++) {
+            DSPshowDashboard(0);
+        }
+        first = (now() - start) / DASHBOARD_PAGES;
+        start = now();
+        for (int i = 0; i < DASHBOARD_PAGES; i++) {
+            DSPshowDashboard(pages - 1);
+        }
+        last = (now() - start) / DASHBOARD_PAGES;
+        loud(saved);
+        printf("%-10zu %8d %14.2f %14.2f\n", racks[r], pages, first * 1e6, last * 1e6);
+    }
+    DSPsetSize(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    free(plants);
+}
+
+//----------------------------------------------------------------------- Values
+
+#define VALUE_SAMPLES 4000000
+#define VALUE_TEXTS 1024
+
+/// The sensor pipeline of the build: parse a reading, aggregate, classify,
+/// average and format. Build with and without SENSOR_FIXED to compare fixed
+/// point with float.
+static void benchValues(void) {
+    static char texts[VALUE_TEXTS][16];
+    static sensorValue_t values[VALUE_TEXTS];
+    plant_t plant;
+    char text[16];
+    long bands = 0;
+    double start;
+
+#ifdef SENSOR_FIXED
+    printf("Fixed point values, 1/%d units\n", VAL_SCALE);
+#else
+    printf("Float values\n");
+#endif
+    for (int i = 0; i < VALUE_TEXTS; i++) {
+        snprintf(texts[i], sizeof(texts[i]), "%.2f", 5 + 25 * uniform());
+    }
+    PLTinitialise(&plant, 0);
+    printf("%-20s %10s\n", "Stage", "ns/sample");
+
+    start = now();
+    for (long i = 0; i < VALUE_SAMPLES; i++) {
+        values[i % VALUE_TEXTS] = VALparse(texts[i % VALUE_TEXTS], NULL);
+    }
+    printf("%-20s %10.2f\n", "parse", (now() - start) * 1e9 / VALUE_SAMPLES);
+    start = now();
+    for (long i = 0; i < VALUE_SAMPLES; i++) {
+        PLTaddSample(&plant, i % CH_NOF_CHANNELS, values[i % VALUE_TEXTS]);
+    }
+    printf("%-20s %10.2f\n", "aggregate", (now() - start) * 1e9 / VALUE_SAMPLES);
+    start = now();
+    for (long i = 0; i < VALUE_SAMPLES; i++) {
+        bands += PRFclassify(&plant, i % CH_NOF_CHANNELS, values[i % VALUE_TEXTS]);
+    }
+    printf("%-20s %10.2f\n", "classify", (now() - start) * 1e9 / VALUE_SAMPLES);
+    start = now();
+    for (long i = 0; i < VALUE_SAMPLES; i++) {
+        const plantAggregate_t *aggregate = &plant.sensors[i % CH_NOF_CHANNELS];
+
+        bands += VALaverage(aggregate->sum, aggregate->count) > values[i % VALUE_TEXTS];
+    }
+    printf("%-20s %10.2f\n", "average", (now() - start) * 1e9 / VALUE_SAMPLES);
+    start = now();
+    for (long i = 0; i < VALUE_SAMPLES; i++) {
+        bands += VALformat(text, sizeof(text), values[i % VALUE_TEXTS]);
+    }
+    printf("%-20s %10.2f\n", "format", (now() - start) * 1e9 / VALUE_SAMPLES);
+    sink = bands;
+}
+
+//----------------------------------------------------------------------- Ingest
+
+#define INGEST_SAMPLES 2000000
+
+/// \return the samples of the CSV log in path, parsed line by line with
+/// fgets() and atof() like a plain reader would
+static size_t readCsvAtof(const char path[], ingestSample_t samples[], size_t max) {
+    FILE *file = fopen(path, "r");
+    char line[128];
+    size_t n = 0;
+
+    if (file == NULL) {
+        return 0;
+    }
+    while (n < max && fgets(line, sizeof(line), file) != NULL) {
+        char *p = line;
+
+        if (*p < '0' || *p > '9') {
+            continue;
+        }
+        samples[n].ms = (uint32_t)strtoul(p, &p, 10);
+        samples[n].plant = (uint32_t)strtoul(p + 1, &p, 10);
+        samples[n].channel = (uint8_t)strtoul(p + 1, &p, 10);
+        samples[n].value = (sensorValue_t)(atof(p + 1) * VAL_SCALE);
+        n++;
+    }
+    fclose(file);
+    return n;
+}
+
+/// \return the samples of the log in path read with INGread()
+static size_t readIngest(const char path[], ingestSample_t samples[], size_t max) {
+    ingest_t log;
+    size_t n = 0;
+    size_t m;
+
+    if (INGopen(&log, path) != 0) {
+        return 0;
+    }
+    while (n < max && (m = INGread(&log, samples + n, max - n < INGEST_BATCH ?
+                                   max - n : INGEST_BATCH)) > 0) {
+        n += m;
+    }
+    INGclose(&log);
+    return n;
+}
+
+/// Parsing a recorded sensor log with the ingest parser against fgets() and
+/// atof(), and the binary format
+static void benchIngest(void) {
+    static const char csv[] = "fsmbench.csv";
+    static const char binary[] = "fsmbench.log";
+    ingestSample_t *samples = malloc(INGEST_SAMPLES * sizeof(ingestSample_t));
+    ingestSample_t *expected = malloc(INGEST_SAMPLES * sizeof(ingestSample_t));
+    const struct {
+        const char *name;
+        const char *path;
+        size_t (*read)(const char path[], ingestSample_t samples[], size_t max);
+    } readers[] = {
+        { "CSV, fgets() + atof()", csv, readCsvAtof },
+        { "CSV, INGread()", csv, readIngest },
+        { "binary, INGread()", binary, readIngest },
+    };
+    FILE *file = fopen(csv, "w");
+    struct stat st;
+
+    if (samples == NULL || expected == NULL || file == NULL) {
+        printf("Out of memory or cannot write %s\n", csv);
+        goto done;
+    }
+    fprintf(file, "ms,plant,channel,value\n");
+    for (size_t i = 0; i < INGEST_SAMPLES; i++) {
+        const int tenths = (int)(uniform() * 4000) - 500;
+
+        expected[i] = (ingestSample_t){ (uint32_t)(i * 10), (uint32_t)(i % 1000),
+                                        VAL_FROM_TENTHS(tenths), (uint8_t)(i % CH_NOF_CHANNELS) };
+        fprintf(file, "%u,%u,%u,%s%d.%d\n", expected[i].ms, expected[i].plant, expected[i].channel,
+                tenths < 0 ? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+    }
+    fclose(file);
+    if (INGwrite(binary, expected, INGEST_SAMPLES) != 0) {
+        printf("Cannot write %s\n", binary);
+        goto done;
+    }
+
+    printf("%-24s %8s %10s %10s %8s\n", "Log", "MB", "MB/s", "M samp/s", "Errors");
+    for (size_t r = 0; r < sizeof(readers) / sizeof(readers[0]); r++) {
+        double start = now();
+        size_t n = readers[r].read(readers[r].path, samples, INGEST_SAMPLES);
+        double seconds = now() - start;
+        long errors = (long)(INGEST_SAMPLES - n);
+
+        for (size_t i = 0; i < n; i++) {
+            errors += samples[i].ms != expected[i].ms || samples[i].plant != expected[i].plant ||
+                      samples[i].channel != expected[i].channel ||
+                      VAL_TO_TENTHS(samples[i].value) != VAL_TO_TENTHS(expected[i].value);
+        }
+        stat(readers[r].path, &st);
+        printf("%-24s %8.1f %10.0f %10.2f %8ld\n", readers[r].name, st.st_size / 1e6,
+               st.st_size / 1e6 / seconds, n / 1e6 / seconds, errors);
+    }
+done:
+    remove(csv);
+    remove(binary);
+    free(samples);
+    free(expected);
+}
+
+//--------------------------------------------------------------------- Watchdog
+
+static volatile unsigned handled;
+static unsigned overruns;
+
+static void countHandler(void) {
+    handled++;
+}
+
+static void slowHandler(void) {
+    const struct timespec pause = { 0, 3000000L };
+
+    nanosleep(&pause, NULL);
+}
+
+static void countOverrun(const state_t state, const uint32_t us) {
+    (void)state;
+    (void)us;
+    overruns++;
+}
+
+static const state_funcs_t untimedStates[] = {
+    [S_INIT]      = { countHandler, countHandler, 0, S_NO },
+    [S_WAITINPUT] = { countHandler, countHandler, 0, S_NO },
+};
+
+static const state_funcs_t timedStates[] = {
+    [S_INIT]      = { countHandler, countHandler, 1000, S_NO },
+    [S_WAITINPUT] = { countHandler, countHandler, 1000, S_NO },
+};
+
+static const state_funcs_t slowStates[] = {
+    [S_INIT]      = { countHandler, countHandler, 1000, S_NO },
+    [S_WAITINPUT] = { slowHandler,  NULL,         2000, S_NO },
+};
+
+static const transition_t toggleTransitions[] = {
+    { S_INIT,      E_INIT, S_WAITINPUT },
+    { S_WAITINPUT, E_INIT, S_INIT      },
+};
+
+/// Cost of timing the handlers with a budget, and an overrun
+static void benchWatchdog(void) {
+    const state_funcs_t *models[] = { untimedStates, timedStates };
+    const long n = 10000000;
+
+    FSM_SetWatchdog(E_RESET, countOverrun);
+    FSM_FlushEnexpectedEvents(true);
+    printf("%-20s %16s %10s\n", "Handlers", "ns/transition", "Overruns");
+    for (int m = 0; m < 2; m++) {
+        state_t state = S_INIT;
+        double start;
+
+        FSM_SetModel(models[m], S_WAITINPUT + 1, toggleTransitions, 2);
+        overruns = 0;
+        start = now();
+        for (long i = 0; i < n; i++) {
+            state = FSM_EventHandler(state, E_INIT);
+        }
+        /// A preempted handler is an overrun as well
+        printf("%-20s %16.2f %10u\n", m == 0 ? "no budget" : "budget 1000 us",
+               (now() - start) * 1e9 / n, overruns);
+        drain();
+    }
+    overruns = 0;
+    FSM_SetModel(slowStates, S_WAITINPUT + 1, toggleTransitions, 2);
+    FSM_EventHandler(S_INIT, E_INIT);
+    printf("3 ms handler, budget 2000 us: %u overrun, event %s\n", overruns,
+           FSM_GetEvent() == E_RESET ? "E_RESET" : "none");
+    FSM_SetWatchdog(E_NO, NULL);
+    drain();
+}
+
+//------------------------------------------------------------------------ Fleet
+
+#define FLEET_SIZE 100000
+#define FLEET_STEPS 200
+
+static long fleetHandlers;
+
+static void fleetHeat(void) {
+    fleetHandlers++;
+    FSM_AddInternalEvent(E_RESET);
+}
+
+static void fleetLog(void) {
+    fleetHandlers++;
+    FSM_AddEvent(E_RESET);
+}
+
+static const state_funcs_t fleetStates[] = {
+    [S_HEAT]    = { fleetHeat, NULL, 0, S_NO },
+    [S_LOGERROR] = { fleetLog, NULL, 0, S_NO },
+};
+
+static const transition_t fleetTransitions[] = {
+    { S_WAITINPUT,   E_INPUTCHANGED,  S_CHECKCHANGE },
+    { S_CHECKCHANGE, E_NOACTION,      S_WAITINPUT   },
+    { S_CHECKCHANGE, E_TOOCOLD,       S_HEAT        },
+    { S_HEAT,        E_RESET,         S_WAITINPUT   },
+    { S_CHECKCHANGE, E_OUTSIDEBOUNDS, S_LOGERROR    },
+    { S_LOGERROR,    E_RESET,         S_WAITINPUT   },
+};
+
+/// Stepping a fleet against an FSM instance per plant
+static void benchFleet(void) {
+    static const event_t randomEvents[] = {
+        E_INPUTCHANGED, E_NOACTION, E_TOOCOLD, E_OUTSIDEBOUNDS, E_RESET, E_INIT,
+    };
+    fsm_context_t *contexts = malloc(FLEET_SIZE * sizeof(fsm_context_t));
+    fsm_fleet_t fleet;
+    long mismatches = 0;
+    long changed = 0;
+    double seconds = 0;
+    double start;
+
+    FSM_SetModel(fleetStates, sizeof(fleetStates) / sizeof(fleetStates[0]),
+                 fleetTransitions, sizeof(fleetTransitions) / sizeof(fleetTransitions[0]));
+    FSM_FlushEnexpectedEvents(true);
+    if (contexts == NULL || FSM_InitFleet(&fleet, FLEET_SIZE, S_WAITINPUT, NULL) != 0) {
+        printf("Out of memory\n");
+        free(contexts);
+        return;
+    }
+    for (uint32_t i = 0; i < FLEET_SIZE; i++) {
+        FSM_InitContext(&contexts[i], NULL);
+        contexts[i].state = S_WAITINPUT;
+    }
+
+    /// The fleet must end in the same states as the instances
+    fleet.size = 1000;
+    for (int step = 0; step < 20; step++) {
+        for (uint32_t i = 0; i < fleet.size; i++) {
+            event_t e = randomEvents[(int)(uniform() * 6)];
+
+            if (fleet.event[i] == E_NO) {
+                fleet.event[i] = (uint8_t)e;
+            }
+            FSM_SelectContext(&contexts[i]);
+            if (FSM_NoEvents()) {
+                FSM_AddEvent(e);
+            }
+            FSM_EventHandler(contexts[i].state, FSM_GetEvent());
+        }
+        FSM_StepFleet(&fleet, E_NO);
+        for (uint32_t i = 0; i < fleet.size; i++) {
+            mismatches += fleet.state[i] != contexts[i].state;
+        }
+    }
+    FSM_SelectContext(NULL);
+    fleet.size = FLEET_SIZE;
+    printf("Mismatches against the instances: %ld\n", mismatches);
+    for (uint32_t i = 0; i < FLEET_SIZE; i++) {
+        fleet.state[i] = S_WAITINPUT;
+        fleet.event[i] = E_NO;
+        FSM_InitContext(&contexts[i], NULL);
+        contexts[i].state = S_WAITINPUT;
+    }
+
+    start = now();
+    for (int step = 0; step < FLEET_STEPS; step++) {
+        changed += FSM_StepFleet(&fleet, (step & 1) ? E_NOACTION : E_INPUTCHANGED);
+    }
+    printf("%-34s %8.0f M instances/s\n", "fleet, broadcast, all change",
+           FLEET_STEPS * (double)FLEET_SIZE / (now() - start) / 1e6);
+    start = now();
+    for (int step = 0; step < FLEET_STEPS; step++) {
+        changed += FSM_StepFleet(&fleet, E_INIT);
+    }
+    printf("%-34s %8.0f M instances/s\n", "fleet, broadcast, no change",
+           FLEET_STEPS * (double)FLEET_SIZE / (now() - start) / 1e6);
+
+    /// 1% of the checks need heating, a handler
+    fleetHandlers = 0;
+    for (int step = 0; step < FLEET_STEPS / 2; step++) {
+        for (uint32_t i = 0; i < FLEET_SIZE; i++) {
+            fleet.event[i] = fleet.state[i] == S_WAITINPUT ? E_INPUTCHANGED
+                           : uniform() < 0.01 ? E_TOOCOLD : E_NOACTION;
+        }
+        start = now();
+        FSM_StepFleet(&fleet, E_NO);
+        seconds += now() - start;
+    }
+    printf("%-34s %8.0f M instances/s (%ld handlers)\n", "fleet, pending, 1% handlers",
+           FLEET_STEPS / 2 * (double)FLEET_SIZE / seconds / 1e6, fleetHandlers);
+
+    start = now();
+    for (int step = 0; step < FLEET_STEPS / 10; step++) {
+        for (uint32_t i = 0; i < FLEET_SIZE; i++) {
+            FSM_SelectContext(&contexts[i]);
+            FSM_EventHandler(contexts[i].state, (step & 1) ? E_NOACTION : E_INPUTCHANGED);
+        }
+    }
+    FSM_SelectContext(NULL);
+    printf("%-34s %8.0f M instances/s\n", "instance per plant",
+           FLEET_STEPS / 10 * (double)FLEET_SIZE / (now() - start) / 1e6);
+    sink = changed;
+    FSM_FreeFleet(&fleet);
+    free(contexts);
+}
+
+//-------------------------------------------------------------------- Telemetry
+
+#define TELEMETRY_PLANTS 10000
+#define TELEMETRY_ROUNDS 200
+#define BENCH_TELEMETRY "/fsmbench.tel"
+
+static atomic_bool viewing;
+
+typedef struct {
+    long reads;
+    long failed;                    ///< TELread() gave up on a slot
+    long torn;                      ///< A copy that mixes two publications
+} viewer_t;
+
+/// Reads all slots over and over like fsmtop, without its pause
+static void *viewSlots(void *arg) {
+    viewer_t *viewer = arg;
+    const telemetry_t *telemetry = TELattach(BENCH_TELEMETRY);
+    telemetryData_t data;
+
+    while (telemetry != NULL && atomic_load(&viewing)) {
+        for (uint32_t i = 0; i < telemetry->nofSlots; i++) {
+            if (!TELread(telemetry, i, &data)) {
+                viewer->failed++;
+            } else if (data.handled != data.overruns) {
+                viewer->torn++;
+            }
+            viewer->reads++;
+        }
+    }
+    if (telemetry != NULL) {
+        TELdetach(telemetry);
+    }
+    return NULL;
+}
+
+/// Cost of publishing the plants, without and with a viewer reading them
+static void benchTelemetry(void) {
+    plant_t *plants = calloc(TELEMETRY_PLANTS, sizeof(plant_t));
+
+    if (plants == NULL || TELopen(BENCH_TELEMETRY, TELEMETRY_PLANTS) != 0) {
+        printf("Out of memory or no shared memory\n");
+        free(plants);
+        return;
+    }
+    for (uint32_t i = 0; i < TELEMETRY_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+    }
+    printf("%-10s %12s %14s %8s %8s\n", "Viewer", "ns/publish", "Slot reads/s", "Failed", "Torn");
+    for (int view = 0; view < 2; view++) {
+        viewer_t viewer = { 0, 0, 0 };
+        pthread_t thread;
+        double start;
+        double seconds;
+
+        atomic_store(&viewing, true);
+        if (view && pthread_create(&thread, NULL, viewSlots, &viewer) != 0) {
+            printf("Cannot start the viewer\n");
+            break;
+        }
+        start = now();
+        for (uint32_t round = 1; round <= TELEMETRY_ROUNDS; round++) {
+            /// A viewer sees both counters of the same round
+            for (uint32_t i = 0; i < TELEMETRY_PLANTS; i++) {
+                plants[i].fsm.handled = round;
+                plants[i].fsm.overruns = round;
+                TELpublish(&plants[i]);
+            }
+        }
+        seconds = now() - start;
+        atomic_store(&viewing, false);
+        if (view) {
+            pthread_join(thread, NULL);
+        }
+        printf("%-10s %12.2f %14.0f %8ld %8ld\n", view ? "reading" : "none",
+               seconds * 1e9 / TELEMETRY_ROUNDS / TELEMETRY_PLANTS, viewer.reads / seconds,
+               viewer.failed, viewer.torn);
+    }
+    TELclose();
+    free(plants);
+}
+
+//---------------------------------------------------------------------- Profile
+
+#define PROFILE_PLANTS 10000
+#define PROFILE_ROUNDS 200
+#define PROFILE_TIMED 1000000
+#define BENCH_PROFILE "fsmbench.prf"
+
+static const char *const profileSpecies[] = { "tomato", "basil", "lettuce", "pepper" };
+
+static atomic_bool reloading;
+
+/// Reloads the profile file as fast as it can and counts the reloads
+static void *reloadProfiles(void *arg) {
+    long *reloads = arg;
+
+    while (atomic_load(&reloading)) {
+        if (PRFload(BENCH_PROFILE) == 0) {
+            (*reloads)++;
+        }
+    }
+    return NULL;
+}
+
+/// Classifies the values of all plants, \return the sum of the bands
+static long classifyPlants(plant_t plants[], const sensorValue_t values[]) {
+    long bands = 0;
+
+    for (int round = 0; round < PROFILE_ROUNDS; round++) {
+        for (uint32_t i = 0; i < PROFILE_PLANTS; i++) {
+            bands += PRFclassify(&plants[i], i % CH_NOF_CHANNELS, values[(i + round) % PROFILE_PLANTS]);
+        }
+    }
+    return bands;
+}
+
+/// \return the longest single classification in seconds
+static double longestClassify(plant_t plants[], const sensorValue_t values[]) {
+    double longest = 0;
+
+    for (long i = 0; i < PROFILE_TIMED; i++) {
+        double start = now();
+        double duration;
+
+        sink = PRFclassify(&plants[i % PROFILE_PLANTS], i % CH_NOF_CHANNELS, values[i % PROFILE_PLANTS]);
+        duration = now() - start;
+        if (duration > longest) {
+            longest = duration;
+        }
+    }
+    return longest;
+}
+
+/// Classification of 10000 plants, without and with a thread that keeps
+/// reloading the profiles
+static void benchProfile(void) {
+    extern const char * const channelEnumToText[];
+    static plant_t plants[PROFILE_PLANTS];
+    static sensorValue_t values[PROFILE_PLANTS];
+    FILE *file = fopen(BENCH_PROFILE, "w");
+    double best = 1e9;
+    long bands = 0;
+
+    if (file == NULL) {
+        printf("Cannot write %s\n", BENCH_PROFILE);
+        return;
+    }
+    fprintf(file, "# species   channel      low  normal  high  hysteresis\n");
+    fprintf(file, "default     TEMPERATURE  10   20      25    0\n");
+    for (size_t s = 0; s < sizeof(profileSpecies) / sizeof(profileSpecies[0]); s++) {
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            fprintf(file, "%-11s %-12s %-4d %-7d %-5d 0.5\n", profileSpecies[s],
+                    channelEnumToText[ch], 8 + (int)s, 18 + (int)s, 28 + (int)s);
+        }
+    }
+    fclose(file);
+
+    for (int i = 0; i < 20; i++) {
+        double start = now();
+
+        if (PRFload(BENCH_PROFILE) != 0) {
+            printf("Cannot load %s\n", BENCH_PROFILE);
+            remove(BENCH_PROFILE);
+            return;
+        }
+        if (now() - start < best) {
+            best = now() - start;
+        }
+    }
+    printf("PRFload() of %d lines: %.1f us\n",
+           1 + (int)(sizeof(profileSpecies) / sizeof(profileSpecies[0])) * CH_NOF_CHANNELS, best * 1e6);
+
+    for (uint32_t i = 0; i < PROFILE_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+        PRFattach(&plants[i], profileSpecies[i % (sizeof(profileSpecies) / sizeof(profileSpecies[0]))]);
+        values[i] = VAL(5 + 30 * uniform());
+    }
+
+    printf("%-12s %13s %14s %9s\n", "Reloading", "ns/classify", "Longest (us)", "Reloads");
+    for (int reload = 0; reload < 2; reload++) {
+        long reloads = 0;
+        pthread_t thread;
+        double start;
+        double seconds;
+        double longest;
+
+        atomic_store(&reloading, true);
+        if (reload && pthread_create(&thread, NULL, reloadProfiles, &reloads) != 0) {
+            printf("Cannot start the reloads\n");
+            break;
+        }
+        start = now();
+        bands += classifyPlants(plants, values);
+        seconds = now() - start;
+        longest = longestClassify(plants, values);
+        atomic_store(&reloading, false);
+        if (reload) {
+            pthread_join(thread, NULL);
+        }
+        printf("%-12s %13.2f %14.1f %9ld\n", reload ? "continuous" : "none",
+               seconds * 1e9 / PROFILE_ROUNDS / PROFILE_PLANTS, longest * 1e6, reloads);
+    }
+    sink = bands;
+    remove(BENCH_PROFILE);
+}
+
+//----------------------------------------------------------------------- Filter
+
+#define FILTER_PLANTS 4096
+#define FILTER_TICKS 2000
+#define NOISY_PLANTS 256
+#define NOISY_READINGS 2000
+
+static const char * const filterNames[] = {
+    "median 3", "median 5", "median 7", "EMA 0.3", "Kalman q/r 0.05",
+};
+
+static const filterConfig_t filterConfigs[] = {
+    { FLT_MEDIAN, 3, 0 },
+    { FLT_MEDIAN, 5, 0 },
+    { FLT_MEDIAN, 7, 0 },
+    { FLT_EMA,    0, FLT_WEIGHT(0.3) },
+    { FLT_KALMAN, 0, FLT_WEIGHT(0.05) },
+};
+
+#define NOF_FILTERS (sizeof(filterConfigs) / sizeof(filterConfigs[0]))
+
+/// 0 outside the bounds 10 .. 25, 1 low, 2 normal
+static int band(sensorValue_t value) {
+    if (value > VAL(10) && value < VAL(20)) {
+        return 1;
+    }
+    return (value > VAL(20) && value < VAL(25)) ? 2 : 0;
+}
+
+/// Throughput of the filters, and the false out of bounds
+/// classifications on a noisy trace that never leaves the bounds
+static void benchFilter(void) {
+    static sensorValue_t rack[FILTER_PLANTS];
+    static sensorValue_t readings[FILTER_PLANTS];
+    double sum = 0;
+
+    for (int i = 0; i < FILTER_PLANTS; i++) {
+        readings[i] = VAL_FROM_TENTHS(200 + (int)(uniform() * 30));
+    }
+    printf("%-16s %14s %14s\n", "Filter", "Batch M/s", "One by one M/s");
+    for (size_t f = 0; f < NOF_FILTERS; f++) {
+        filterConfig_t config[CH_NOF_CHANNELS] = {{0}};
+        filterBank_t bank;
+        double batch;
+        double start;
+
+        config[CH_TEMPERATURE] = filterConfigs[f];
+        if (FLTinitialise(&bank, FILTER_PLANTS, config) != 0) {
+            printf("Out of memory\n");
+            return;
+        }
+        start = now();
+        for (int k = 0; k < FILTER_TICKS; k++) {
+            for (int i = 0; i < FILTER_PLANTS; i++) {
+                rack[i] = readings[(i + k) & (FILTER_PLANTS - 1)];
+            }
+            FLTbatch(&bank, CH_TEMPERATURE, rack, 0, FILTER_PLANTS);
+            sum += rack[k & (FILTER_PLANTS - 1)];
+        }
+        batch = now() - start;
+        start = now();
+        for (int k = 0; k < FILTER_TICKS; k++) {
+            for (int i = 0; i < FILTER_PLANTS; i++) {
+                sum += FLTsample(&bank, i, CH_TEMPERATURE, readings[(i + k) & (FILTER_PLANTS - 1)]);
+            }
+        }
+        printf("%-16s %14.0f %14.0f\n", filterNames[f],
+               (double)FILTER_PLANTS * FILTER_TICKS / batch / 1e6,
+               (double)FILTER_PLANTS * FILTER_TICKS / (now() - start) / 1e6);
+        FLTterminate(&bank);
+    }
+    sink = sum;
+
+    /// The true temperature drifts between 12.5 and 23.5, the readings have
+    /// a noise of 1.0 and 1% spikes of 15
+    printf("\n%-16s %14s %14s %14s\n", "Noisy trace", "Outside", "Band changes", "Wrong band");
+    for (int f = -1; f < (int)NOF_FILTERS; f++) {
+        filterConfig_t config[CH_NOF_CHANNELS] = {{0}};
+        filterBank_t bank;
+        long outside = 0;
+        long changes = 0;
+        long wrong = 0;
+
+        if (f >= 0) {
+            config[CH_TEMPERATURE] = filterConfigs[f];
+        }
+        if (FLTinitialise(&bank, NOISY_PLANTS, config) != 0) {
+            printf("Out of memory\n");
+            return;
+        }
+        seed = 7;
+        for (int p = 0; p < NOISY_PLANTS; p++) {
+            int last = 0;
+
+            for (int k = 0; k < NOISY_READINGS; k++) {
+                const double temperature = 18 + 5.5 * sin(k / 150.0 + p);
+                const double spike = uniform() < 0.01 ? (uniform() < 0.5 ? 15 : -15) : 0;
+                const int b = band(FLTsample(&bank, p, CH_TEMPERATURE,
+                                             VAL(temperature + gauss() + spike)));
+
+                outside += b == 0;
+                changes += b != last;
+                wrong += b != 0 && b != band(VAL(temperature));
+                last = b;
+            }
+        }
+        printf("%-16s %14ld %14ld %14ld\n", f < 0 ? "unfiltered" : filterNames[f],
+               outside, changes, wrong);
+        FLTterminate(&bank);
+    }
+}
+
+//-------------------------------------------------------------------- Hierarchy
+
+#define HIERARCHY_CYCLES 5000000
+
+static unsigned long handlers;   ///< onEntry() and onExit() calls
+
+static void countCall(void) {
+    handlers++;
+}
+
+/// The action states of the plant, E_RESET returns to S_WAITINPUT from
+/// each of them
+static const state_funcs_t flatStates[] = {
+    [S_WAITINPUT]   = { countCall, countCall, 0, S_NO },
+    [S_CHECKCHANGE] = { countCall, countCall, 0, S_NO },
+    [S_AIRFLOW]     = { countCall, countCall, 0, S_NO },
+    [S_MOISTURIZE]  = { countCall, countCall, 0, S_NO },
+    [S_HEAT]        = { countCall, countCall, 0, S_NO },
+};
+
+static const transition_t flatTransitions[] = {
+    { S_WAITINPUT,   E_INPUTCHANGED, S_CHECKCHANGE },
+    { S_CHECKCHANGE, E_RESET,        S_WAITINPUT   },
+    { S_AIRFLOW,     E_RESET,        S_WAITINPUT   },
+    { S_MOISTURIZE,  E_RESET,        S_WAITINPUT   },
+    { S_HEAT,        E_RESET,        S_WAITINPUT   },
+};
+
+/// The same states in S_PROCESSING, which has the only E_RESET transition
+static const state_funcs_t nestedStates[] = {
+    [S_WAITINPUT]   = { countCall, countCall, 0, S_NO         },
+    [S_CHECKCHANGE] = { countCall, countCall, 0, S_PROCESSING },
+    [S_AIRFLOW]     = { countCall, countCall, 0, S_PROCESSING },
+    [S_MOISTURIZE]  = { countCall, countCall, 0, S_PROCESSING },
+    [S_HEAT]        = { countCall, countCall, 0, S_PROCESSING },
+    [S_PROCESSING]  = { NULL,      NULL,      0, S_NO         },
+};
+
+static const transition_t nestedTransitions[] = {
+    { S_WAITINPUT,  E_INPUTCHANGED, S_CHECKCHANGE },
+    { S_PROCESSING, E_RESET,        S_WAITINPUT   },
+};
+
+/// Enclosing states of S_CHECKCHANGE, innermost first
+static const state_t enclosing[] = { S_PROCESSING, S_HEAT, S_AIRFLOW };
+
+/// \return ns per S_WAITINPUT -> S_CHECKCHANGE -> S_WAITINPUT cycle
+static double cycle(const state_funcs_t states[], size_t nofStates,
+                    const transition_t transitions[], size_t nofTransitions) {
+    state_t state = S_WAITINPUT;
+    double start;
+
+    FSM_SetModel(states, nofStates, transitions, nofTransitions);
+    handlers = 0;
+    start = now();
+    for (long i = 0; i < HIERARCHY_CYCLES; i++) {
+        state = FSM_EventHandler(state, E_INPUTCHANGED);
+        state = FSM_EventHandler(state, E_RESET);
+    }
+    return (now() - start) * 1e9 / HIERARCHY_CYCLES;
+}
+
+/// Transitions inherited from an enclosing state against the same
+/// transitions of every state, and the cost of deeper nesting
+static void benchHierarchy(void) {
+    static state_funcs_t deepStates[S_NOF_STATES];
+    static transition_t deepTransitions[2];
+    double ns;
+
+    FSM_FlushEnexpectedEvents(true);
+    printf("%-20s %10s %16s\n", "Model", "ns/cycle", "Handlers/cycle");
+    ns = cycle(flatStates, sizeof(flatStates) / sizeof(flatStates[0]),
+               flatTransitions, sizeof(flatTransitions) / sizeof(flatTransitions[0]));
+    printf("%-20s %10.1f %16.1f\n", "flat", ns, (double)handlers / HIERARCHY_CYCLES);
+    ns = cycle(nestedStates, sizeof(nestedStates) / sizeof(nestedStates[0]),
+               nestedTransitions, sizeof(nestedTransitions) / sizeof(nestedTransitions[0]));
+    printf("%-20s %10.1f %16.1f\n", "inherited E_RESET", ns, (double)handlers / HIERARCHY_CYCLES);
+
+    /// S_CHECKCHANGE nested in 2 and more states, E_RESET is a transition
+    /// of the outermost state
+    for (size_t depth = 2; depth <= sizeof(enclosing) / sizeof(enclosing[0]); depth++) {
+        char name[32];
+
+        memset(deepStates, 0, sizeof(deepStates));
+        deepStates[S_WAITINPUT] = (state_funcs_t){ countCall, countCall, 0, S_NO };
+        deepStates[S_CHECKCHANGE] = (state_funcs_t){ countCall, countCall, 0, enclosing[0] };
+        for (size_t d = 0; d < depth; d++) {
+            deepStates[enclosing[d]] = (state_funcs_t){ countCall, countCall, 0,
+                                                        d + 1 < depth ? enclosing[d + 1] : S_NO };
+        }
+        deepTransitions[0] = nestedTransitions[0];
+        deepTransitions[1] = (transition_t){ enclosing[depth - 1], E_RESET, S_WAITINPUT };
+        ns = cycle(deepStates, S_NOF_STATES, deepTransitions, 2);
+        snprintf(name, sizeof(name), "nested %zu levels", depth);
+        printf("%-20s %10.1f %16.1f\n", name, ns, (double)handlers / HIERARCHY_CYCLES);
+    }
+    drain();
+}
+
+//---------------------------------------------------------------------- Ingress
+
+#define RING_NAME "/fsmbench.igr"
+#define RING_CAPACITY 4096
+#define RING_BATCH 64
+#define RING_SAMPLES 4000000
+#define RING_PACED 10000
+
+typedef enum { FEED_BATCH, FEED_SINGLE, FEED_PACED } feed_t;
+
+static const char * const feedNames[] = { "batch of 64", "one by one", "paced 200 us" };
+
+typedef struct {
+    feed_t feed;
+    long samples;
+} feeder_t;
+
+/// Waits for the consumer when the ring is full, or between paced records
+static void pauseFor(long us) {
+    const struct timespec pause = { 0, us * 1000L };
+
+    nanosleep(&pause, NULL);
+}
+
+/// The producer process of fsmfeed, as a thread
+static void *feedRing(void *arg) {
+    const feeder_t *feeder = arg;
+    ingress_t ingress;
+    long done = 0;
+
+    if (IGRattach(&ingress, RING_NAME) != 0) {
+        return NULL;
+    }
+    while (done < feeder->samples) {
+        if (feeder->feed == FEED_BATCH) {
+            ingressRecord_t *records;
+            uint32_t room = IGRreserve(&ingress, &records, RING_BATCH);
+
+            if (room == 0) {
+                pauseFor(100);
+                continue;
+            }
+            for (uint32_t i = 0; i < room; i++) {
+                records[i] = (ingressRecord_t){ (uint32_t)(done + i) % 1000, VAL(20),
+                                                IGRmicroseconds(), CH_TEMPERATURE, E_NO, 0 };
+            }
+            IGRcommit(&ingress, room);
+            done += room;
+        } else {
+            const ingressRecord_t record = { (uint32_t)done % 1000, VAL(20),
+                                             IGRmicroseconds(), CH_TEMPERATURE, E_NO, 0 };
+
+            if (!IGRpush(&ingress, &record)) {
+                pauseFor(100);
+                continue;
+            }
+            done++;
+            if (feeder->feed == FEED_PACED) {
+                pauseFor(200);
+            }
+        }
+    }
+    IGRclose(&ingress);
+    return NULL;
+}
+
+/// Samples per second through the ring and their latency, from the time
+/// stamp of the producer to the consumer that reads them
+static void benchIngress(void) {
+    printf("%-14s %12s %16s %15s\n", "Producer", "Samples/s", "Mean latency us", "Max latency us");
+    for (feed_t feed = FEED_BATCH; feed <= FEED_PACED; feed++) {
+        feeder_t feeder = { feed, feed == FEED_PACED ? RING_PACED : RING_SAMPLES };
+        ingress_t ingress;
+        pthread_t thread;
+        long received = 0;
+        double latency = 0;
+        uint32_t longest = 0;
+        double start;
+
+        if (IGRcreate(&ingress, RING_NAME, RING_CAPACITY) != 0) {
+            printf("No shared memory\n");
+            return;
+        }
+        start = now();
+        if (pthread_create(&thread, NULL, feedRing, &feeder) != 0) {
+            printf("Cannot start the producer\n");
+            IGRclose(&ingress);
+            return;
+        }
+        while (received < feeder.samples) {
+            const ingressRecord_t *records;
+            uint32_t n = IGRpeek(&ingress, &records);
+            uint32_t us;
+
+            if (n == 0) {
+                IGRwait(&ingress, 100, NULL);
+                continue;
+            }
+            us = IGRmicroseconds();
+            for (uint32_t i = 0; i < n; i++) {
+                const uint32_t late = us - records[i].us;
+
+                latency += late;
+                if (late > longest) {
+                    longest = late;
+                }
+            }
+            IGRrelease(&ingress, n);
+            received += n;
+        }
+        printf("%-14s %12.0f %16.1f %15u\n", feedNames[feed], received / (now() - start),
+               latency / received, longest);
+        pthread_join(thread, NULL);
+        IGRclose(&ingress);
+    }
+}
+
+//---------------------------------------------------------------------- Reactor
+
+#define REACTOR_FDS 1000
+#define REACTOR_WAKES 1000
+
+static int readyFds[REACTOR_FDS];
+static double wakeStart;        ///< Time base of the stamps
+static long woken;
+static double wakeLatency;
+static double longestWake;
+
+/// \return the seconds since wakeStart
+static double sinceStart(void) {
+    return now() - wakeStart;
+}
+
+/// Reads the stamp written to fd, the latency is the time since the write
+static event_t readStamp(int fd, void *data) {
+    uint64_t stamp;
+
+    (void)data;
+    if (read(fd, &stamp, sizeof(stamp)) == sizeof(stamp)) {
+        const double latency = sinceStart() - stamp * 1e-9;
+
+        wakeLatency += latency;
+        if (latency > longestWake) {
+            longestWake = latency;
+        }
+        woken++;
+    }
+    return E_NO;
+}
+
+/// Writes a stamp to a random descriptor every ms, like sensors that report
+/// now and then
+static void *writeStamps(void *arg) {
+    const struct timespec pause = { 0, 1000000L };
+    int nofFds = *(const int *)arg;
+
+    for (int i = 0; i < REACTOR_WAKES; i++) {
+        uint64_t stamp;
+
+        nanosleep(&pause, NULL);
+        stamp = (uint64_t)(sinceStart() * 1e9);
+        /// The counter of an eventfd does not overflow, the write succeeds
+        if (write(readyFds[(int)(uniform() * nofFds)], &stamp, sizeof(stamp)) < 0) {
+            printf("Write failed\n");
+        }
+    }
+    return NULL;
+}
+
+/// The former event loop spins on its idle hook, which polls the
+/// descriptors without sleeping, until all stamps are read
+static void spinPoll(struct pollfd fds[], int nofFds) {
+    while (woken < REACTOR_WAKES) {
+        if (poll(fds, nofFds, 0) > 0) {
+            for (int i = 0; i < nofFds; i++) {
+                if (fds[i].revents & POLLIN) {
+                    readStamp(fds[i].fd, NULL);
+                }
+            }
+        }
+    }
+}
+
+/// The event loop sleeps in the reactor
+static void sleepReactor(void) {
+    while (woken < REACTOR_WAKES) {
+        RCTwait(100);
+    }
+}
+
+/// Idle CPU time and wake latency with 1000 descriptors, a write to one of
+/// them every ms
+static void benchReactor(void) {
+    static struct pollfd fds[REACTOR_FDS];
+    int nofFds = 0;
+
+    if (RCTinitialise() != 0) {
+        printf("No epoll\n");
+        return;
+    }
+    while (nofFds < REACTOR_FDS) {
+        const int fd = eventfd(0, EFD_NONBLOCK);
+
+        if (fd < 0 || RCTadd(fd, readStamp, NULL) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            break;
+        }
+        readyFds[nofFds] = fd;
+        fds[nofFds] = (struct pollfd){ .fd = fd, .events = POLLIN };
+        nofFds++;
+    }
+    printf("%d descriptors, a write every ms\n", nofFds);
+    printf("%-16s %8s %16s %15s\n", "Loop", "CPU %", "Mean latency us", "Max latency us");
+    for (int reactor = 0; reactor < 2; reactor++) {
+        struct timespec cpu0;
+        struct timespec cpu1;
+        pthread_t thread;
+        double start;
+        double seconds;
+
+        woken = 0;
+        wakeLatency = 0;
+        longestWake = 0;
+        wakeStart = now();
+        if (pthread_create(&thread, NULL, writeStamps, &nofFds) != 0) {
+            printf("Cannot start the writer\n");
+            break;
+        }
+        /// Only the CPU time of the loop, not of the writer
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu0);
+        start = now();
+        if (reactor) {
+            sleepReactor();
+        } else {
+            spinPoll(fds, nofFds);
+        }
+        seconds = now() - start;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu1);
+        pthread_join(thread, NULL);
+        printf("%-16s %8.1f %16.1f %15.1f\n", reactor ? "epoll reactor" : "poll() spinning",
+               ((cpu1.tv_sec - cpu0.tv_sec) + (cpu1.tv_nsec - cpu0.tv_nsec) * 1e-9) * 100 / seconds,
+               woken > 0 ? wakeLatency * 1e6 / woken : 0, longestWake * 1e6);
+    }
+    RCTterminate();
+    for (int i = 0; i < nofFds; i++) {
+        close(readyFds[i]);
+    }
+}
+
+//------------------------------------------------------------------ Monte Carlo
+
+static void mcsInit(void) {
+    FSM_AddInternalEvent(E_INITSUCCES);
+}
+
+static void mcsLogError(void) {
+    FSM_AddInternalEvent(E_ERRORLOGGED);
+}
+
+static void mcsAirflow(void) {
+    MCSactuate(HAL_WINDOW, E_RESET);
+}
+
+static void mcsMoisturize(void) {
+    MCSactuate(HAL_PUMP, E_RESET);
+}
+
+static void mcsHeat(void) {
+    MCSactuate(HAL_HEATER, E_RESET);
+}
+
+/// The plant model of main.c with the simulated actions
+static const state_funcs_t mcsStates[] = {
+    [S_INIT]        = { mcsInit,       NULL, 0, S_NO         },
+    [S_CHECKCHANGE] = { NULL,          NULL, 0, S_PROCESSING },
+    [S_LOGERROR]    = { mcsLogError,   NULL, 0, S_NO         },
+    [S_AIRFLOW]     = { mcsAirflow,    NULL, 0, S_PROCESSING },
+    [S_MOISTURIZE]  = { mcsMoisturize, NULL, 0, S_PROCESSING },
+    [S_HEAT]        = { mcsHeat,       NULL, 0, S_PROCESSING },
+    [S_PROCESSING]  = { NULL,          NULL, 0, S_NO         },
+};
+
+static const transition_t mcsTransitions[] = {
+    { S_START,       E_INIT,          S_INIT        },
+    { S_INIT,        E_INITSUCCES,    S_WAITINPUT   },
+    { S_WAITINPUT,   E_INPUTCHANGED,  S_CHECKCHANGE },
+    { S_CHECKCHANGE, E_NOACTION,      S_WAITINPUT   },
+    { S_CHECKCHANGE, E_OUTSIDEBOUNDS, S_LOGERROR    },
+    { S_LOGERROR,    E_ERRORLOGGED,   S_INIT        },
+    { S_CHECKCHANGE, E_CO2LOW,        S_AIRFLOW     },
+    { S_CHECKCHANGE, E_MOISTURELOW,   S_MOISTURIZE  },
+    { S_CHECKCHANGE, E_TOOCOLD,       S_HEAT        },
+    { S_PROCESSING,  E_RESET,         S_WAITINPUT   },
+};
+
+/// The classification of EF_classify() in main.c
+static event_t mcsClassify(plant_t *plant, channel_t channel, sensorValue_t value) {
+    static const event_t lowEvent[CH_NOF_CHANNELS] = {
+        [CH_CO2] = E_CO2LOW,
+        [CH_MOISTURE] = E_MOISTURELOW,
+        [CH_TEMPERATURE] = E_TOOCOLD,
+    };
+
+    switch (PRFclassify(plant, channel, value)) {
+        case PRF_LOW:
+            return lowEvent[channel];
+        case PRF_NORMAL:
+            return E_NOACTION;
+        default:
+            return E_OUTSIDEBOUNDS;
+    }
+}
+
+/// Plant steps per second of the simulator, on one thread and on
+/// all cores
+static void benchMontecarlo(void) {
+    mcsConfig_t config = {
+        .plants = 500,
+        .days = 30,
+        .stepMinutes = SIMULATION_STEP_MIN,
+        .seed = SIMULATION_SEED,
+        .model = {
+            .drying = 0.0025f,      .co2Uptake = 0.6f,      .co2Leak = 0.02f,
+            .vent = 2.0f,           .outsideCo2 = 24.0f,    .watering = 20.0f,
+            .heating = 4.0f,        .insulation = 0.3f,     .climate = 19.5f,
+            .dailySwing = 2.5f,     .yearlySwing = 3.0f,    .processNoise = 0.3f,
+            .sensorNoise = 0.2f,    .spikeRate = 0.002f,    .spike = 8.0f,
+            .spread = 0.2f,
+        },
+        .actionMinutes = { [HAL_WINDOW] = 30, [HAL_PUMP] = 10, [HAL_HEATER] = 30 },
+        .classify = mcsClassify,
+    };
+    static const unsigned threads[] = { 1, 0 };
+    mcsResult_t result;
+
+    FSM_SetModel(mcsStates, sizeof(mcsStates) / sizeof(mcsStates[0]),
+                 mcsTransitions, sizeof(mcsTransitions) / sizeof(mcsTransitions[0]));
+    /// The bounds of the profile file when it is found, the built in otherwise
+    PRFload(PROFILE_FILE);
+    printf("%u plants, %u days, %u min steps\n", config.plants, config.days,
+           config.stepMinutes);
+    printf("%-8s %12s %12s %10s %12s\n", "Threads", "Steps", "Events", "Seconds", "M steps/s");
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        config.threads = threads[t];
+        if (MCSrun(&config, &result) != 0) {
+            printf("Simulation failed\n");
+            return;
+        }
+        printf("%-8u %12llu %12llu %10.2f %12.2f\n", result.threads,
+               (unsigned long long)result.steps, (unsigned long long)result.events,
+               result.seconds, result.steps / result.seconds / 1e6);
+    }
+}
+
+//------------------------------------------------------------------------ Batch
+
+static void noWait(void) {
+}
+
+static atomic_uint wakes;
+
+static void countWake(void) {
+    atomic_fetch_add_explicit(&wakes, 1, memory_order_relaxed);
+}
+
+/// Adding and taking events one by one against in batches
+static void benchBatch(void) {
+    enum { TOTAL = 1 << 22 };
+    event_t events[256];
+    unsigned sum = 0;
+
+    for (int i = 0; i < 256; i++) {
+        events[i] = (event_t)(1 + i % 7);
+    }
+    for (int hook = 0; hook < 2; hook++) {
+        FSM_SetWaitHook(hook ? noWait : NULL, hook ? countWake : NULL);
+        printf("%s\n%6s %14s %14s %8s\n", hook ? "With a wake hook" : "Without a wake hook",
+               "Batch", "Single ns/ev", "Batch ns/ev", "Speedup");
+        for (unsigned b = 1; b <= 256; b *= 2) {
+            double start = now();
+            double single;
+            double batch;
+
+            for (unsigned done = 0; done < TOTAL; done += b) {
+                unsigned added = 0;
+
+                while (added < b) {
+                    unsigned room = MAX_EVENTS_IN_BUFFER - 1 - FSM_NofEvents();
+                    unsigned last = (added + room < b) ? added + room : b;
+
+                    for (; added < last; added++) {
+                        FSM_AddEvent(events[added]);
+                    }
+                    while (!FSM_NoEvents()) {
+                        sum += FSM_GetEvent();
+                    }
+                }
+            }
+            single = now() - start;
+            start = now();
+            for (unsigned done = 0; done < TOTAL; done += b) {
+                unsigned added = 0;
+
+                while (added < b) {
+                    const fsm_event_t *taken;
+                    uint8_t n;
+
+                    added += FSM_AddEvents(events + added, b - added);
+                    while ((n = FSM_GetEvents(&taken)) > 0) {
+                        for (uint8_t i = 0; i < n; i++) {
+                            sum += taken[i];
+                        }
+                        FSM_ReleaseEvents(n);
+                    }
+                }
+            }
+            batch = now() - start;
+            printf("%6u %14.2f %14.2f %7.1fx\n", b, single * 1e9 / TOTAL, batch * 1e9 / TOTAL,
+                   single / batch);
+        }
+    }
+    FSM_SetWaitHook(NULL, NULL);
+    sink = sum;
+}
+
+//---------------------------------------------------------------------- History
+
+#define HISTORY_DAYS 90
+#define HISTORY_PERIOD_MS 10000
+#define HISTORY_QUERIES 2000
+
+/// Mean, daily amplitude, noise and random walk per hour of each channel
+static const double historyModel[CH_NOF_CHANNELS][4] = {
+    { 15, 3, 0.05, 0.3 }, { 60, 2, 0.1, 0.5 }, { 20, 4, 0.05, 0.2 },
+    { 70, 8, 0.2, 0.5 }, { 400, 400, 2, 5 }, { 1.5, 0.05, 0.01, 0.01 },
+};
+
+/// Size, decode and aggregate speed of 90 days of samples at 0.1
+/// resolution
+static void benchHistory(void) {
+    const size_t n = HISTORY_DAYS * 86400000ull / HISTORY_PERIOD_MS;
+    sensorValue_t *expected = malloc(n * CH_NOF_CHANNELS * sizeof(sensorValue_t));
+    sensorValue_t *values = malloc(n * sizeof(sensorValue_t));
+    uint64_t *times = malloc(n * sizeof(uint64_t));
+    double walk[CH_NOF_CHANNELS] = {0};
+    historyAggregate_t aggregate;
+    history_t history;
+    uint64_t samples;
+    size_t bytes;
+    size_t read = 0;
+    double covered = 0;
+    double start;
+
+    if (expected == NULL || values == NULL || times == NULL) {
+        printf("Out of memory\n");
+        goto done;
+    }
+    HSTinitialise(&history, 0);
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t t = (uint64_t)i * HISTORY_PERIOD_MS;
+        const double day = (t % 86400000) / 86400000.0;
+
+        for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+            double value;
+
+            walk[ch] = 0.9999 * (walk[ch] + historyModel[ch][3] *
+                                 sqrt(HISTORY_PERIOD_MS / 3600000.0) * gauss());
+            value = historyModel[ch][0] + historyModel[ch][1] * sin(2 * M_PI * (day - 0.3)) +
+                    walk[ch] + historyModel[ch][2] * gauss();
+            expected[i * CH_NOF_CHANNELS + ch] = VAL_FROM_TENTHS(lround(fmax(value, 0) * 10));
+            if (HSTappend(&history, ch, t, expected[i * CH_NOF_CHANNELS + ch]) != 0) {
+                printf("Append failed\n");
+                goto release;
+            }
+        }
+    }
+    bytes = HSTsize(&history, &samples);
+    printf("%llu samples in %zu KB, %.2f bytes/sample (%zu unencoded)\n",
+           (unsigned long long)samples, bytes / 1024, (double)bytes / samples,
+           sizeof(uint64_t) + sizeof(sensorValue_t));
+
+    start = now();
+    for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+        size_t m = HSTread(&history, ch, 0, UINT64_MAX, times, values, n);
+
+        read += m;
+        for (size_t i = 0; i < m; i++) {
+            if (times[i] != (uint64_t)i * HISTORY_PERIOD_MS ||
+                values[i] != expected[i * CH_NOF_CHANNELS + ch]) {
+                printf("Sample %zu of channel %d differs\n", i, ch);
+                goto release;
+            }
+        }
+    }
+    printf("Decode %.0f M samples/s (whole channel, checked)", read / (now() - start) / 1e6);
+    read = 0;
+    start = now();
+    for (int ch = 0; ch < CH_NOF_CHANNELS; ch++) {
+        uint64_t from = 0;
+        size_t m;
+
+        while ((m = HSTread(&history, ch, from, UINT64_MAX, times, values, 4096)) > 0) {
+            read += m;
+            from = times[m - 1] + 1;
+        }
+    }
+    printf(", %.0f M samples/s (4096 per read)\n", read / (now() - start) / 1e6);
+
+    start = now();
+    for (int q = 0; q < HISTORY_QUERIES; q++) {
+        uint64_t from = (uint64_t)(uniform() * (HISTORY_DAYS - 1) * 86400000.0);
+
+        HSTaggregate(&history, q % CH_NOF_CHANNELS, from, from + 86400000, &aggregate);
+        covered += aggregate.count;
+    }
+    printf("Aggregate of one day %.1f us, %.0f M samples/s covered\n",
+           (now() - start) / HISTORY_QUERIES * 1e6, covered / (now() - start) / 1e6);
+release:
+    HSTterminate(&history);
+done:
+    free(expected);
+    free(values);
+    free(times);
+}
+
+//--------------------------------------------------------------------- Keyboard
+
+#define KEY_PRESSES 1000
+
+static pthread_mutex_t keyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t keyAdded = PTHREAD_COND_INITIALIZER;
+static int typingFd;                ///< Master of the pseudo terminal
+static const char *typed;           ///< Text of one key press
+static _Atomic double pressed;      ///< Time of the last key press
+static atomic_int arrived;          ///< Key presses the controller got
+
+/// Wait hook of the event loop, sleeps until the reader adds an event
+static void waitKey(void) {
+    pthread_mutex_lock(&keyLock);
+    while (FSM_NoEvents()) {
+        pthread_cond_wait(&keyAdded, &keyLock);
+    }
+    pthread_mutex_unlock(&keyLock);
+}
+
+static void wakeKey(void) {
+    pthread_mutex_lock(&keyLock);
+    pthread_cond_broadcast(&keyAdded);
+    pthread_mutex_unlock(&keyLock);
+}
+
+/// The operator, presses a key a ms after the previous one arrived
+static void *typeKeys(void *arg) {
+    const struct timespec pause = { 0, 1000000L };
+
+    (void)arg;
+    for (int i = 0; i < KEY_PRESSES; i++) {
+        do {
+            nanosleep(&pause, NULL);
+        } while (atomic_load(&arrived) < i);
+        atomic_store(&pressed, now());
+        if (write(typingFd, typed, strlen(typed)) < 0) {
+            printf("Cannot type\n");
+        }
+    }
+    return NULL;
+}
+
+/// Keypress to dispatch latency through a pseudo terminal: a line read by
+/// the controller, which blocks it, against a key binding of the reader
+/// thread that wakes the event loop
+static void benchKeyboard(void) {
+    static const keyBinding_t bindings[] = {
+        { 'k', { E_INPUTCHANGED, E_NO }, "bench key" },
+    };
+    struct termios terminal;
+    int slave;
+    int saved;
+
+    if (openpty(&typingFd, &slave, NULL, NULL, NULL) != 0) {
+        printf("No pseudo terminal\n");
+        return;
+    }
+    /// Nobody reads the echo
+    tcgetattr(slave, &terminal);
+    terminal.c_lflag &= ~ECHO;
+    tcsetattr(slave, TCSANOW, &terminal);
+    saved = dup(STDIN_FILENO);
+    dup2(slave, STDIN_FILENO);
+    FSM_SetWaitHook(waitKey, wakeKey);
+
+    printf("%-22s %16s %15s\n", "Input", "Mean latency us", "Max latency us");
+    for (int raw = 0; raw < 2; raw++) {
+        pthread_t thread;
+        double latency = 0;
+        double longest = 0;
+
+        if (raw && KYBstartRaw(bindings, sizeof(bindings) / sizeof(bindings[0])) != 0) {
+            printf("No raw mode\n");
+            break;
+        }
+        typed = raw ? "k" : "k\n";
+        atomic_store(&arrived, 0);
+        if (pthread_create(&thread, NULL, typeKeys, NULL) != 0) {
+            printf("Cannot start the typing\n");
+            KYBstopRaw();
+            break;
+        }
+        for (int i = 0; i < KEY_PRESSES; i++) {
+            double late;
+
+            if (raw) {
+                waitKey();
+                FSM_GetEvent();
+            } else {
+                KYBgetchar();
+            }
+            late = now() - atomic_load(&pressed);
+            latency += late;
+            if (late > longest) {
+                longest = late;
+            }
+            atomic_store(&arrived, i + 1);
+        }
+        pthread_join(thread, NULL);
+        KYBstopRaw();
+        printf("%-22s %16.1f %15.1f\n", raw ? "raw key binding" : "line, key and <Enter>",
+               latency * 1e6 / KEY_PRESSES, longest * 1e6);
+    }
+
+    FSM_SetWaitHook(NULL, NULL);
+    dup2(saved, STDIN_FILENO);
+    close(saved);
+    close(slave);
+    close(typingFd);
+    clearerr(stdin);
+    drain();
+}
+
+//---------------------------------------------------------------------- Arbiter
+
+#define ARBITER_PLANTS 1000
+#define ARBITER_ROUNDS 20
+#define ARBITER_KINDS 3            ///< HAL_WINDOW, HAL_PUMP and HAL_HEATER
+#define ARBITER_JOBS (ARBITER_PLANTS * ARBITER_KINDS)
+
+/// The rack of main.c, and the same actuators without budgets: every
+/// actuator switches on when it is asked, as before the arbiter
+static const arbiterConfig_t arbiterConfigs[] = {
+    { 8, 0, 0,    10000, { [HAL_WINDOW] = { 40, 0, true }, [HAL_PUMP] = { 400, 0, true },
+                           [HAL_HEATER] = { 1500, 0, false } } },
+    { 8, 4, 3000, 10000, { [HAL_WINDOW] = { 40, 0, true }, [HAL_PUMP] = { 400, 0, true },
+                           [HAL_HEATER] = { 1500, 0, false } } },
+};
+
+/// Jobs served per second and the peak load, when all plants of the rack
+/// need all actuators at the same time. The jobs end as soon as they are
+/// granted, so the time is the time of the arbiter.
+static void benchArbiter(void) {
+    static plant_t plants[ARBITER_PLANTS];
+    static actuation_t actuations[ARBITER_JOBS];
+    static actuation_t *pending[ARBITER_JOBS];
+
+    for (uint32_t i = 0; i < ARBITER_PLANTS; i++) {
+        PLTinitialise(&plants[i], i);
+    }
+    printf("%u plants, every plant asks for its window, pump and heater at once\n", ARBITER_PLANTS);
+    printf("%-10s %12s %10s %12s %10s\n", "Budgets", "Jobs/s", "Runs", "Peak runs", "Peak W");
+    for (size_t c = 0; c < sizeof(arbiterConfigs) / sizeof(arbiterConfigs[0]); c++) {
+        arbiterStats_t stats;
+        double start;
+
+        if (ARBinitialise(&arbiterConfigs[c], ARBITER_JOBS) != 0) {
+            printf("Out of memory\n");
+            return;
+        }
+        start = now();
+        for (int round = 0; round < ARBITER_ROUNDS; round++) {
+            uint32_t nofPending = ARBITER_JOBS;
+
+            for (uint32_t j = 0; j < ARBITER_JOBS; j++) {
+                actuations[j] = (actuation_t){ .plant = &plants[j / ARBITER_KINDS] };
+                pending[j] = &actuations[j];
+                ARBrequest(&actuations[j], (halActuator_t)(HAL_WINDOW + j % ARBITER_KINDS));
+            }
+            /// A release starts the next runs
+            while (nofPending > 0) {
+                for (uint32_t p = 0; p < nofPending;) {
+                    actuation_t *act = pending[p];
+
+                    if (act->signalled) {
+                        ARBrelease(act, (halActuator_t)(HAL_WINDOW + (act - actuations) % ARBITER_KINDS));
+                        pending[p] = pending[--nofPending];
+                    } else {
+                        p++;
+                    }
+                }
+            }
+        }
+        ARBstatistics(&stats);
+        printf("%-10s %12.0f %10llu %12u %10u\n", arbiterConfigs[c].maxRunning ? "rack" : "none",
+               stats.jobs / (now() - start), (unsigned long long)stats.runs, stats.peakRunning,
+               stats.peakPower);
+    }
+    ARBterminate();
+}
+
+//------------------------------------------------------------------------- Main
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    const char *help;
+} bench_t;
+
+static const bench_t benches[] = {
+    { "internal",   benchInternal,   "event buffer against the run-to-completion channel" },
+    { "snapshot",   benchSnapshot,   "checkpoint and warm restart of 10000 plants" },
+    { "actuator",   benchActuator,   "polling 10000 actuations in progress" },
+    { "hal",        benchHal,        "bus time of channel, plant and rack reads" },
+    { "sampler",    benchSampler,    "fixed against adaptive sampling of a day" },
+    { "errors",     benchErrors,     "concurrent error bits and their string" },
+    { "display",    benchDisplay,    "frame buffer against the former display update" },
+    { "dashboard",  benchDashboard,  "dashboard page of a small and a large rack" },
+    { "values",     benchValues,     "sensor value pipeline, fixed point or float" },
+    { "ingest",     benchIngest,     "sensor log parser against fgets() and atof()" },
+    { "watchdog",   benchWatchdog,   "handler latency budgets" },
+    { "fleet",      benchFleet,      "fleet stepping against an instance per plant" },
+    { "telemetry",  benchTelemetry,  "publishing 10000 plants, with a viewer reading" },
+    { "profile",    benchProfile,    "classifying 10000 plants during profile reloads" },
+    { "filter",     benchFilter,     "noise filter throughput and false alarms" },
+    { "hierarchy",  benchHierarchy,  "inherited transitions and nesting depth" },
+    { "ingress",    benchIngress,    "sensor ring throughput and latency" },
+    { "reactor",    benchReactor,    "idle CPU and wake latency of 1000 descriptors" },
+    { "montecarlo", benchMontecarlo, "plant steps per second of the simulator" },
+    { "batch",      benchBatch,      "single against batched event buffer access" },
+    { "history",    benchHistory,    "compressed sensor history" },
+    { "keyboard",   benchKeyboard,   "keypress to dispatch latency" },
+    { "arbiter",    benchArbiter,    "actuator jobs served and peak load of a rack" },
+};
+
+#define NOF_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static void run(const bench_t *bench) {
+    printf("== %s: %s\n", bench->name, bench->help);
+    fflush(stdout);
+    bench->run();
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 1) {
+        for (size_t b = 0; b < NOF_BENCHES; b++) {
+            run(&benches[b]);
+        }
+        return 0;
+    }
+    for (int a = 1; a < argc; a++) {
+        size_t b = 0;
+
+        while (b < NOF_BENCHES && strcmp(argv[a], benches[b].name) != 0) {
+            b++;
+        }
+        if (b == NOF_BENCHES) {
+            printf("usage: fsmbench [bench ...]\n");
+            for (b = 0; b < NOF_BENCHES; b++) {
+                printf("  %-12s %s\n", benches[b].name, benches[b].help);
+            }
+            return 1;
+        }
+        run(&benches[b]);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+LIBS += -lpthread -lm -lutil
+
+# Benchmarks of the FSM framework and the plant module subsystems, build
+# with the DEFINES of the plant module to compare the same code
+# DEFINES += SENSOR_FIXED
+# DEFINES += FSM_COMPACT
+INCLUDEPATH += ../app
+
+SOURCES += \
+        fsmbench.c \
+        ../app/channels.c \
+        ../app/console_functions/devConsole.c \
+        ../app/console_functions/display.c \
+        ../app/console_functions/keyboard.c \
+        ../app/console_functions/systemErrors.c \
+        ../app/events.c \
+        ../app/fsm_functions/fsm.c \
+        ../app/fsm_functions/reactor.c \
+        ../app/fsm_functions/recorder.c \
+        ../app/hal_functions/hal.c \
+        ../app/hal_functions/halSimulator.c \
+        ../app/plant_functions/actuator.c \
+        ../app/plant_functions/arbiter.c \
+        ../app/plant_functions/montecarlo.c \
+        ../app/plant_functions/plant.c \
+        ../app/plant_functions/profile.c \
+        ../app/plant_functions/snapshot.c \
+        ../app/plant_functions/telemetry.c \
+        ../app/sensor_functions/filter.c \
+        ../app/sensor_functions/history.c \
+        ../app/sensor_functions/ingest.c \
+        ../app/sensor_functions/ingress.c \
+        ../app/sensor_functions/sampler.c \
+        ../app/sensor_functions/sensorValue.c \
+        ../app/states.c
+
+HEADERS += \
+   ../app/appInfo.h \
+   ../app/console_functions/display.h \
+   ../app/console_functions/keyboard.h \
+   ../app/console_functions/systemErrors.h \
+   ../app/fsm_functions/fsm.h \
+   ../app/fsm_functions/reactor.h \
+   ../app/hal_functions/halSimulator.h \
+   ../app/plant_functions/actuator.h \
+   ../app/plant_functions/arbiter.h \
+   ../app/plant_functions/montecarlo.h \
+   ../app/plant_functions/profile.h \
+   ../app/plant_functions/snapshot.h \
+   ../app/plant_functions/telemetry.h \
+   ../app/sensor_functions/filter.h \
+   ../app/sensor_functions/history.h \
+   ../app/sensor_functions/ingest.h \
+   ../app/sensor_functions/ingress.h \
+   ../app/sensor_functions/sampler.h \
+   ../app/sensor_functions/sensorValue.h
@@ -0,0 +1,134 @@
+/*!
+ * fsmfeed is a data acquisition process for a plant module started with
+ * --ingress: it produces the records of the sensor ring. With a recorded
+ * sensor log (CSV or binary, see --backtest) the samples are written in
+ * place in batches, as fast as the controller consumes them. Without a log
+ * it reads one record per line from stdin:
+ *
+ *    <plant> <channel> <value>     a sample, e.g. "0 CO2 15.5" or "0 0 15.5"
+ *    <plant> <event>               an event, e.g. "0 E_RESET" or "0 11"
+ *
+ * usage: fsmfeed [log|-] [segment name]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "appInfo.h"
+#include "channels.h"
+#include "events.h"
+#include "sensor_functions/ingest.h"
+#include "sensor_functions/ingress.h"
+
+extern const char * const channelEnumToText[];
+extern const char * const eventEnumToText[];
+
+/// \return the index of name in texts, also with the prefix of the enum left
+/// out ("CO2" for "CH_CO2") or as a number, -1 if it is none of them
+static int lookup(const char name[], const char * const texts[], int n, size_t prefix) {
+    char *end;
+    long number = strtol(name, &end, 10);
+
+    if (*end == '\0') {
+        return (number >= 0 && number < n) ? (int)number : -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (strcmp(texts[i], name) == 0 || strcmp(texts[i] + prefix, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/// Streams the samples of the log in path, a batch is written in place
+static int feedLog(ingress_t *ingress, const char path[]) {
+    static ingestSample_t batch[INGEST_BATCH];
+    ingest_t log;
+    long samples = 0;
+    size_t n;
+
+    if (INGopen(&log, path) != 0) {
+        printf("Cannot open sensor log: %s\n", path);
+        return 1;
+    }
+    while ((n = INGread(&log, batch, INGEST_BATCH)) > 0) {
+        size_t done = 0;
+
+        while (done < n) {
+            ingressRecord_t *records;
+            uint32_t room = IGRreserve(ingress, &records, (uint32_t)(n - done));
+
+            if (room == 0) {
+                /// Full, the controller frees records as it consumes them
+                usleep(1000);
+                continue;
+            }
+            for (uint32_t i = 0; i < room; i++) {
+                const ingestSample_t *sample = &batch[done + i];
+
+                records[i] = (ingressRecord_t){ sample->plant, sample->value,
+                                                IGRmicroseconds(), sample->channel, E_NO, 0 };
+            }
+            IGRcommit(ingress, room);
+            done += room;
+        }
+        samples += (long)n;
+    }
+    printf("%ld samples, %ld errors\n", samples, log.errors);
+    INGclose(&log);
+    return 0;
+}
+
+/// Writes a record per line of stdin
+static int feedLines(ingress_t *ingress) {
+    char line[128];
+    long number = 0;
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        ingressRecord_t record = { 0, 0, 0, 0, E_NO, 0 };
+        char first[32];
+        char second[32];
+        int tokens = sscanf(line, "%u %31s %31s", &record.plant, first, second);
+        int index;
+
+        number++;
+        if (tokens == 3 && (index = lookup(first, channelEnumToText, CH_NOF_CHANNELS, 3)) >= 0) {
+            record.channel = (uint8_t)index;
+            record.value = VALparse(second, NULL);
+        } else if (tokens == 2 &&
+                   (index = lookup(first, eventEnumToText, E_NOF_EVENTS, 2)) > E_NO) {
+            record.event = (uint8_t)index;
+        } else {
+            /// Empty lines and comments are skipped
+            if (line[strspn(line, " \t\r\n")] != '\0' && line[0] != '#') {
+                printf("Line %ld: invalid record\n", number);
+            }
+            continue;
+        }
+        record.us = IGRmicroseconds();
+        while (!IGRpush(ingress, &record)) {
+            usleep(1000);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = argc > 2 ? argv[2] : INGRESS_NAME;
+    ingress_t ingress;
+    int result;
+
+    if (IGRattach(&ingress, name) != 0) {
+        printf("No sensor ring %s, start the plant module with --ingress\n", name);
+        return 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+        result = feedLog(&ingress, argv[1]);
+    } else {
+        result = feedLines(&ingress);
+    }
+    IGRclose(&ingress);
+    return result;
+}
@@ -0,0 +1,20 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# Producer of the sensor ring of a plant module started with --ingress
+INCLUDEPATH += ../app
+
+SOURCES += \
+        fsmfeed.c \
+        ../app/channels.c \
+        ../app/events.c \
+        ../app/sensor_functions/ingest.c \
+        ../app/sensor_functions/ingress.c \
+        ../app/sensor_functions/sensorValue.c
+
+HEADERS += \
+   ../app/appInfo.h \
+   ../app/sensor_functions/ingest.h \
+   ../app/sensor_functions/ingress.h
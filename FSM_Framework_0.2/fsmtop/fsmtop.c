@@ -0,0 +1,120 @@
+/*!
+ * fsmtop shows the live telemetry of a running plant module: per plant the
+ * state, the event buffer, the event rate, the error bits and the last sensor
+ * readings. It only reads the shared memory segment of the controller, so
+ * attaching it does not slow the controller down.
+ *
+ * usage: fsmtop [interval ms] [segment name]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "appInfo.h"
+#include "plant_functions/telemetry.h"
+
+extern const char * const stateEnumToText[];
+
+#define MAX_PLANTS (64)   ///< Plants shown
+
+/// Monotonic time in seconds
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/// Formats a reading in tenths as "12.3", "-" if there is none
+static const char *reading(char text[], int32_t tenths) {
+    if (tenths == TEL_NONE) {
+        return "-";
+    }
+    snprintf(text, 16, "%s%d.%d", tenths < 0 ? "-" : "", abs(tenths) / 10, abs(tenths) % 10);
+    return text;
+}
+
+static void show(const telemetry_t *telemetry, uint32_t previous[], double seconds) {
+    char text[CH_NOF_CHANNELS][16];
+    char errors[ERR_NOF_ERRORS + 1];
+    telemetryData_t data;
+    uint32_t n = telemetry->nofSlots < MAX_PLANTS ? telemetry->nofSlots : MAX_PLANTS;
+
+    printf("\033[H\033[2J%s v%s - pid %u, %u plants\n\n", APP, VERSION,
+           telemetry->pid, telemetry->nofSlots);
+    printf("%5s %-14s %5s %8s %8s %-*s %7s %7s %7s %7s %7s %7s\n", "Plant", "State",
+           "Queue", "Events/s", "Overruns", ERR_NOF_ERRORS, "Errors", "CO2", "Moist",
+           "Temp", "Humid", "Light", "Salin");
+    for (uint32_t i = 0; i < n; i++) {
+        if (!TELread(telemetry, i, &data)) {
+            printf("%5u %-14s\n", i, "(being written)");
+            continue;
+        }
+        for (int e = 0; e < ERR_NOF_ERRORS; e++) {
+            errors[e] = (data.errors >> e) & 1 ? '1' : '0';
+        }
+        errors[ERR_NOF_ERRORS] = '\0';
+        printf("%5u %-14.14s %5u %8.0f %8u %-*s %7s %7s %7s %7s %7s %7s\n", data.id,
+               data.state <= S_PROCESSING ? stateEnumToText[data.state] : "?", data.queue,
+               (data.handled - previous[i]) / seconds, data.overruns, ERR_NOF_ERRORS, errors,
+               reading(text[CH_CO2], data.tenths[CH_CO2]),
+               reading(text[CH_MOISTURE], data.tenths[CH_MOISTURE]),
+               reading(text[CH_TEMPERATURE], data.tenths[CH_TEMPERATURE]),
+               reading(text[CH_HUMIDITY], data.tenths[CH_HUMIDITY]),
+               reading(text[CH_LIGHT], data.tenths[CH_LIGHT]),
+               reading(text[CH_SALINITY], data.tenths[CH_SALINITY]));
+        previous[i] = data.handled;
+    }
+    fflush(stdout);
+}
+
+/// Waits until a controller has created the segment name
+static const telemetry_t *attach(const char name[]) {
+    const telemetry_t *telemetry;
+
+    while ((telemetry = TELattach(name)) == NULL || !TELalive(telemetry)) {
+        /// The segment of a controller that was killed stays behind
+        if (telemetry != NULL) {
+            TELdetach(telemetry);
+        }
+        printf("\rWaiting for %s ...", name);
+        fflush(stdout);
+        usleep(500000);
+    }
+    return telemetry;
+}
+
+int main(int argc, char *argv[]) {
+    long interval = argc > 1 ? atol(argv[1]) : 500;
+    const char *name = argc > 2 ? argv[2] : TELEMETRY_NAME;
+    uint32_t previous[MAX_PLANTS] = {0};
+    const telemetry_t *telemetry;
+    double last;
+
+    if (interval <= 0) {
+        printf("usage: fsmtop [interval ms] [segment name]\n");
+        return 1;
+    }
+    telemetry = attach(name);
+    last = now();
+    while (1) {
+        double t;
+
+        usleep(interval * 1000);
+        t = now();
+        show(telemetry, previous, t - last);
+        last = t;
+
+        /// A killed controller leaves its segment behind, attach to the next
+        if (!TELalive(telemetry)) {
+            printf("\nController %u stopped\n", telemetry->pid);
+            TELdetach(telemetry);
+            telemetry = attach(name);
+            memset(previous, 0, sizeof(previous));
+            last = now();
+        }
+    }
+}
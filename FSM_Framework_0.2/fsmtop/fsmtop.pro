@@ -0,0 +1,17 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# Live viewer of the telemetry of a running plant module
+INCLUDEPATH += ../app
+
+SOURCES += \
+        fsmtop.c \
+        ../app/console_functions/systemErrors.c \
+        ../app/plant_functions/telemetry.c \
+        ../app/states.c
+
+HEADERS += \
+   ../app/appInfo.h \
+   ../app/plant_functions/telemetry.h